@@ -0,0 +1,119 @@
+/**
+ * @file address_table.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of address_table.h
+ */
+
+#include "address_table.h"
+#include "error.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Number of slots of the table when the first handle is stored
+#define TABLE_INITIAL_CAP 64
+
+/// Clients often share the address and differ in the port only, mix all bits of both
+static uint64_t address_hash(in_addr_t addr, in_port_t port) {
+    uint64_t hash = ((uint64_t)addr << 16) | port;
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+static size_t table_find_slot(const AddressTable *table, in_addr_t addr, in_port_t port) {
+    size_t mask = table->cap - 1;
+    size_t slot = address_hash(addr, port) & mask;
+
+    while (table->slots[slot].value && (table->slots[slot].addr != addr || table->slots[slot].port != port)) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+static void table_grow(AddressTable *table) {
+    size_t cap = table->cap ? table->cap * 2 : TABLE_INITIAL_CAP;
+    AddressSlot *slots = calloc(cap, sizeof(AddressSlot));
+
+    if (!slots) {
+        set_error(Error_OutOfMemory);
+        return;
+    }
+
+    AddressTable grown = { slots, table->len, cap };
+
+    for (size_t i = 0; i < table->cap; i++) {
+        AddressSlot *it = &table->slots[i];
+        if (it->value) grown.slots[table_find_slot(&grown, it->addr, it->port)] = *it;
+    }
+
+    free(table->slots);
+    *table = grown;
+}
+
+AddressTable address_table_new() {
+    AddressTable table = {0};
+    return table;
+}
+
+void address_table_free(AddressTable *table) {
+    free(table->slots);
+    memset(table, 0, sizeof(AddressTable));
+}
+
+void *address_table_get(const AddressTable *table, const struct sockaddr_in *address) {
+    if (!table->len) return NULL;
+
+    size_t slot = table_find_slot(table, address->sin_addr.s_addr, address->sin_port);
+    return table->slots[slot].value;
+}
+
+void address_table_insert(AddressTable *table, const struct sockaddr_in *address, void *value) {
+    // Keep the load factor under 1/2 so the probing sequences stay short
+    if ((table->len + 1) * 2 > table->cap) {
+        table_grow(table);
+        if (get_error()) return;
+    }
+
+    AddressSlot *slot = &table->slots[table_find_slot(table, address->sin_addr.s_addr, address->sin_port)];
+    if (!slot->value) table->len += 1;
+
+    slot->addr = address->sin_addr.s_addr;
+    slot->port = address->sin_port;
+    slot->value = value;
+}
+
+void address_table_remove(AddressTable *table, const struct sockaddr_in *address) {
+    if (!table->len) return;
+
+    size_t mask = table->cap - 1;
+    size_t hole = table_find_slot(table, address->sin_addr.s_addr, address->sin_port);
+    size_t slot = hole;
+
+    if (!table->slots[hole].value) return;
+
+    table->slots[hole].value = NULL;
+    table->len -= 1;
+
+    // Shift back the following slots of the probing sequence
+    while (1) {
+        slot = (slot + 1) & mask;
+        AddressSlot *next = &table->slots[slot];
+        if (!next->value) break;
+
+        // The handle can be moved into the hole only if the hole is not before its home slot
+        size_t home = address_hash(next->addr, next->port) & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            table->slots[hole] = *next;
+            next->value = NULL;
+            hole = slot;
+        }
+    }
+}
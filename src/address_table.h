@@ -0,0 +1,68 @@
+/**
+ * @file address_table.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides a hash table from a client address to its handle, used to demultiplex UDP datagrams.
+ */
+
+#ifndef ADDRESS_TABLE_H
+#define ADDRESS_TABLE_H
+
+#include <netinet/in.h>
+#include <stddef.h>
+
+/**
+ * @brief Slot of the address table.
+ */
+typedef struct {
+    in_addr_t addr; /**< IPv4 address in network byte order. */
+    in_port_t port; /**< Port in network byte order. */
+    void *value; /**< Handle stored under the address, NULL is an empty slot. */
+} AddressSlot;
+
+/**
+ * @brief Hash table keyed by IPv4 address and port, using open addressing with linear probing.
+ */
+typedef struct {
+    AddressSlot *slots; /**< Table of the handles. */
+    size_t len; /**< Number of stored handles. */
+    size_t cap; /**< Number of slots, always a power of 2. */
+} AddressTable;
+
+/**
+ * @brief Create a new empty table.
+ * @return The new table.
+ */
+AddressTable address_table_new();
+
+/**
+ * @brief Free the table, the stored handles are not touched.
+ * @param table Pointer to the table.
+ */
+void address_table_free(AddressTable *table);
+
+/**
+ * @brief Find the handle stored under an address.
+ * @param table Pointer to the table.
+ * @param address The address.
+ * @return The handle, NULL if there is not any.
+ */
+void *address_table_get(const AddressTable *table, const struct sockaddr_in *address);
+
+/**
+ * @brief Store a handle under an address, replacing the previous one.
+ * @param table Pointer to the table.
+ * @param address The address.
+ * @param value The handle, must not be NULL.
+ * @note This may set Error_OutOfMemory.
+ */
+void address_table_insert(AddressTable *table, const struct sockaddr_in *address, void *value);
+
+/**
+ * @brief Remove the handle stored under an address, if any.
+ * @param table Pointer to the table.
+ * @param address The address.
+ */
+void address_table_remove(AddressTable *table, const struct sockaddr_in *address);
+
+#endif
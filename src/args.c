@@ -31,7 +31,12 @@ Args parse_args(int argc, char **argv) {
         return args;
     }
 
+#ifdef SERVER_F
+    // Every option of the server has a default value
+    if (argc % 2 == 0) {
+#else
     if (argc % 2 == 0 || argc < 5) {
+#endif
         set_error(Error_InvalidArgument);
         return args;
     }
@@ -39,13 +44,38 @@ Args parse_args(int argc, char **argv) {
     args.port = 4567;
     args.udp_timeout = 250;
     args.udp_retransmissions = 3;
+    args.udp_window = 1;
+    args.udp_adaptive_timeout = false;
+    args.format = Format_Text;
+    args.sessions = 1;
+    args.mode_mixed = false;
+    args.threads = 1;
+    args.udp_shared = false;
+    args.io_uring = false;
+    args.credentials = NULL;
+    args.output_limit = 1024;
+    args.output_drop_oldest = false;
+    args.upgrade = NULL;
     args.help = false;
 
     bool got_port = false;
     bool got_host = false;
+#ifndef SERVER_F
     bool got_mode = false;
+    bool got_window = false;
+    bool got_timeout_policy = false;
+    bool got_format = false;
+    bool got_sessions = false;
+#endif
     bool got_timeout = false;
     bool got_udp_retransmissions = false;
+#ifdef SERVER_F
+    bool got_threads = false;
+    bool got_udp_sockets = false;
+    bool got_backend = false;
+    bool got_output_limit = false;
+    bool got_output_policy = false;
+#endif
 
     int idx = 1;
     
@@ -103,6 +133,9 @@ Args parse_args(int argc, char **argv) {
                     args.mode = Mode_UDP;
                 } else if (strcmp(val, "tcp") == 0) {
                     args.mode = Mode_TCP;
+                } else if (strcmp(val, "mixed") == 0) {
+                    args.mode = Mode_TCP;
+                    args.mode_mixed = true;
                 } else {
                     set_error(Error_InvalidArgument);
                     return args;
@@ -111,6 +144,82 @@ Args parse_args(int argc, char **argv) {
                 got_mode = true;
                 break;
             }
+
+            case 'w': {
+                if (got_window) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                int num = parse_16bit_number(val);
+                if (num < 1 || num > 1024) {
+                    eprint("UDP send window should be in the range 1 to 1024");
+                    set_error(Error_InvalidArgument);
+                    return args;
+                }
+
+                args.udp_window = num;
+                got_window = true;
+                break;
+            }
+
+            case 'a': {
+                if (got_timeout_policy) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                if (strcmp(val, "adaptive") == 0) {
+                    args.udp_adaptive_timeout = true;
+                } else if (strcmp(val, "fixed") == 0) {
+                    args.udp_adaptive_timeout = false;
+                } else {
+                    set_error(Error_InvalidArgument);
+                    return args;
+                }
+
+                got_timeout_policy = true;
+                break;
+            }
+
+            case 'f': {
+                if (got_format) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                if (strcmp(val, "text") == 0) {
+                    args.format = Format_Text;
+                } else if (strcmp(val, "ndjson") == 0) {
+                    args.format = Format_Ndjson;
+                } else if (strcmp(val, "binary") == 0) {
+                    args.format = Format_Binary;
+                } else {
+                    set_error(Error_InvalidArgument);
+                    return args;
+                }
+
+                got_format = true;
+                break;
+            }
+
+            case 'n': {
+                if (got_sessions) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                int num = parse_16bit_number(val);
+                if (num < 1) {
+                    eprint("Number of sessions should be in the range 1 to 65535");
+                    set_error(Error_InvalidArgument);
+                    return args;
+                }
+
+                args.sessions = num;
+                got_sessions = true;
+                break;
+            }
             #endif
 
             case 'd': {
@@ -148,6 +257,121 @@ Args parse_args(int argc, char **argv) {
                 break;
             }
 
+#ifdef SERVER_F
+            case 'j': {
+                if (got_threads) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                int num = parse_16bit_number(val);
+                if (num < 1 || num > 1024) {
+                    eprint("Number of threads should be in the range 1 to 1024");
+                    set_error(Error_InvalidArgument);
+                    return args;
+                }
+
+                args.threads = num;
+                got_threads = true;
+                break;
+            }
+
+            case 'u': {
+                if (got_udp_sockets) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                if (strcmp(val, "shared") == 0) {
+                    args.udp_shared = true;
+                } else if (strcmp(val, "dynamic") == 0) {
+                    args.udp_shared = false;
+                } else {
+                    set_error(Error_InvalidArgument);
+                    return args;
+                }
+
+                got_udp_sockets = true;
+                break;
+            }
+
+            case 'b': {
+                if (got_backend) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                if (strcmp(val, "io_uring") == 0) {
+                    args.io_uring = true;
+                } else if (strcmp(val, "epoll") == 0) {
+                    args.io_uring = false;
+                } else {
+                    set_error(Error_InvalidArgument);
+                    return args;
+                }
+
+                got_backend = true;
+                break;
+            }
+
+            case 'c': {
+                if (args.credentials) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                args.credentials = val;
+                break;
+            }
+
+            case 'q': {
+                if (got_output_limit) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                int num = parse_16bit_number(val);
+                if (num < 1) {
+                    eprint("Output queue limit should be in the range 1 to 65535");
+                    set_error(Error_InvalidArgument);
+                    return args;
+                }
+
+                args.output_limit = num;
+                got_output_limit = true;
+                break;
+            }
+
+            case 'o': {
+                if (got_output_policy) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                if (strcmp(val, "drop-oldest") == 0) {
+                    args.output_drop_oldest = true;
+                } else if (strcmp(val, "disconnect") == 0) {
+                    args.output_drop_oldest = false;
+                } else {
+                    set_error(Error_InvalidArgument);
+                    return args;
+                }
+
+                got_output_policy = true;
+                break;
+            }
+
+            case 'U': {
+                if (args.upgrade) {
+                    set_error(Error_DuplicatedArgument);
+                    return args;
+                }
+
+                args.upgrade = val;
+                break;
+            }
+#endif
+
             default:
                 set_error(Error_InvalidArgument);
                 return args;
@@ -159,7 +383,7 @@ Args parse_args(int argc, char **argv) {
             set_error(Error_InvalidArgument);
             eprint("Missing hostname. Please use -s <hostname>\n");
         #else
-            strcpy(args.host, "0.0.0.0");
+            args.host = "0.0.0.0";
         #endif
 
     } 
@@ -167,7 +391,7 @@ Args parse_args(int argc, char **argv) {
 #ifndef SERVER_F
     if (!got_mode) {
         set_error(Error_InvalidArgument);
-        eprint("Missing connection mode. Please use -t (udp|tcp)");
+        eprint("Missing connection mode. Please use -t (udp|tcp|mixed)");
     }
 #endif
 
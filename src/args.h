@@ -19,6 +19,15 @@ typedef enum {
     Mode_UDP,
 } Mode;
 
+/**
+ * @brief Enumeration of formats of the client output.
+ */
+typedef enum {
+    Format_Text, /**< Human readable lines, messages on stdout and the rest on stderr. */
+    Format_Ndjson, /**< A JSON object per line for every received payload, on stdout. */
+    Format_Binary, /**< A length-prefixed record for every received payload, on stdout. */
+} Format;
+
 /**
  * @brief Structure representing parsed command-line arguments.
  */
@@ -28,6 +37,18 @@ typedef struct {
     uint16_t port; /**< Port number. */
     uint16_t udp_timeout; /**< UDP timeout value. */
     uint8_t udp_retransmissions; /**< Number of UDP retransmissions. */
+    bool udp_adaptive_timeout; /**< Client: The UDP timeout is estimated from the round-trip times, `udp_timeout` is its initial and maximum value. */
+    uint16_t udp_window; /**< Client: Number of UDP payloads sent without waiting for their CONFIRM. */
+    Format format; /**< Client: Format of the received payloads written to stdout. */
+    uint16_t sessions; /**< Client: Number of chat sessions run by the client at once. */
+    bool mode_mixed; /**< Client: The sessions alternate between TCP and UDP, `mode` is the mode of the first one. */
+    uint16_t threads; /**< Server: Number of event loops, each running in its own thread. */
+    bool udp_shared; /**< Server: UDP clients are served by the welcome sockets instead of a socket each. */
+    bool io_uring; /**< Server: Drive the event loops by io_uring instead of epoll, when the kernel supports it. */
+    char *credentials; /**< Server: Path to the credential index, NULL if every AUTH is accepted. */
+    uint16_t output_limit; /**< Server: Maximum number of payloads queued for a TCP client. */
+    bool output_drop_oldest; /**< Server: A full output queue drops its oldest payload instead of disconnecting the client. */
+    char *upgrade; /**< Server: Path to the Unix socket used to hand the clients over to a new server, NULL if disabled. */
     bool help; /**< Flag indicating whether help information should be displayed. */
 } Args;
 
@@ -0,0 +1,173 @@
+/**
+ * @file channel.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of channel.h
+ */
+
+#include "channel.h"
+#include "error.h"
+#include <stdlib.h>
+#include <string.h>
+
+/// Number of slots of the registry when the first channel is created
+#define REGISTRY_INITIAL_CAP 16
+
+/// Number of member handles of a new channel
+#define CHANNEL_INITIAL_CAP 8
+
+/// FNV-1a
+static uint64_t channel_hash(const uint8_t *name) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (; *name; name++) {
+        hash ^= *name;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static size_t registry_find_slot(const ChannelRegistry *registry, const uint8_t *name) {
+    size_t mask = registry->cap - 1;
+    size_t slot = channel_hash(name) & mask;
+
+    while (registry->slots[slot] && strcmp((void *)registry->slots[slot]->name, (void *)name) != 0) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+static void registry_remove(ChannelRegistry *registry, Channel *channel);
+
+static void registry_grow(ChannelRegistry *registry) {
+    size_t cap = registry->cap ? registry->cap * 2 : REGISTRY_INITIAL_CAP;
+    Channel **slots = calloc(cap, sizeof(Channel *));
+
+    if (!slots) {
+        set_error(Error_OutOfMemory);
+        return;
+    }
+
+    ChannelRegistry grown = { slots, registry->len, cap };
+
+    for (size_t i = 0; i < registry->cap; i++) {
+        Channel *channel = registry->slots[i];
+        if (channel) grown.slots[registry_find_slot(&grown, channel->name)] = channel;
+    }
+
+    free(registry->slots);
+    *registry = grown;
+}
+
+ChannelRegistry channel_registry_new() {
+    ChannelRegistry registry = {0};
+    return registry;
+}
+
+void channel_registry_free(ChannelRegistry *registry) {
+    for (size_t i = 0; i < registry->cap; i++) {
+        Channel *channel = registry->slots[i];
+        if (!channel) continue;
+
+        free(channel->members);
+        free(channel);
+    }
+
+    free(registry->slots);
+    memset(registry, 0, sizeof(ChannelRegistry));
+}
+
+Channel *channel_registry_get(const ChannelRegistry *registry, const uint8_t *name) {
+    if (!registry->len) return NULL;
+    return registry->slots[registry_find_slot(registry, name)];
+}
+
+Channel *channel_join(ChannelRegistry *registry, const uint8_t *name, void *member, size_t *index) {
+    // Keep the load factor under 1/2 so the probing sequences stay short
+    if ((registry->len + 1) * 2 > registry->cap) {
+        registry_grow(registry);
+        if (get_error()) return NULL;
+    }
+
+    size_t slot = registry_find_slot(registry, name);
+    Channel *channel = registry->slots[slot];
+
+    if (!channel) {
+        channel = calloc(1, sizeof(Channel));
+
+        if (!channel) {
+            set_error(Error_OutOfMemory);
+            return NULL;
+        }
+
+        strncpy((void *)channel->name, (void *)name, CHANNEL_ID_LEN);
+        registry->slots[slot] = channel;
+        registry->len += 1;
+    }
+
+    if (channel->len == channel->cap) {
+        size_t cap = channel->cap ? channel->cap * 2 : CHANNEL_INITIAL_CAP;
+        void **members = realloc(channel->members, cap * sizeof(void *));
+
+        if (!members) {
+            set_error(Error_OutOfMemory);
+
+            // Do not leave an empty channel in the registry
+            if (!channel->len) {
+                registry_remove(registry, channel);
+                free(channel);
+            }
+
+            return NULL;
+        }
+
+        channel->members = members;
+        channel->cap = cap;
+    }
+
+    *index = channel->len;
+    channel->members[channel->len++] = member;
+    return channel;
+}
+
+/// Remove the channel from the registry, shifting back the following slots of its probing sequence
+static void registry_remove(ChannelRegistry *registry, Channel *channel) {
+    size_t mask = registry->cap - 1;
+    size_t hole = registry_find_slot(registry, channel->name);
+    size_t slot = hole;
+
+    registry->slots[hole] = NULL;
+    registry->len -= 1;
+
+    while (1) {
+        slot = (slot + 1) & mask;
+        Channel *next = registry->slots[slot];
+        if (!next) break;
+
+        // The channel can be moved into the hole only if the hole is not before its home slot
+        size_t home = channel_hash(next->name) & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            registry->slots[hole] = next;
+            registry->slots[slot] = NULL;
+            hole = slot;
+        }
+    }
+}
+
+void *channel_leave(ChannelRegistry *registry, Channel *channel, size_t index) {
+    channel->len -= 1;
+
+    if (!channel->len) {
+        registry_remove(registry, channel);
+        free(channel->members);
+        free(channel);
+        return NULL;
+    }
+
+    if (index == channel->len) return NULL;
+
+    channel->members[index] = channel->members[channel->len];
+    return channel->members[index];
+}
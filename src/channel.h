@@ -0,0 +1,76 @@
+/**
+ * @file channel.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides the registry of channels and their members used by the server.
+ */
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "payload.h"
+#include <stddef.h>
+
+/**
+ * @brief Structure representing a channel.
+ *
+ * Members are stored in a contiguous array so delivering a message to the channel is a linear scan.
+ * Leaving swaps the last member into the freed place, so the index of a member may change.
+ */
+typedef struct {
+    ChannelID name; /**< Name of the channel. */
+    void **members; /**< Handles of the members. */
+    size_t len; /**< Number of members. */
+    size_t cap; /**< Capacity of the members array. */
+} Channel;
+
+/**
+ * @brief Hash table from the channel name to the channel, using open addressing with linear probing.
+ */
+typedef struct {
+    Channel **slots; /**< Table of the channels, NULL is an empty slot. */
+    size_t len; /**< Number of channels. */
+    size_t cap; /**< Number of slots, always a power of 2. */
+} ChannelRegistry;
+
+/**
+ * @brief Create a new empty registry.
+ * @return The new registry.
+ */
+ChannelRegistry channel_registry_new();
+
+/**
+ * @brief Free the registry with all of its channels.
+ * @param registry Pointer to the registry.
+ */
+void channel_registry_free(ChannelRegistry *registry);
+
+/**
+ * @brief Find a channel by its name.
+ * @param registry Pointer to the registry.
+ * @param name Null-terminated name of the channel.
+ * @return Pointer to the channel, NULL if the channel does not have any member.
+ */
+Channel *channel_registry_get(const ChannelRegistry *registry, const uint8_t *name);
+
+/**
+ * @brief Add a member into a channel, creating the channel if it does not exist.
+ * @param registry Pointer to the registry.
+ * @param name Null-terminated name of the channel.
+ * @param member Handle of the member.
+ * @param index Output, index of the member in the channel.
+ * @return Pointer to the channel, NULL on failure.
+ * @note This may set Error_OutOfMemory.
+ */
+Channel *channel_join(ChannelRegistry *registry, const uint8_t *name, void *member, size_t *index);
+
+/**
+ * @brief Remove a member from a channel, the channel is freed when its last member leaves.
+ * @param registry Pointer to the registry.
+ * @param channel Pointer to the channel.
+ * @param index Index of the member in the channel.
+ * @return Handle of the member that has been moved into the index, NULL if no member has been moved.
+ */
+void *channel_leave(ChannelRegistry *registry, Channel *channel, size_t index);
+
+#endif
@@ -8,27 +8,47 @@
 #include "client.h"
 #include "error.h"
 #include "input.h"
+#include "output.h"
 #include "commands.h"
 #include <sys/epoll.h>
 #include <string.h>
 #include <unistd.h>
 #include <signal.h> 
+#include <errno.h>
+#include <sys/resource.h>
 #include "connection.h"
 #include "payload.h"
 #include "time.h"
-#include "bit_field.h"
+#include "replay_window.h"
+#include "rto.h"
+#include "udp.h"
 
 /// Max event of EPOLL
-#define MAX_EVENT 2
+#define MAX_EVENT 64
 
-struct current_payload {
+/**
+ * UDP payload waiting to be sent or confirmed
+ */
+struct outgoing_payload {
     Payload payload;
+    bool sent;
     bool confirmed;
-    bool executed;
     int retry_count;
+    int timeout;
     Timestamp timestamp;
 };
 
+/**
+ * UDP payloads in the order they have been created, a ring with the capacity of a power of 2.
+ * At most `udp_window` of them are sent and waiting for CONFIRM at the same time.
+ */
+struct outgoing {
+    struct outgoing_payload *items;
+    size_t head;
+    size_t len;
+    size_t cap;
+};
+
 /**
  * Client state
  */
@@ -41,12 +61,42 @@ enum state {
     State_End,
 };
 
+/**
+ * A chat session, the client runs `-n` of them in a single event loop
+ */
+struct client {
+    uint16_t index;
+    enum state state;
+    Connection connection;
+    ReplayWindow received_ids;
+    DisplayName display_name;
+    struct outgoing outgoing;
+    Rto rto;
+    MessageID next_message_id;
+    bool closed;
+};
+
 void client_init(Args args);
+void client_open(struct client *, uint16_t, Args);
+void client_close(struct client *);
 void client_shutdown();
-bool client_handle_timeout();
+void client_interrupt();
+void client_update(struct client *);
+bool client_handle_timeout(struct client *);
 void client_handle_input();
-void client_handle_socket();
-void client_send(PayloadType, PayloadData *);
+void client_handle_lines();
+void client_handle_line(struct client *, const uint8_t *);
+void client_end_input();
+bool client_takes_input(struct client *);
+bool client_takes_stdin();
+void client_handle_socket(struct client *);
+void client_handle_payload(struct client *, const PayloadView *);
+void client_handle_datagrams(struct client *);
+void client_send(struct client *, PayloadType, PayloadData *);
+void client_send_view(struct client *, const PayloadView *);
+void client_send_queued(struct client *);
+void client_confirm(struct client *, MessageID);
+int client_next_timeout();
 
 char *CHAT_HELP_MESSAGE = 
 "IPK2024-chat: To start, use /auth to authenticate then use /join to join a channel and now you can start chatting.\n"
@@ -62,22 +112,22 @@ char *CHAT_HELP_MESSAGE =
 "/exit - End the chat app\n"
 "";
 
-enum state STATE = State_Start;
-Connection CONNECTION;
-BitField RECEIVED_ID;
-DisplayName DISPLAY_NAME;
-struct current_payload CURRENT_PAYLOAD;
+struct client *CLIENTS;
+/// Number of the sessions that have been set up, and of those that have not been closed yet
+size_t CLIENT_COUNT = 0, CLIENTS_OPEN = 0;
+Input INPUT;
+/// Line taken from stdin whose session does not take input yet, stdin is not read until it is handled
+const uint8_t *HELD_LINE = NULL;
+struct client *HELD_CLIENT = NULL;
 int EPOLL_FD_SOCKET, EPOLL_FD_SOCKET_STDIN;
+/// Stdin is a regular file, such as a script redirected to the client, the epoll cannot watch it
+bool STDIN_FILE = false;
+volatile sig_atomic_t INTERRUPTED = 0;
 
 void handle_sigint(int sig) { 
-    logfmt("Get signal %u", sig);
     (void)sig;
-
-    if (STATE != State_Start) {
-        client_send(PayloadType_Bye, NULL);
-    }
-
-    STATE = State_End;
+    // The BYE is sent by the event loop, the handler could interrupt it while it changes the outgoing payloads
+    INTERRUPTED = 1;
 } 
 
 void client_run(Args args) {
@@ -90,66 +140,50 @@ void client_run(Args args) {
 
     struct epoll_event events[MAX_EVENT];
 
-    while (!(STATE == State_End && CURRENT_PAYLOAD.confirmed)) {
-        int timeout = -1;
-        int epoll_fd = EPOLL_FD_SOCKET_STDIN;
+    while (CLIENTS_OPEN) {
+        int timeout = client_next_timeout();
+        bool takes_stdin = client_takes_stdin();
+        int epoll_fd = takes_stdin ? EPOLL_FD_SOCKET_STDIN : EPOLL_FD_SOCKET;
 
-        if (STATE == State_Auth) {
-            // When in state AUTH, does not need to poll for the stdin
-            epoll_fd = EPOLL_FD_SOCKET;
-        }
-
-        if (!CURRENT_PAYLOAD.confirmed) {
-            timeout = CONNECTION.args.udp_timeout - timestamp_elapsed(CURRENT_PAYLOAD.timestamp);
-            /// Very rare case but better safe than sorry
-            if (timeout < 0) timeout = 0;
-            // While waiting for CONFIRM, does not need to poll for the stdin
-            epoll_fd = EPOLL_FD_SOCKET;
-        }
+        // A regular file is always readable, only the sockets are polled, without waiting
+        bool read_file = STDIN_FILE && takes_stdin;
+        if (read_file) timeout = 0;
 
         logfmt("Polling with timeout of %d ms", timeout);
-        int num_fds = epoll_wait(epoll_fd, events, MAX_EVENT, timeout);
+        int num_fds = INTERRUPTED ? -1 : epoll_wait(epoll_fd, events, MAX_EVENT, timeout);
         logfmt("Polled with %d fds", num_fds);
 
         if (num_fds < 0) {
-            // GOT ERROR
-            STATE = State_End;
-            if (STATE == State_Start) {
-                break;
-            }
-
-            client_send(PayloadType_Bye, NULL);
-            continue;
-        }
-
-        if (num_fds == 0) {
-            /// TIMEOUT
-            bool should_shutdown = client_handle_timeout();
-            if (should_shutdown) {
-                break;
-            }
-
-            continue;
+            // GOT ERROR, typically interrupted by SIGINT
+            INTERRUPTED = 0;
+            client_interrupt();
         }
 
         for (int i = 0; i < num_fds; i++) {
-            if (events[i].data.fd == CONNECTION.sockfd) {
+            struct client *client = events[i].data.ptr;
+
+            if (client) {
                 // GOT MESSAGE FROM SERVER
-                client_handle_socket();
-            } else if (events[i].data.fd == STDIN_FILENO) {
+                client_handle_socket(client);
+            } else {
                 // GOT USER INPUT
                 client_handle_input();
             }
         }
 
-        if (STATE == State_Error && CURRENT_PAYLOAD.confirmed) {
-            client_send(PayloadType_Bye, NULL);
-            STATE = State_End;
+        if (read_file && num_fds >= 0) {
+            client_handle_input();
+        }
+
+        // The lines held back while their session did not take input are not signaled by the epoll again
+        client_handle_lines();
+
+        for (size_t i = 0; i < CLIENT_COUNT; i++) {
+            client_update(&CLIENTS[i]);
         }
 
         log("Done a event loop");
-        fflush(stdout);
-        fflush(stderr);
+        output_flush();
     }
 
     client_shutdown();
@@ -159,14 +193,15 @@ void client_init(Args args) {
     log("Initializing client");
     command_setup();
     signal(SIGINT, handle_sigint); 
-    RECEIVED_ID = bit_field_new();
-
-    if (get_error()) return;
-
-    CONNECTION = connection_init(args);
-    CONNECTION.connect(&CONNECTION);
-    CURRENT_PAYLOAD.confirmed = true;
-    log("Initialized");
+    input_init(&INPUT);
+    output_init(args.format, STDOUT_FILENO, STDERR_FILENO, args.sessions > 1);
+
+    // Every session needs a socket, use as many file descriptors as we are allowed to
+    struct rlimit limit;
+    if (args.sessions > 1 && getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
 
     EPOLL_FD_SOCKET = epoll_create1(0);
     EPOLL_FD_SOCKET_STDIN = epoll_create1(0);
@@ -177,275 +212,649 @@ void client_init(Args args) {
         return;
     }
 
-    // Add STDIN file descriptor to epoll
+    // Add STDIN file descriptor to epoll, it is the only one without a session
     struct epoll_event event_stdin;
     event_stdin.events = EPOLLIN;
-    event_stdin.data.fd = STDIN_FILENO;
+    event_stdin.data.ptr = NULL;
     if (epoll_ctl(EPOLL_FD_SOCKET_STDIN, EPOLL_CTL_ADD, STDIN_FILENO, &event_stdin) == -1) {
+        if (errno != EPERM) {
+            set_error(Error_Internal);
+            perror("ERR: epoll_ctl: stdin");
+            return;
+        }
+
+        STDIN_FILE = true;
+    }
+
+    CLIENTS = calloc(args.sessions, sizeof(struct client));
+
+    if (!CLIENTS) {
         set_error(Error_Internal);
-        perror("ERR: epoll_ctl: stdin");
+        eprint("Cannot allocate memory for the sessions");
         return;
     }
 
-    // Add socket file descriptor to epolls
+    for (uint16_t i = 0; i < args.sessions; i++) {
+        client_open(&CLIENTS[i], i, args);
+        if (get_error()) return;
+    }
+
+    log("Initialized");
+}
+
+/// Connect a session to the server and add its socket to the epolls
+void client_open(struct client *client, uint16_t index, Args args) {
+    // The odd sessions of the mixed mode use the other protocol
+    if (args.mode_mixed && index % 2) {
+        args.mode = args.mode == Mode_TCP ? Mode_UDP : Mode_TCP;
+    }
+
+    client->index = index;
+    client->state = State_Start;
+    replay_window_init(&client->received_ids);
+
+    connection_init(&client->connection, args);
+    if (get_error()) return;
+
+    CLIENT_COUNT += 1;
+    CLIENTS_OPEN += 1;
+
+    client->rto = rto_new(args.udp_timeout, args.udp_adaptive_timeout);
+    // Sessions created within the same millisecond must not retransmit in lockstep
+    client->rto.seed += index;
+
+    client->connection.connect(&client->connection);
+    if (get_error()) return;
+
     struct epoll_event event_socket;
     event_socket.events = EPOLLIN;
-    event_socket.data.fd = CONNECTION.sockfd;
-    if (epoll_ctl(EPOLL_FD_SOCKET, EPOLL_CTL_ADD, CONNECTION.sockfd, &event_socket) == -1) {
-        set_error(Error_Internal);
-        perror("ERR: epoll_ctl: socket");
-        return;
-    }
+    event_socket.data.ptr = client;
+    int sockfd = client->connection.sockfd;
 
-    if (epoll_ctl(EPOLL_FD_SOCKET_STDIN, EPOLL_CTL_ADD, CONNECTION.sockfd, &event_socket) == -1) {
+    if (epoll_ctl(EPOLL_FD_SOCKET, EPOLL_CTL_ADD, sockfd, &event_socket) == -1
+            || epoll_ctl(EPOLL_FD_SOCKET_STDIN, EPOLL_CTL_ADD, sockfd, &event_socket) == -1) {
         set_error(Error_Internal);
         perror("ERR: epoll_ctl: socket");
         return;
     }
+}
 
+/// Close the connection of a finished session, closing the socket removes it from the epolls
+void client_close(struct client *client) {
+    connection_close(&client->connection);
+    free(client->outgoing.items);
+    client->outgoing.items = NULL;
+    client->outgoing.len = 0;
+    client->outgoing.cap = 0;
+    client->closed = true;
+    CLIENTS_OPEN -= 1;
 }
 
 void client_shutdown() {
     log("Shutting down");
+    output_flush();
     close(EPOLL_FD_SOCKET);
     close(EPOLL_FD_SOCKET_STDIN);
-    bit_field_free(&RECEIVED_ID);
-    connection_close(&CONNECTION);
+
+    for (size_t i = 0; i < CLIENT_COUNT; i++) {
+        if (!CLIENTS[i].closed) client_close(&CLIENTS[i]);
+    }
+
+    free(CLIENTS);
     command_clean_up();
 }
 
-bool client_handle_timeout() {
-    if (++CURRENT_PAYLOAD.retry_count > CONNECTION.args.udp_retransmissions) {
-        /// Consider disconnected
-        STATE = State_End;
-        return true;
+/// SIGINT says goodbye in every session, a session that has not sent anything yet just ends
+void client_interrupt() {
+    for (size_t i = 0; i < CLIENT_COUNT; i++) {
+        struct client *client = &CLIENTS[i];
+
+        if (client->state == State_Start) {
+            client->state = State_End;
+        } else if (client->state != State_End) {
+            client_send(client, PayloadType_Bye, NULL);
+            client->state = State_End;
+        }
+    }
+}
+
+/// Retransmit the payloads of a session and close it once it is finished
+void client_update(struct client *client) {
+    if (client->closed) return;
+
+    if (client_handle_timeout(client)) {
+        // The server has not confirmed a payload, consider it disconnected
+        client->outgoing.len = 0;
+    }
+
+    if (client->state == State_Error && client->outgoing.len == 0) {
+        client_send(client, PayloadType_Bye, NULL);
+        client->state = State_End;
+    }
+
+    if (client->state == State_End && client->outgoing.len == 0) {
+        client_close(client);
+    }
+}
+
+/// The n-th outgoing payload
+struct outgoing_payload *client_outgoing(struct client *client, size_t n) {
+    return &client->outgoing.items[(client->outgoing.head + n) & (client->outgoing.cap - 1)];
+}
+
+/// Only MSG payloads may overtake each other, the others wait for everything sent before them
+bool client_is_barrier(const Payload *payload) {
+    return payload->type != PayloadType_Message;
+}
+
+int client_next_timeout() {
+    int timeout = -1;
+
+    for (size_t c = 0; c < CLIENT_COUNT; c++) {
+        struct client *client = &CLIENTS[c];
+
+        for (size_t i = 0; i < client->outgoing.len; i++) {
+            struct outgoing_payload *it = client_outgoing(client, i);
+            if (!it->sent || it->confirmed) continue;
+
+            int remaining = it->timeout - timestamp_elapsed(it->timestamp);
+            /// Very rare case but better safe than sorry
+            if (remaining < 0) remaining = 0;
+            if (timeout < 0 || remaining < timeout) timeout = remaining;
+        }
     }
-    
-    CONNECTION.send(&CONNECTION, CURRENT_PAYLOAD.payload);
-    CURRENT_PAYLOAD.timestamp = timestamp_now();
+
+    return timeout;
+}
+
+bool client_handle_timeout(struct client *client) {
+    // The timer backs off once per expiry however many payloads it retransmits (RFC 6298, 5.5)
+    int backoff = -1;
+
+    for (size_t i = 0; i < client->outgoing.len; i++) {
+        struct outgoing_payload *it = client_outgoing(client, i);
+        if (!it->sent || it->confirmed) continue;
+        if (timestamp_elapsed(it->timestamp) < it->timeout) continue;
+
+        if (++it->retry_count > client->connection.args.udp_retransmissions) {
+            /// Consider disconnected
+            client->state = State_End;
+            return true;
+        }
+
+        logfmt("Retransmitting %u", it->payload.id);
+        PayloadView view = payload_view(&it->payload);
+        client->connection.send(&client->connection, &view);
+        if (backoff < 0) backoff = rto_backoff(&client->rto);
+
+        it->timestamp = timestamp_now();
+        it->timeout = backoff;
+        error_clear();
+    }
+
     return false;
 }
 
-void client_handle_socket() {
+void client_confirm(struct client *client, MessageID id) {
+    struct outgoing *outgoing = &client->outgoing;
+
+    for (size_t i = 0; i < outgoing->len; i++) {
+        struct outgoing_payload *it = client_outgoing(client, i);
+
+        if (it->sent && !it->confirmed && it->payload.id == id) {
+            it->confirmed = true;
+
+            // Karn's rule, the CONFIRM of a retransmitted payload may belong to any of its copies
+            if (it->retry_count == 0) {
+                rto_sample(&client->rto, timestamp_elapsed(it->timestamp));
+            }
+
+            log("Confirmed");
+            break;
+        }
+    }
+
+    // The window slides over the confirmed payloads at its beginning
+    while (outgoing->len && client_outgoing(client, 0)->confirmed) {
+        outgoing->head = (outgoing->head + 1) & (outgoing->cap - 1);
+        outgoing->len -= 1;
+    }
+
+    client_send_queued(client);
+}
+
+void client_handle_socket(struct client *client) {
+    if (client->connection.args.mode == Mode_UDP) {
+        client_handle_datagrams(client);
+        return;
+    }
+
+    // A single read may bring several payloads, handle all of them before polling again
+    do {
+        PayloadView payload = client->connection.receive(&client->connection);
+        client_handle_payload(client, &payload);
+    } while (client->state != State_End && client->state != State_Error && client->connection.pending(&client->connection));
+}
+
+void client_handle_datagrams(struct client *client) {
+    PayloadView payloads[UDP_BATCH_MAX];
+    Error errors[UDP_BATCH_MAX];
+    MessageID confirms[UDP_BATCH_MAX];
+    size_t confirm_count = 0;
+
+    size_t count = udp_receive_batch(&client->connection, payloads, errors, UDP_BATCH_MAX);
+
+    if (get_error()) {
+        // Let the payload handler deal with the error
+        client_handle_payload(client, &payloads[0]);
+        return;
+    }
+
+    // Everything is confirmed on arrival, whatever the state of the payloads sent by the client,
+    // so the server never has to retransmit a payload just because ours has not been confirmed yet
+    for (size_t i = 0; i < count; i++) {
+        if (errors[i] != Error_RecvFromWrongAddress && payloads[i].type != PayloadType_Confirm) {
+            confirms[confirm_count++] = payloads[i].id;
+        }
+    }
+
+    log("Sending confirm");
+    udp_confirm_batch(&client->connection, confirms, confirm_count);
+
+    // The server retransmits the payloads whose CONFIRM has been lost
+    error_clear();
+
+    for (size_t i = 0; i < count; i++) {
+        set_error(errors[i]);
+        client_handle_payload(client, &payloads[i]);
+    }
+}
+
+/// Tell the server that its payload could not be processed, then end the session
+void client_send_malformed(struct client *client) {
+    PayloadData data = {0};
+    memcpy(data.err.display_name, client->display_name, DISPLAY_NAME_LEN + 1);
+    strcpy((void *)data.err.message_content, "Received malformed payload");
+    client_send(client, PayloadType_Err, &data);
+    client->state = State_Error;
+}
+
+void client_handle_payload(struct client *client, const PayloadView *payload) {
     log("Start handling incoming packet");
-    Payload payload = CONNECTION.receive(&CONNECTION);
 
-    if (get_error() == Error_RecvFromWrongAddress) {
+    if (get_error() == Error_RecvFromWrongAddress || get_error() == Error_NoPayload) {
         // Just ignore it
         error_clear();
         return;
     }
 
-    if (payload.type != PayloadType_Confirm) {
-        if (!CURRENT_PAYLOAD.confirmed) {
-            /// Wait for CONFIRM first if the last payload was not confirmed
-            return;
-        }
-
-        log("Sending confirm");
-        Payload confirm;
-        confirm.type = PayloadType_Confirm;
-        confirm.id = payload.id;
-        CONNECTION.send(&CONNECTION, confirm);
+    if (get_error() == Error_Connection) {
+        // There is nobody to send the ERR or BYE to
+        error_clear();
+        client->state = State_End;
+        client->outgoing.len = 0;
+        return;
     }
 
     if (get_error()) {
         error_clear();
-        eprint("Received malformed payload");
-        PayloadData data = {0};
-        memcpy(data.err.display_name, DISPLAY_NAME, DISPLAY_NAME_LEN + 1);
-        strcpy((void *)data.err.message_content, "Received malformed payload");
-        client_send(PayloadType_Err, &data);
-        STATE = State_Error;
+        output_error(client->index, "Received malformed payload");
+        client_send_malformed(client);
         return;
     }
 
 
-    if (payload.type != PayloadType_Confirm) {
-        if (CONNECTION.args.mode == Mode_UDP && bit_field_contains(&RECEIVED_ID, payload.id)) {
+    if (payload->type != PayloadType_Confirm) {
+        if (client->connection.args.mode == Mode_UDP && replay_window_contains(&client->received_ids, payload->id)) {
             log("Received duplicated packed");
             return;
         }
 
-        bit_field_insert(&RECEIVED_ID, payload.id);
+        replay_window_insert(&client->received_ids, payload->id);
     }
 
-    switch (payload.type) {
+    switch (payload->type) {
         case PayloadType_Confirm:
-            logfmt("Confirming %u", payload.id);
-            if (payload.id == CURRENT_PAYLOAD.payload.id) {
-                CURRENT_PAYLOAD.confirmed = true;
-                CURRENT_PAYLOAD.retry_count = 0;
-                log("Confirmed");
-            }
+            logfmt("Confirming %u", payload->id);
+            client_confirm(client, payload->id);
             return;
 
         case PayloadType_Auth:
-        case PayloadType_Join: {
+        case PayloadType_Join:
             /// Error state, send the ERR then go to the End state immediately.
-            PayloadData data = {0};
-            memcpy(data.err.display_name, DISPLAY_NAME, DISPLAY_NAME_LEN + 1);
-            strcpy((void *)data.err.message_content, "Received malformed payload");
-            client_send(PayloadType_Err, &data);
-            STATE = State_Error;
+            client_send_malformed(client);
             break;
-        }
 
         case PayloadType_Reply:
-            if (STATE != State_Auth && STATE != State_Open) {
+            if (client->state != State_Auth && client->state != State_Open) {
                 return;
             }
 
-            logfmt("Got reply to %d", payload.data.reply.ref_message_id);
+            logfmt("Got reply to %d", payload->ref_message_id);
 
-            if (payload.data.reply.result) {
-                fprintf(stderr, "Success: ");
-                STATE = State_Open;
+            if (payload->result) {
+                client->state = State_Open;
             } else {
-                fprintf(stderr, "Failure: ");
-                if (STATE == State_Auth) STATE = State_NotAuth;
+                if (client->state == State_Auth) client->state = State_NotAuth;
             }
 
-            fprintf(stderr, "%s\n", payload.data.reply.message_content);
-            fflush(stderr);
+            output_payload(client->index, payload);
             break;
 
         case PayloadType_Message:
-            printf("%s: %s\n", payload.data.message.display_name, payload.data.message.message_content);
+            output_payload(client->index, payload);
             break;
 
         case PayloadType_Err:
-            fprintf(stderr, "ERR FROM %s: %s\n", payload.data.err.display_name, payload.data.err.message_content);
-            client_send(PayloadType_Bye, NULL);
-            STATE = State_End;
+            output_payload(client->index, payload);
+            client_send(client, PayloadType_Bye, NULL);
+            client->state = State_End;
             break;
 
         case PayloadType_Bye:
-            if (STATE != State_Open) {
-                client_send(PayloadType_Bye, NULL);
+            output_payload(client->index, payload);
+
+            if (client->state != State_Open) {
+                client_send(client, PayloadType_Bye, NULL);
             }
 
-            STATE = State_End;
+            client->state = State_End;
 
             break;
     }
 }
 
+/// The session takes no input while waiting for the REPLY to AUTH or while the window is full
+bool client_takes_input(struct client *client) {
+    return client->state != State_Auth
+        && client->state != State_End
+        && client->outgoing.len < client->connection.args.udp_window;
+}
+
+/// Stdin is read until a line has to wait for its session, the held line stays in the input buffer
+bool client_takes_stdin() {
+    return !HELD_LINE && !INPUT.eof;
+}
+
 void client_handle_input() {
     log("Start handling user input");
-    Bytes buffer = bytes_new();
-    int result = readLineStdin(&buffer);
 
-    if (result == EOF) {
-        // shutdown
-        client_send(PayloadType_Bye, NULL);
-        STATE = State_End;
-        return;
+    // A single read per wakeup, the descriptor is readable so it does not block
+    input_read(&INPUT, STDIN_FILENO);
+    client_handle_lines();
+}
+
+/// The session a line is meant for, with several sessions the line starts with the number of its session
+struct client *client_route(const uint8_t *line, const uint8_t **rest) {
+    if (CLIENT_COUNT == 1) {
+        *rest = line;
+        return &CLIENTS[0];
     }
 
-    if (result == 0) {
-        return;
+    size_t index = 0;
+    const uint8_t *it = line;
+
+    while (*it >= '0' && *it <= '9' && index < CLIENT_COUNT) {
+        index = index * 10 + (*it++ - '0');
+    }
+
+    if (it == line || *it != ' ' || index >= CLIENT_COUNT) {
+        return NULL;
+    }
+
+    *rest = it + 1;
+    return &CLIENTS[index];
+}
+
+void client_handle_lines() {
+    while (true) {
+        if (!HELD_LINE) {
+            const uint8_t *line;
+            size_t len;
+
+            if (!input_next_line(&INPUT, &line, &len)) {
+                if (INPUT.eof) client_end_input();
+                return;
+            }
+
+            if (get_error()) {
+                output_error(-1, "Cannot parse the input");
+                error_clear();
+                continue;
+            }
+
+            if (!len) continue;
+
+            HELD_CLIENT = client_route(line, &HELD_LINE);
+
+            if (!HELD_CLIENT) {
+                output_error(-1, "The line does not start with the number of a session");
+                continue;
+            }
+        }
+
+        if (HELD_CLIENT->state == State_End) {
+            // The session is over, nobody takes the line
+            HELD_LINE = NULL;
+            continue;
+        }
+
+        if (!client_takes_input(HELD_CLIENT)) return;
+
+        const uint8_t *line = HELD_LINE;
+        HELD_LINE = NULL;
+        if (*line) client_handle_line(HELD_CLIENT, line);
     }
+}
+
+/// The end of stdin ends every session as soon as it takes input
+void client_end_input() {
+    for (size_t i = 0; i < CLIENT_COUNT; i++) {
+        struct client *client = &CLIENTS[i];
+        if (!client_takes_input(client)) continue;
+
+        client_send(client, PayloadType_Bye, NULL);
+        client->state = State_End;
+    }
+}
 
-    Command cmd = command_parse(bytes_get(&buffer));
+void client_handle_line(struct client *client, const uint8_t *line) {
+    Command cmd = command_parse(line);
 
     if (get_error()) {
-        eprint("Cannot parse the input");
+        output_error(client->index, "Cannot parse the input");
         error_clear();
         return;
     }
 
     switch (cmd.type) {
         case CommandType_None: {
-            if (STATE != State_Open) {
-                eprint("You have to join a channel first before sending messages. "
-                       "Use /help for more information.\n");
+            if (client->state != State_Open) {
+                output_error(client->index, "You have to join a channel first before sending messages. "
+                                            "Use /help for more information.\n");
                 break;
             }
 
-            PayloadData data = {0};
-            memcpy(data.message.display_name, DISPLAY_NAME, DISPLAY_NAME_LEN + 1);
-            strcpy((void *)data.message.message_content, (void *)cmd.data.message);
+            // The content is still in the input buffer, it is written from there
+            PayloadView view = {0};
+            view.type = PayloadType_Message;
+            view.id = client->next_message_id++;
+            view.display_name.data = client->display_name;
+            view.display_name.len = strlen((char *)client->display_name);
+            view.message_content = cmd.data.message;
 
-            client_send(PayloadType_Message, &data);
-            printf("%s: %s\n", DISPLAY_NAME, data.message.message_content);
+            client_send_view(client, &view);
+            output_sent(client->index, client->display_name, view.message_content);
             break;
         }
 
         case CommandType_Auth: {
-            if (STATE != State_Start && STATE != State_NotAuth) {
-                eprint("You have been authenticated. No need to do it again\n");
+            if (client->state != State_Start && client->state != State_NotAuth) {
+                output_error(client->index, "You have been authenticated. No need to do it again\n");
                 break;
             }
 
-            memcpy(DISPLAY_NAME, cmd.data.auth.display_name, DISPLAY_NAME_LEN + 1);
+            memcpy(client->display_name, cmd.data.auth.display_name, DISPLAY_NAME_LEN + 1);
 
             PayloadData data = {0};
-            memcpy(data.auth.display_name, DISPLAY_NAME, DISPLAY_NAME_LEN + 1);
+            memcpy(data.auth.display_name, client->display_name, DISPLAY_NAME_LEN + 1);
             memcpy(data.auth.username, cmd.data.auth.username, USERNAME_LEN + 1);
             memcpy(data.auth.secret, cmd.data.auth.secret, SECRET_LEN + 1);
 
-            client_send(PayloadType_Auth, &data);
-            STATE = State_Auth;
+            client_send(client, PayloadType_Auth, &data);
+            client->state = State_Auth;
             break;
         }
 
         case CommandType_Join: {
-            if (STATE != State_Open) {
-                eprint("Use /auth to authenticate first before joining a channel. "
-                       "Use /help for more information.\n");
+            if (client->state != State_Open) {
+                output_error(client->index, "Use /auth to authenticate first before joining a channel. "
+                                            "Use /help for more information.\n");
                 break;
             }
 
             PayloadData data = {0};
-            memcpy(data.join.display_name, DISPLAY_NAME, DISPLAY_NAME_LEN + 1);
+            memcpy(data.join.display_name, client->display_name, DISPLAY_NAME_LEN + 1);
             memcpy(data.join.channel_id, cmd.data.join.channel_id, CHANNEL_ID_LEN + 1);
 
-            client_send(PayloadType_Join, &data);
+            client_send(client, PayloadType_Join, &data);
             break;
         }
 
         case CommandType_Rename:
-            memcpy(DISPLAY_NAME, cmd.data.rename.display_name, DISPLAY_NAME_LEN + 1);
+            memcpy(client->display_name, cmd.data.rename.display_name, DISPLAY_NAME_LEN + 1);
             break;
 
         case CommandType_Help:
-            printf("%s", CHAT_HELP_MESSAGE);
+            output_notice(CHAT_HELP_MESSAGE);
             break;
 
         case CommandType_Clear:
-            printf("\033\143");
-            fflush(stdout);
+            // The escape sequence would end up among the records of the formats for bots
+            if (client->connection.args.format == Format_Text) output_notice("\033\143");
             break;
 
         case CommandType_Exit:
-            STATE = State_End;
-            client_send(PayloadType_Bye, NULL);
+            client->state = State_End;
+            client_send(client, PayloadType_Bye, NULL);
             break;
 
     }
 }
 
-void client_send(PayloadType type, PayloadData *data) {
-    CURRENT_PAYLOAD.payload = payload_new(type, data);
-    CONNECTION.send(&CONNECTION, CURRENT_PAYLOAD.payload);
-    
+/// Send the ERR telling the server that a payload could not be sent
+Payload client_send_failure(struct client *client) {
+    PayloadData data;
+    strcpy((void *)data.err.display_name, (char *)client->display_name);
+    strcpy((void *)data.err.message_content, "Something went wrong when trying to send payload");
+    Payload payload = payload_new(PayloadType_Err, client->next_message_id++, &data);
+
+    PayloadView view = payload_view(&payload);
+    client->connection.send(&client->connection, &view);
+    client->state = State_Error;
+
+    /// If error still occur, then just terminate the session
     if (get_error()) {
-        error_clear();
-        PayloadData data;
-        strcpy((void *)data.err.display_name, (char *)DISPLAY_NAME);
-        strcpy((void *)data.err.message_content, "Something went wrong when trying to send payload");
-        CURRENT_PAYLOAD.payload = payload_new(PayloadType_Err, &data);
-        CONNECTION.send(&CONNECTION, CURRENT_PAYLOAD.payload);
-        STATE = State_Error;
-    }
-    
-    /// If error still occur, then just terminate the programk
+        client->state = State_End;
+        client->outgoing.len = 0;
+    }
+
+    return payload;
+}
+
+/// Send the payload, replacing it by ERR if it cannot be sent
+void client_transmit(struct client *client, struct outgoing_payload *it) {
+    PayloadView view = payload_view(&it->payload);
+    client->connection.send(&client->connection, &view);
+
     if (get_error()) {
-        STATE = State_End;
+        error_clear();
+        it->payload = client_send_failure(client);
+        if (get_error()) return;
+    }
+
+    it->sent = true;
+    it->retry_count = 0;
+    it->timeout = client->rto.rto;
+    it->timestamp = timestamp_now();
+}
+
+void client_send(struct client *client, PayloadType type, PayloadData *data) {
+    Payload payload = payload_new(type, client->next_message_id++, data);
+    PayloadView view = payload_view(&payload);
+    client_send_view(client, &view);
+}
+
+void client_send_view(struct client *client, const PayloadView *view) {
+    struct outgoing *outgoing = &client->outgoing;
+
+    if (client->connection.args.mode == Mode_TCP) {
+        // Nothing to be confirmed, the fields are written right from where they are
+        client->connection.send(&client->connection, view);
+
+        if (get_error()) {
+            error_clear();
+            client_send_failure(client);
+        }
+
         return;
     }
 
-    CURRENT_PAYLOAD.confirmed = CONNECTION.args.mode == Mode_TCP;
-    CURRENT_PAYLOAD.timestamp = timestamp_now();
+    if (outgoing->len == outgoing->cap) {
+        size_t cap = outgoing->cap ? outgoing->cap * 2 : 8;
+        struct outgoing_payload *items = malloc(cap * sizeof(struct outgoing_payload));
+
+        if (!items) {
+            output_error(client->index, "Cannot allocate memory for the payload");
+            client->state = State_End;
+            return;
+        }
+
+        for (size_t i = 0; i < outgoing->len; i++) {
+            items[i] = *client_outgoing(client, i);
+        }
+
+        free(outgoing->items);
+        outgoing->items = items;
+        outgoing->head = 0;
+        outgoing->cap = cap;
+    }
+
+    // The only copy of the fields, the payload is kept until it is confirmed
+    struct outgoing_payload *it = client_outgoing(client, outgoing->len++);
+    payload_from_view(&it->payload, view);
+    it->sent = false;
+    it->confirmed = false;
+
+    client_send_queued(client);
+}
+
+void client_send_queued(struct client *client) {
+    struct outgoing *outgoing = &client->outgoing;
+    size_t in_flight = 0;
+    bool barrier = false;
+
+    for (size_t i = 0; i < outgoing->len; i++) {
+        struct outgoing_payload *it = client_outgoing(client, i);
+        if (it->confirmed) continue;
+
+        if (!it->sent) {
+            bool blocked = barrier
+                || in_flight >= client->connection.args.udp_window
+                || (in_flight && client_is_barrier(&it->payload));
+
+            if (blocked) break;
+
+            client_transmit(client, it);
+            if (!outgoing->len) return;
+
+            if (it->payload.type == PayloadType_Err && client->state == State_Error) {
+                // Nothing is sent after the ERR
+                outgoing->len = i + 1;
+            }
+        }
+
+        in_flight += 1;
+        barrier = barrier || client_is_barrier(&it->payload);
+    }
 }
@@ -7,6 +7,7 @@
 
 #include "commands.h"
 #include "error.h"
+#include "scan.h"
 #include "trie.h"
 #include <string.h>
 
@@ -48,72 +49,84 @@ Command command_parse(const uint8_t *str) {
     logfmt("Parsing %s", str);
     Command cmd = {0};
 
-    Bytes buffer = bytes_new();
-    bytes_push_c_str(&buffer, (const char *)str);
-    bytes_trim(&buffer, ' ');
+    // The string is parsed where it is, trimming only moves the bounds
+    const uint8_t *data = str;
+    size_t len = strlen((const char *)str);
 
-    if (buffer.len <= 0) {
+    while (len && data[len - 1] == ' ') len -= 1;
+    while (len && *data == ' ') {
+        data += 1;
+        len -= 1;
+    }
+
+    if (len == 0) {
         set_error(Error_InvalidInput);
         return cmd;
     }
 
-    const uint8_t *slice = bytes_get(&buffer);
-
-    int maybe_command = *slice == '/' ? trie_match_prefix(COMMAND_TRIE, slice + 1) : -1;
+    int maybe_command = *data == '/' ? trie_match_prefix(COMMAND_TRIE, data + 1) : -1;
     cmd.type = maybe_command <= 0 ? CommandType_None : maybe_command;
 
-    int cmd_offset = command_prefix_length(cmd.type);
+    size_t cmd_offset = command_prefix_length(cmd.type);
 
-    // set the bytes offset based of the command
-    if (slice[cmd_offset] == ' ') {
-        bytes_skip_first_n(&buffer, cmd_offset + 1);
-    } else if (slice[cmd_offset] == 0) {
-        bytes_skip_first_n(&buffer, cmd_offset);
-    } else {
+    // set the offset based of the command
+    if (cmd_offset < len && data[cmd_offset] == ' ') {
+        cmd_offset += 1;
+    } else if (cmd_offset != len) {
         cmd.type = CommandType_None;
+        cmd_offset = 0;
     }
 
+    data += cmd_offset;
+    len -= cmd_offset;
+
     logfmt("Got command type %u", cmd.type);
-    int read = 0;
+    size_t read = 0;
 
-    /// Macro to read next data into the buffer
-    #define READ(select, buf) \
-        read = read_##buf(cmd.data.select.buf, &buffer); \
-        if (read <= 0) { \
+    /// Macro to take the next field, it is copied as the arguments are kept after the input is gone
+    #define READ(select, buf, limit, validator) \
+        read = validator(data, len); \
+        if (read == 0 || read > limit) { \
             set_error(Error_InvalidInput); \
             return cmd; \
         } \
-        bytes_skip_first_n(&buffer, read)
+        memcpy(cmd.data.select.buf, data, read); \
+        data += read; \
+        len -= read
 
     /// Macro to skip the next SP character, raise error if next character is not whitespace
     #define SKIP_SPACE() \
-        if (*bytes_get(&buffer) != ' ') { \
+        if (!len || *data != ' ') { \
             set_error(Error_InvalidInput); \
             return cmd; \
         } \
-        bytes_skip_first_n(&buffer, 1)
+        data += 1; \
+        len -= 1
 
     switch (cmd.type) {
         case CommandType_None:
-            read = read_message_content(cmd.data.message, &buffer);
-            if (read <= 0) { 
-                set_error(Error_InvalidInput); 
-                return cmd; 
-            } 
-            bytes_skip_first_n(&buffer, read);
-
+            read = scan_message_content(data, len);
+            if (read == 0 || read > MESSAGE_CONTENT_LEN) {
+                set_error(Error_InvalidInput);
+                return cmd;
+            }
+
+            cmd.data.message.data = data;
+            cmd.data.message.len = read;
+            data += read;
+            len -= read;
             break;
 
         case CommandType_Auth:
-            READ(auth, username); SKIP_SPACE();
-            READ(auth, secret); SKIP_SPACE();
-            READ(auth, display_name);
+            READ(auth, username, USERNAME_LEN, scan_id); SKIP_SPACE();
+            READ(auth, secret, SECRET_LEN, scan_id); SKIP_SPACE();
+            READ(auth, display_name, DISPLAY_NAME_LEN, scan_display_name);
             break;
         case CommandType_Join:
-            READ(join, channel_id);
+            READ(join, channel_id, CHANNEL_ID_LEN, scan_id);
             break;
         case CommandType_Rename:
-            READ(rename, display_name);
+            READ(rename, display_name, DISPLAY_NAME_LEN, scan_display_name);
             break;
 
         case CommandType_Help:
@@ -123,7 +136,7 @@ Command command_parse(const uint8_t *str) {
             break;
     }
 
-    if (buffer.len != 0) {
+    if (len != 0) {
         set_error(Error_InvalidInput);
     }
 
@@ -40,7 +40,7 @@ typedef struct {
 typedef struct {
     CommandType type;
     union {
-        MessageContent message;
+        PayloadSlice message; /*< the message is not copied, it references the parsed string */
         CommandAuthData auth;
         CommandJoinData join;
         CommandRenameData rename;
@@ -52,6 +52,7 @@ void command_setup();
 void command_clean_up();
 
 /// Take in a null terminaated string and return the Command
+/// the message of the Command references the string, so the string has to outlive it
 /// this may set error into `InvalidInput`
 Command command_parse(const uint8_t *str);
 
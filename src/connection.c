@@ -16,9 +16,9 @@
 #include <unistd.h>
 #include <fcntl.h>
 
-Connection connection_init(Args args) {
-    Connection conn;
-    conn.args = args;
+void connection_init(Connection *conn, Args args) {
+    conn->args = args;
+    framer_init(&conn->framer);
 
     int family = AF_INET;
     int type = 0;
@@ -26,33 +26,35 @@ Connection connection_init(Args args) {
     switch (args.mode) {
         case Mode_UDP:
             type = SOCK_DGRAM;
-            conn.connect = udp_connect;
-            conn.send = udp_send;
-            conn.receive = udp_receive;
-            conn.disconnect = udp_disconnect;
+            conn->connect = udp_connect;
+            conn->send = udp_send;
+            conn->receive = udp_receive;
+            conn->pending = udp_pending;
+            conn->disconnect = udp_disconnect;
             break;
         case Mode_TCP:
             type = SOCK_STREAM;
-            conn.connect = tcp_connect;
-            conn.send = tcp_send;
-            conn.receive = tcp_receive;
-            conn.disconnect = tcp_disconnect;
+            conn->connect = tcp_connect;
+            conn->send = tcp_send;
+            conn->receive = tcp_receive;
+            conn->pending = tcp_pending;
+            conn->disconnect = tcp_disconnect;
             break;
     }
 
-    conn.sockfd = socket(family, type, 0);
+    conn->sockfd = socket(family, type, 0);
 
-    if (conn.sockfd <= 0) {
+    if (conn->sockfd <= 0) {
         eprint("cannot create socket");
         set_error(Error_Socket);
-        return conn;
+        return;
     }
 
-    int flags = fcntl(conn.sockfd, F_GETFL, 0);
-    if (fcntl(conn.sockfd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    int flags = fcntl(conn->sockfd, F_GETFL, 0);
+    if (fcntl(conn->sockfd, F_SETFL, flags | O_NONBLOCK) < 0) {
         eprint("cannot set socket to be non-blocking");
         set_error(Error_Socket);
-        return conn;
+        return;
     }
 
 
@@ -67,15 +69,13 @@ Connection connection_init(Args args) {
     char port[6];
     sprintf(port, "%d", args.port);
 
-    int result = getaddrinfo(args.host, port, &hints, &conn.address_info);
+    int result = getaddrinfo(args.host, port, &hints, &conn->address_info);
 
     if (result != 0) {
         eprintf("Cannot get the address info of %s", args.host);
         set_error(Error_Connection);
-        return conn;
+        return;
     }
-
-    return conn;
 }
 
 void connection_close(Connection *conn) {
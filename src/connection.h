@@ -9,10 +9,14 @@
 #define CONNECTION_H
 
 #include "args.h"
+#include "framer.h"
 #include "payload.h"
 #include <stdint.h>
 #include <sys/socket.h>
 
+/// Number of datagrams a UDP connection receives at once
+#define CONNECTION_DATAGRAMS 32
+
 /**
  * @brief Structure representing a connection to the server.
  */
@@ -27,16 +31,23 @@ typedef void (*ConnectFunc)(Connection *connection);
 /**
  * @brief Function pointer type for sending a payload to the server.
  * @param connection Pointer to the Connection structure representing the connection.
- * @param payload The payload to send.
+ * @param payload Pointer to the payload to send, its fields are written from where they are.
  */
-typedef void (*SendFunc)(Connection *connection, Payload payload);
+typedef void (*SendFunc)(Connection *connection, const PayloadView *payload);
 
 /**
  * @brief Function pointer type for receiving a payload from the server.
  * @param connection Pointer to the Connection structure representing the connection.
- * @return The received payload.
+ * @return The received payload, referencing the receive buffer of the connection until the next receive.
+ */
+typedef PayloadView (*ReceiveFunc)(Connection *connection);
+
+/**
+ * @brief Function pointer type for checking whether a received payload is waiting to be handled.
+ * @param connection Pointer to the Connection structure representing the connection.
+ * @return true if the next receive is going to return a payload without reading from the socket.
  */
-typedef Payload (*ReceiveFunc)(Connection *connection);
+typedef bool (*PendingFunc)(Connection *connection);
 
 /**
  * @brief Function pointer type for disconnecting from the server.
@@ -52,19 +63,25 @@ struct Connection {
     Args args; /**< Application arguments. */
     int sockfd; /**< Socket file descriptor for the connection. */
     struct addrinfo *address_info; /**< Info about host address. */
+    Framer framer; /**< Received part of the TCP stream, unused in UDP. */
+    uint8_t datagrams[CONNECTION_DATAGRAMS][BYTES_SIZE]; /**< Received UDP datagrams, unused in TCP. */
 
     ConnectFunc connect; /**< Function pointer for connecting to the server. */
     SendFunc send; /**< Function pointer for sending data to the server. */
     ReceiveFunc receive; /**< Function pointer for receiving data from the server. */
+    PendingFunc pending; /**< Function pointer for checking whether received data hold another payload. */
     DisconnectFunc disconnect; /**< Function pointer for disconnecting from the server. */
 };
 
 /**
  * @brief Initialize a Connection object with the given arguments.
+ *
+ * The object is initialized in place, its receive buffers are not touched until something is received into them.
+ *
+ * @param conn Pointer to the Connection object to initialize.
  * @param args Arguments containing connection information.
- * @return Initialized Connection object.
  */
-Connection connection_init(Args args);
+void connection_init(Connection *conn, Args args);
 
 /**
  * @brief Close a Connection object.
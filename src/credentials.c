@@ -0,0 +1,300 @@
+/**
+ * @file credentials.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of credentials.h
+ */
+
+#include "credentials.h"
+#include "error.h"
+#include "payload.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// Number of slots of the smallest index
+#define CREDENTIALS_MIN_SLOTS 16
+
+/// FNV-1a
+static uint64_t credentials_hash(const uint8_t *username) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (; *username; username++) {
+        hash ^= *username;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+Credentials credentials_open(const char *path) {
+    Credentials credentials = {0};
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        perror("ERR: Cannot open the credential index");
+        set_error(Error_InvalidArgument);
+        return credentials;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(CredentialsHeader)) {
+        eprintf("%s is not a credential index", path);
+        set_error(Error_InvalidArgument);
+        close(fd);
+        return credentials;
+    }
+
+    void *map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        perror("ERR: Cannot map the credential index");
+        set_error(Error_InvalidArgument);
+        return credentials;
+    }
+
+    const CredentialsHeader *header = map;
+    size_t size = info.st_size;
+    size_t slots_size = size - sizeof(CredentialsHeader);
+
+    // Only the sizes are checked here, a record is checked when it is looked up
+    if (memcmp(header->magic, CREDENTIALS_MAGIC, sizeof(header->magic)) != 0
+        || !header->slot_count
+        || (header->slot_count & (header->slot_count - 1))
+        || header->slot_count > slots_size / sizeof(CredentialsSlot)
+        || header->heap_size != slots_size - header->slot_count * sizeof(CredentialsSlot)
+    ) {
+        eprintf("%s is not a valid credential index", path);
+        set_error(Error_InvalidArgument);
+        munmap(map, size);
+        return credentials;
+    }
+
+    credentials.map = map;
+    credentials.size = size;
+    credentials.header = header;
+    credentials.slots = (const CredentialsSlot *)(header + 1);
+    credentials.heap = (const uint8_t *)(credentials.slots + header->slot_count);
+
+    // Lookups jump around the table
+    madvise(map, size, MADV_RANDOM);
+
+    return credentials;
+}
+
+void credentials_close(Credentials *credentials) {
+    if (credentials->map) {
+        munmap(credentials->map, credentials->size);
+    }
+
+    memset(credentials, 0, sizeof(Credentials));
+}
+
+/// Compare the secrets in time depending only on the stored one, so a guess does not learn how much of it matched
+static bool credentials_secret_equal(const uint8_t *stored, size_t stored_len, const uint8_t *secret, size_t secret_len) {
+    uint8_t diff = stored_len != secret_len;
+
+    for (size_t i = 0; i < stored_len; i++) {
+        // Past its end, the guess is compared by its terminating null byte
+        size_t j = i < secret_len ? i : secret_len;
+        diff |= stored[i] ^ secret[j];
+    }
+
+    return diff == 0;
+}
+
+bool credentials_verify(const Credentials *credentials, const uint8_t *username, const uint8_t *secret) {
+    if (!credentials->map) return false;
+
+    uint64_t hash = credentials_hash(username);
+    uint64_t mask = credentials->header->slot_count - 1;
+    size_t username_len = strlen((void *)username);
+    size_t secret_len = strlen((void *)secret);
+
+    for (uint64_t i = hash & mask, probes = 0; probes <= mask; i = (i + 1) & mask, probes++) {
+        const CredentialsSlot *slot = &credentials->slots[i];
+
+        if (!slot->len) return false;
+        if (slot->hash != hash || slot->len < username_len + 3) continue;
+
+        // Do not trust the file more than necessary
+        if ((uint64_t)slot->offset + slot->len > credentials->header->heap_size) return false;
+
+        const uint8_t *record = credentials->heap + slot->offset;
+        if (memcmp(record, username, username_len + 1) != 0) continue;
+
+        return credentials_secret_equal(record + username_len + 1, slot->len - username_len - 2, secret, secret_len);
+    }
+
+    return false;
+}
+
+/// Parse `username:secret` of a line, returns false if the line is malformed
+static bool credentials_parse_line(char *line, Username username, Secret secret) {
+    char *colon = strchr(line, ':');
+    if (!colon) return false;
+
+    *colon = 0;
+    size_t username_len = strlen(line);
+    size_t secret_len = strlen(colon + 1);
+
+    Bytes bytes = bytes_new();
+    bytes_push_arr(&bytes, (uint8_t *)line, username_len);
+    if (!username_len || read_username(username, &bytes) != (ssize_t)username_len) return false;
+
+    bytes_clear(&bytes);
+    bytes_push_arr(&bytes, (uint8_t *)colon + 1, secret_len);
+    if (!secret_len || read_secret(secret, &bytes) != (ssize_t)secret_len) return false;
+
+    return true;
+}
+
+/**
+ * @brief Records read from the list, in the same layout as the heap of the index.
+ */
+typedef struct {
+    uint8_t *data; /**< The records. */
+    size_t len; /**< Size of the records in bytes. */
+    size_t cap; /**< Capacity of the data. */
+    size_t count; /**< Number of the records, including the replaced ones. */
+} RecordHeap;
+
+static void credentials_push_record(RecordHeap *heap, const Username username, const Secret secret) {
+    size_t username_len = strlen((void *)username);
+    size_t secret_len = strlen((void *)secret);
+    size_t len = username_len + secret_len + 2;
+
+    if (heap->len + len > UINT32_MAX) {
+        eprint("Too many credentials");
+        set_error(Error_InvalidInput);
+        return;
+    }
+
+    if (heap->len + len > heap->cap) {
+        size_t cap = heap->cap ? heap->cap * 2 : 4096;
+        uint8_t *data = realloc(heap->data, cap);
+
+        if (!data) {
+            set_error(Error_OutOfMemory);
+            return;
+        }
+
+        heap->data = data;
+        heap->cap = cap;
+    }
+
+    memcpy(heap->data + heap->len, username, username_len + 1);
+    memcpy(heap->data + heap->len + username_len + 1, secret, secret_len + 1);
+    heap->len += len;
+    heap->count += 1;
+}
+
+static void credentials_read(FILE *input, RecordHeap *heap) {
+    char *line = NULL;
+    size_t line_cap = 0;
+    size_t line_number = 0;
+    ssize_t line_len;
+
+    while (!get_error() && (line_len = getline(&line, &line_cap, input)) >= 0) {
+        line_number += 1;
+
+        while (line_len && (line[line_len - 1] == '\n' || line[line_len - 1] == '\r')) {
+            line[--line_len] = 0;
+        }
+
+        if (!line_len || line[0] == '#') continue;
+
+        Username username;
+        Secret secret;
+
+        if (!credentials_parse_line(line, username, secret)) {
+            eprintf("Malformed credentials on line %lu, expected username:secret", line_number);
+            set_error(Error_InvalidInput);
+            break;
+        }
+
+        credentials_push_record(heap, username, secret);
+    }
+
+    free(line);
+}
+
+/// Put the records into the hash table, returns the number of unique usernames
+static size_t credentials_fill_slots(const RecordHeap *heap, CredentialsSlot *slots, size_t slot_count) {
+    size_t mask = slot_count - 1;
+    size_t unique_count = 0;
+
+    for (size_t offset = 0; offset < heap->len;) {
+        const uint8_t *username = heap->data + offset;
+        size_t username_len = strlen((void *)username);
+        size_t len = username_len + strlen((void *)(username + username_len + 1)) + 2;
+        uint64_t hash = credentials_hash(username);
+        size_t i = hash & mask;
+
+        while (slots[i].len && (slots[i].hash != hash || strcmp((void *)(heap->data + slots[i].offset), (void *)username) != 0)) {
+            i = (i + 1) & mask;
+        }
+
+        // A later record of the same username replaces the earlier one
+        if (!slots[i].len) unique_count += 1;
+
+        slots[i].hash = hash;
+        slots[i].offset = offset;
+        slots[i].len = len;
+        offset += len;
+    }
+
+    return unique_count;
+}
+
+static size_t credentials_write(FILE *output, const RecordHeap *heap) {
+    size_t slot_count = CREDENTIALS_MIN_SLOTS;
+
+    // Keep the load factor under 1/2 so the probing sequences stay short
+    while (slot_count < heap->count * 2) slot_count *= 2;
+
+    CredentialsSlot *slots = calloc(slot_count, sizeof(CredentialsSlot));
+
+    if (!slots) {
+        set_error(Error_OutOfMemory);
+        return 0;
+    }
+
+    CredentialsHeader header = {0};
+    memcpy(header.magic, CREDENTIALS_MAGIC, sizeof(header.magic));
+    header.slot_count = slot_count;
+    header.record_count = credentials_fill_slots(heap, slots, slot_count);
+    header.heap_size = heap->len;
+
+    if (fwrite(&header, sizeof(header), 1, output) != 1
+        || fwrite(slots, sizeof(CredentialsSlot), slot_count, output) != slot_count
+        || (heap->len && fwrite(heap->data, heap->len, 1, output) != 1)
+        || fflush(output) != 0
+    ) {
+        perror("ERR: Cannot write the credential index");
+        set_error(Error_Internal);
+    }
+
+    free(slots);
+    return header.record_count;
+}
+
+size_t credentials_build(FILE *input, FILE *output) {
+    RecordHeap heap = {0};
+    size_t count = 0;
+
+    // The table is sized after the number of records is known
+    credentials_read(input, &heap);
+
+    if (!get_error()) {
+        count = credentials_write(output, &heap);
+    }
+
+    free(heap.data);
+    return get_error() ? 0 : count;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file credentials.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides the precompiled credential index used by the server to verify AUTH.
+ *
+ * The index is built offline from a plain list of `username:secret` lines and mapped read-only by the server,
+ * so nothing is parsed at startup. The file consists of:
+ * - CredentialsHeader,
+ * - slot_count of CredentialsSlot, an open-addressing hash table of the usernames with linear probing,
+ * - the heap of the records, each record is the null-terminated username followed by the null-terminated secret.
+ *
+ * Integers are stored in the byte order of the machine that built the index.
+ */
+
+#ifndef CREDENTIALS_H
+#define CREDENTIALS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/// Identifies the file format and its version
+#define CREDENTIALS_MAGIC "IPKCRED1"
+
+/**
+ * @brief Header of the index file.
+ */
+typedef struct {
+    char magic[8]; /**< CREDENTIALS_MAGIC without the null terminator. */
+    uint64_t slot_count; /**< Number of slots, always a power of 2. */
+    uint64_t record_count; /**< Number of records. */
+    uint64_t heap_size; /**< Size of the heap of the records in bytes. */
+} CredentialsHeader;
+
+/**
+ * @brief Slot of the hash table, four of them fit into a cache line.
+ */
+typedef struct {
+    uint64_t hash; /**< Hash of the username. */
+    uint32_t offset; /**< Offset of the record in the heap. */
+    uint32_t len; /**< Length of the record, 0 is an empty slot. */
+} CredentialsSlot;
+
+/**
+ * @brief Credential index mapped into the memory.
+ */
+typedef struct {
+    void *map; /**< The whole mapped file, NULL if no index is loaded. */
+    size_t size; /**< Size of the mapped file. */
+    const CredentialsHeader *header; /**< Header of the index. */
+    const CredentialsSlot *slots; /**< Hash table of the usernames. */
+    const uint8_t *heap; /**< Heap of the records. */
+} Credentials;
+
+/**
+ * @brief Map a credential index built by credentials_build into the memory.
+ * @param path Path to the index file.
+ * @return The mapped index.
+ * @note This may set Error_InvalidArgument if the file cannot be opened or is not a valid index.
+ */
+Credentials credentials_open(const char *path);
+
+/**
+ * @brief Unmap the credential index.
+ * @param credentials Pointer to the index.
+ */
+void credentials_close(Credentials *credentials);
+
+/**
+ * @brief Check a username and secret pair against the index.
+ *
+ * The secret is compared in constant time, the time depends only on the length of the stored secret.
+ *
+ * @param credentials Pointer to the index.
+ * @param username Null-terminated username.
+ * @param secret Null-terminated secret.
+ * @return true if the username exists and has the secret, false otherwise.
+ */
+bool credentials_verify(const Credentials *credentials, const uint8_t *username, const uint8_t *secret);
+
+/**
+ * @brief Build a credential index from a list of `username:secret` lines.
+ *
+ * Empty lines and lines starting with `#` are skipped. A later line of the same username replaces the earlier one.
+ *
+ * @param input The list of the credentials.
+ * @param output Where the index is written to.
+ * @return Number of the records in the index.
+ * @note This may set Error_InvalidInput on a malformed line, Error_OutOfMemory or Error_Internal if the index cannot be written.
+ */
+size_t credentials_build(FILE *input, FILE *output);
+
+#endif
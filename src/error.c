@@ -7,7 +7,8 @@
 
 #include "error.h"
 
-Error ERROR;
+/// Each thread of the server has its own error
+_Thread_local Error ERROR;
 
 void set_error(Error error) {
     ERROR = error;
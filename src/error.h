@@ -50,6 +50,7 @@ typedef enum {
     Error_Connection, /**< Connection-related error. */
     Error_InvalidPayload, /**< Invalid payload error. */
     Error_RecvFromWrongAddress, /**< Receive from a server address we are not listening to. */
+    Error_NoPayload, /**< Received data do not complete any payload yet. */
     Error_BadQuery, /**< Bad query error. */
     Error_InvalidInput, /**< Invalid input error. */
     Error_Internal /**< Internal error*/
@@ -0,0 +1,149 @@
+/**
+ * @file framer.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of framer.h
+ */
+
+#include "framer.h"
+#include "error.h"
+#include "scan.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+
+void framer_init(Framer *framer) {
+    framer->head = 0;
+    framer->len = 0;
+    framer->scanned = 0;
+}
+
+/// Position of the n-th buffered byte in the ring
+static size_t framer_index(const Framer *framer, size_t n) {
+    return (framer->head + n) & (FRAMER_SIZE - 1);
+}
+
+static uint8_t framer_byte(const Framer *framer, size_t n) {
+    return framer->data[framer_index(framer, n)];
+}
+
+/// Copy n buffered bytes starting at the given one out of the ring
+static void framer_copy(const Framer *framer, size_t start, uint8_t *dest, size_t n) {
+    size_t index = framer_index(framer, start);
+    size_t first = FRAMER_SIZE - index < n ? FRAMER_SIZE - index : n;
+
+    memcpy(dest, framer->data + index, first);
+    memcpy(dest + first, framer->data, n - first);
+}
+
+/// Drop n bytes from the front of the buffer
+static void framer_consume(Framer *framer, size_t n) {
+    framer->head = framer_index(framer, n);
+    framer->len -= n;
+    framer->scanned = 0;
+}
+
+ssize_t framer_read(Framer *framer, int fd) {
+    size_t free_space = FRAMER_SIZE - framer->len;
+
+    if (!free_space) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    // The free space may wrap around the end of the ring
+    size_t tail = framer_index(framer, framer->len);
+    size_t first = FRAMER_SIZE - tail < free_space ? FRAMER_SIZE - tail : free_space;
+
+    struct iovec iov[2] = {
+        { framer->data + tail, first },
+        { framer->data, free_space - first },
+    };
+
+    ssize_t len;
+
+    do {
+        len = readv(fd, iov, free_space > first ? 2 : 1);
+    } while (len < 0 && errno == EINTR);
+
+    if (len > 0) {
+        framer->len += len;
+    }
+
+    return len;
+}
+
+bool framer_pending(Framer *framer) {
+    // Resume where the last scan stopped, the \r of the terminator may have been the last byte
+    while (framer->scanned + 1 < framer->len) {
+        size_t index = framer_index(framer, framer->scanned);
+        size_t run = FRAMER_SIZE - index;
+        if (run > framer->len - framer->scanned) run = framer->len - framer->scanned;
+
+        size_t found = scan_crlf(framer->data + index, run);
+
+        if (found < run) {
+            framer->scanned += found;
+            return true;
+        }
+
+        framer->scanned += run - 1;
+        if (framer->scanned + 1 >= framer->len) break;
+
+        // The run has stopped at the end of the ring, the terminator may cross it
+        if (framer_byte(framer, framer->scanned) == '\r' && framer_byte(framer, framer->scanned + 1) == '\n') {
+            return true;
+        }
+
+        framer->scanned += 1;
+    }
+
+    return false;
+}
+
+bool framer_next(Framer *framer, Bytes *message) {
+    const uint8_t *data;
+    size_t len;
+
+    if (!framer_next_view(framer, &data, &len)) return false;
+
+    memcpy(message->data, data, len);
+    message->offset = 0;
+    message->len = len;
+
+    // Keep it terminated like a freshly received buffer
+    if (len < BYTES_SIZE) message->data[len] = '\0';
+
+    return true;
+}
+
+bool framer_next_view(Framer *framer, const uint8_t **data, size_t *len) {
+    if (!framer_pending(framer)) {
+        if (framer->len >= BYTES_SIZE) {
+            // The terminator cannot come soon enough for the message to fit
+            set_error(Error_InvalidPayload);
+            framer_init(framer);
+        }
+
+        return false;
+    }
+
+    size_t message_len = framer->scanned + 2;
+
+    if (message_len > BYTES_SIZE) {
+        set_error(Error_InvalidPayload);
+        framer_consume(framer, message_len);
+        return false;
+    }
+
+    if (framer->head + message_len <= FRAMER_SIZE) {
+        *data = framer->data + framer->head;
+    } else {
+        framer_copy(framer, 0, framer->line, message_len);
+        *data = framer->line;
+    }
+
+    *len = message_len;
+    framer_consume(framer, message_len);
+    return true;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file framer.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides the framing of a TCP stream into the \r\n terminated messages of the protocol.
+ *
+ * A single read may return several messages, or a message split at any byte. The framer keeps the received
+ * data in a ring buffer, so every read fills all of its free space, and yields the complete messages one by one.
+ */
+
+#ifndef FRAMER_H
+#define FRAMER_H
+
+#include "bytes.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/// Capacity of the ring buffer, has to be a power of 2 and hold a partial message together with a burst of new ones
+#define FRAMER_SIZE 8192
+
+/**
+ * @brief Ring buffer of the received part of a TCP stream.
+ */
+typedef struct {
+    uint8_t data[FRAMER_SIZE]; /**< The ring buffer. */
+    size_t head; /**< Position of the first buffered byte. */
+    size_t len; /**< Number of buffered bytes. */
+    size_t scanned; /**< Number of buffered bytes known not to end the first message. */
+    uint8_t line[BYTES_SIZE]; /**< Copy of the last taken message if it crosses the end of the ring. */
+} Framer;
+
+/**
+ * @brief Empty the framer.
+ * @param framer Pointer to the framer.
+ */
+void framer_init(Framer *framer);
+
+/**
+ * @brief Read once from a socket into the free space of the ring buffer.
+ * @param framer Pointer to the framer.
+ * @param fd The socket.
+ * @return Number of the bytes read, 0 if the peer has closed the stream, -1 on failure with errno set like by recv.
+ */
+ssize_t framer_read(Framer *framer, int fd);
+
+/**
+ * @brief Check whether a complete message is buffered.
+ * @param framer Pointer to the framer.
+ * @return true if framer_next would yield a message.
+ */
+bool framer_pending(Framer *framer);
+
+/**
+ * @brief Take the first complete message out of the buffer.
+ * @param framer Pointer to the framer.
+ * @param message Output, the message including its \r\n.
+ * @return true if a message has been taken, false if no complete message is buffered.
+ * @note This may set Error_InvalidPayload if the message cannot fit into Bytes, the message is dropped.
+ */
+bool framer_next(Framer *framer, Bytes *message);
+
+/**
+ * @brief Take the first complete message out of the buffer without copying it.
+ *
+ * The message stays in the ring, which is not written until the next framer_read.
+ * Only a message crossing the end of the ring is copied, into the framer.
+ *
+ * @param framer Pointer to the framer.
+ * @param data Output, the message including its \r\n, valid until the next framer_read or framer_next_view.
+ * @param len Output, length of the message.
+ * @return true if a message has been taken, false if no complete message is buffered.
+ * @note This may set Error_InvalidPayload like framer_next.
+ */
+bool framer_next_view(Framer *framer, const uint8_t **data, size_t *len);
+
+#endif
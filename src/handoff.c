@@ -0,0 +1,453 @@
+/**
+ * @file handoff.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of handoff.h
+ */
+
+#include "handoff.h"
+#include "error.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/// How long a process waits for the other one before giving up the handoff, in seconds
+#define HANDOFF_TIMEOUT 5
+
+/// Upper bound of a record body, anything bigger is a corrupted stream
+#define HANDOFF_MAX_BODY (64 << 20)
+
+/// Size of the window of the IDs received over UDP
+#define HANDOFF_RECEIVED_IDS_LEN sizeof(ReplayWindow)
+
+/**
+ * @brief Fixed part of HandoffRecord_Session.
+ *
+ * It is followed by the TCP input, the TCP output, the received IDs and the unconfirmed payloads,
+ * each unconfirmed payload is a HandoffPending followed by the serialized payload.
+ */
+typedef struct {
+    uint16_t loop; /**< Index of the event loop serving the session. */
+    uint8_t mode; /**< Transport used by the client. */
+    uint8_t state; /**< SessionState. */
+    uint8_t shared_socket; /**< The session is served by the UDP welcome socket. */
+    uint8_t closed; /**< The session has been closed, only the rest of its TCP output is left. */
+    MessageID next_message_id; /**< ID of the next payload sent to the client. */
+    struct sockaddr_in address; /**< Address of the client. */
+    DisplayName display_name; /**< Last display name used by the client. */
+    ChannelID channel; /**< Channel the client is in, empty if none. */
+    uint32_t input_len; /**< Length of the unprocessed TCP input. */
+    uint32_t output_len; /**< Length of the unsent TCP output. */
+    uint32_t received_ids_len; /**< Size of the window of the received IDs, 0 in TCP. */
+    uint32_t pending_count; /**< Number of the unconfirmed payloads. */
+} HandoffSession;
+
+/**
+ * @brief Header of an unconfirmed UDP payload in HandoffRecord_Session.
+ */
+typedef struct {
+    MessageID id; /**< ID of the payload. */
+    uint16_t retry_count; /**< How many times it has been retransmitted. */
+    uint32_t len; /**< Length of the serialized payload. */
+} HandoffPending;
+
+/// Neither process may block the other one forever
+static void handoff_set_timeout(int fd) {
+    struct timeval timeout = { HANDOFF_TIMEOUT, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+static bool handoff_address(const char *path, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        eprintf("Path of the upgrade socket is too long: %s", path);
+        return false;
+    }
+
+    strcpy(address->sun_path, path);
+    return true;
+}
+
+int handoff_listen(const char *path) {
+    struct sockaddr_un address;
+
+    if (!handoff_address(path, &address)) {
+        set_error(Error_Socket);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+
+    if (fd < 0) {
+        perror("ERR: socket");
+        set_error(Error_Socket);
+        return -1;
+    }
+
+    // The socket file of the previous server is left behind
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 1) < 0) {
+        perror("ERR: Cannot listen on the upgrade socket");
+        set_error(Error_Socket);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int handoff_connect(const char *path) {
+    struct sockaddr_un address;
+    if (!handoff_address(path, &address)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    handoff_set_timeout(fd);
+    return fd;
+}
+
+int handoff_accept(int listener) {
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0) return -1;
+
+    handoff_set_timeout(fd);
+    return fd;
+}
+
+void handoff_send(int fd, HandoffRecordType type, const void *body, size_t len, int passed_fd) {
+    HandoffHeader header = { type, len };
+
+    struct iovec iov[2] = {
+        { &header, sizeof(header) },
+        { (void *)body, len },
+    };
+
+    struct msghdr msg = {0};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    // The socket is delivered together with the first byte of the header
+    union {
+        struct cmsghdr header;
+        uint8_t data[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    if (passed_fd >= 0) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.data;
+        msg.msg_controllen = sizeof(control.data);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &passed_fd, sizeof(int));
+    }
+
+    while (msg.msg_iovlen) {
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+
+            perror("ERR: Cannot send the handoff");
+            set_error(Error_Connection);
+            return;
+        }
+
+        // The rest of a partially sent record goes without the socket
+        msg.msg_control = NULL;
+        msg.msg_controllen = 0;
+
+        while (msg.msg_iovlen && (size_t)sent >= msg.msg_iov->iov_len) {
+            sent -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+
+        if (msg.msg_iovlen) {
+            msg.msg_iov->iov_base = (uint8_t *)msg.msg_iov->iov_base + sent;
+            msg.msg_iov->iov_len -= sent;
+        }
+    }
+}
+
+/// Receive exactly len bytes, the passed socket is stored into passed_fd if there is any
+static bool handoff_recv_exact(int fd, void *data, size_t len, int *passed_fd) {
+    union {
+        struct cmsghdr header;
+        uint8_t data[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    while (len) {
+        struct iovec iov = { data, len };
+        struct msghdr msg = {0};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        if (passed_fd) {
+            msg.msg_control = control.data;
+            msg.msg_controllen = sizeof(control.data);
+        }
+
+        ssize_t received = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+
+        struct cmsghdr *cmsg = passed_fd ? CMSG_FIRSTHDR(&msg) : NULL;
+
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(passed_fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+
+        data = (uint8_t *)data + received;
+        len -= received;
+    }
+
+    return true;
+}
+
+HandoffRecord handoff_recv(int fd) {
+    HandoffRecord record = { HandoffRecord_End, NULL, 0, -1 };
+    HandoffHeader header;
+
+    if (!handoff_recv_exact(fd, &header, sizeof(header), &record.fd) || header.len > HANDOFF_MAX_BODY) {
+        eprint("Cannot receive the handoff");
+        set_error(Error_Connection);
+        return record;
+    }
+
+    record.type = header.type;
+    record.len = header.len;
+
+    if (!record.len) return record;
+
+    record.body = malloc(record.len);
+
+    if (!record.body) {
+        set_error(Error_OutOfMemory);
+        return record;
+    }
+
+    if (!handoff_recv_exact(fd, record.body, record.len, NULL)) {
+        eprint("Cannot receive the handoff");
+        set_error(Error_Connection);
+    }
+
+    return record;
+}
+
+void handoff_record_free(HandoffRecord *record) {
+    free(record->body);
+    if (record->fd >= 0) close(record->fd);
+
+    record->body = NULL;
+    record->fd = -1;
+}
+
+/// Copy the unsent part of the output queue into data, if it is not NULL
+static size_t handoff_output(const Session *session, uint8_t *data) {
+    const SessionOutput *output = &session->output;
+    size_t len = 0;
+
+    for (size_t i = 0; i < output->len; i++) {
+        const Wire *wire = output->items[(output->head + i) & (output->cap - 1)];
+        size_t offset = i == 0 ? output->offset : 0;
+
+        if (data) memcpy(data + len, wire->data + offset, wire->len - offset);
+        len += wire->len - offset;
+    }
+
+    return len;
+}
+
+void handoff_send_session(int fd, uint16_t loop, const Session *session) {
+    HandoffSession fixed = {0};
+    fixed.loop = loop;
+    fixed.mode = session->mode;
+    fixed.state = session->state;
+    fixed.shared_socket = session->shared_socket;
+    fixed.closed = session->closed;
+    fixed.next_message_id = session->next_message_id;
+    fixed.address = session->address;
+    memcpy(fixed.display_name, session->display_name, sizeof(DisplayName));
+    if (session->channel) memcpy(fixed.channel, session->channel->name, sizeof(ChannelID));
+
+    if (session->mode == Mode_TCP) {
+        fixed.input_len = session->input.len;
+
+        fixed.output_len = handoff_output(session, NULL);
+    } else {
+        fixed.received_ids_len = HANDOFF_RECEIVED_IDS_LEN;
+    }
+
+    size_t len = sizeof(fixed) + fixed.input_len + fixed.output_len + fixed.received_ids_len;
+
+    for (SessionPending *it = session->pending; it; it = it->next) {
+        fixed.pending_count += 1;
+        len += sizeof(HandoffPending) + it->wire->len;
+    }
+
+    uint8_t *body = malloc(len);
+
+    if (!body) {
+        set_error(Error_OutOfMemory);
+        return;
+    }
+
+    uint8_t *it = body;
+    memcpy(it, &fixed, sizeof(fixed));
+    it += sizeof(fixed);
+
+    memcpy(it, bytes_get(&session->input), fixed.input_len);
+    it += fixed.input_len;
+
+    if (session->mode == Mode_TCP) {
+        it += handoff_output(session, it);
+    } else {
+        memcpy(it, &session->received_ids, fixed.received_ids_len);
+        it += fixed.received_ids_len;
+    }
+
+    for (SessionPending *pending = session->pending; pending; pending = pending->next) {
+        HandoffPending header = { pending->id, pending->retry_count, pending->wire->len };
+        memcpy(it, &header, sizeof(header));
+        it += sizeof(header);
+
+        memcpy(it, pending->wire->data, pending->wire->len);
+        it += pending->wire->len;
+    }
+
+    handoff_send(fd, HandoffRecord_Session, body, len, session->shared_socket ? -1 : session->source.fd);
+    free(body);
+}
+
+/// Take the next len bytes of the record body, NULL if the body is shorter
+static const uint8_t *handoff_take(const HandoffRecord *record, size_t *offset, size_t len) {
+    if (len > record->len - *offset) return NULL;
+
+    const uint8_t *data = record->body + *offset;
+    *offset += len;
+    return data;
+}
+
+/// Restore the variable parts of the session record
+static bool handoff_session_data(Session *session, const HandoffRecord *record, const HandoffSession *fixed, size_t offset) {
+    const uint8_t *input = handoff_take(record, &offset, fixed->input_len);
+    const uint8_t *output = handoff_take(record, &offset, fixed->output_len);
+    const uint8_t *received_ids = handoff_take(record, &offset, fixed->received_ids_len);
+
+    if (!input || !output || !received_ids || fixed->input_len > BYTES_SIZE) return false;
+
+    memcpy(session->input.data, input, fixed->input_len);
+    session->input.len = fixed->input_len;
+
+    if (fixed->output_len) {
+        Wire *wire = wire_copy(output, fixed->output_len, Mode_TCP);
+        if (!wire) return false;
+
+        session_queue_wire(session, wire);
+        wire_unref(wire);
+        if (get_error()) return false;
+    }
+
+    if (session->mode == Mode_UDP) {
+        if (fixed->received_ids_len != HANDOFF_RECEIVED_IDS_LEN) return false;
+        memcpy(&session->received_ids, received_ids, fixed->received_ids_len);
+    }
+
+    for (uint32_t i = 0; i < fixed->pending_count; i++) {
+        const uint8_t *data = handoff_take(record, &offset, sizeof(HandoffPending));
+        if (!data) return false;
+
+        HandoffPending header;
+        memcpy(&header, data, sizeof(header));
+
+        data = handoff_take(record, &offset, header.len);
+        if (!data || header.len < WIRE_UDP_HEADER_LEN) return false;
+
+        SessionPending *pending = calloc(1, sizeof(SessionPending));
+
+        if (!pending) {
+            set_error(Error_OutOfMemory);
+            return false;
+        }
+
+        pending->session = session;
+        pending->id = header.id;
+        pending->retry_count = header.retry_count;
+        pending->wire = wire_copy(data, header.len, Mode_UDP);
+
+        if (!pending->wire) {
+            free(pending);
+            return false;
+        }
+
+        if (session->pending_tail) {
+            session->pending_tail->next = pending;
+        } else {
+            session->pending = pending;
+        }
+
+        session->pending_tail = pending;
+    }
+
+    return true;
+}
+
+Session *handoff_session(HandoffRecord *record, uint16_t *loop, ChannelID channel) {
+    HandoffSession fixed;
+    size_t offset = 0;
+    const uint8_t *data = handoff_take(record, &offset, sizeof(fixed));
+
+    if (!data) {
+        set_error(Error_InvalidPayload);
+        return NULL;
+    }
+
+    memcpy(&fixed, data, sizeof(fixed));
+
+    if (fixed.mode != Mode_TCP && fixed.mode != Mode_UDP) {
+        set_error(Error_InvalidPayload);
+        return NULL;
+    }
+
+    Session *session = session_new(fixed.mode, record->fd, &fixed.address);
+    if (!session) return NULL;
+
+    // The session owns the socket now
+    record->fd = -1;
+
+    session->state = fixed.state;
+    session->shared_socket = fixed.shared_socket;
+    session->closed = fixed.closed;
+    session->next_message_id = fixed.next_message_id;
+    memcpy(session->display_name, fixed.display_name, sizeof(DisplayName));
+    session->display_name[DISPLAY_NAME_LEN] = '\0';
+
+    if (!handoff_session_data(session, record, &fixed, offset)) {
+        if (!get_error()) set_error(Error_InvalidPayload);
+        session_free(session);
+        return NULL;
+    }
+
+    *loop = fixed.loop;
+    memcpy(channel, fixed.channel, sizeof(ChannelID));
+    channel[CHANNEL_ID_LEN] = '\0';
+    return session;
+}
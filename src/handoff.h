@@ -0,0 +1,148 @@
+/**
+ * @file handoff.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides the transfer of the sockets and sessions of a running server to its successor.
+ *
+ * The running server listens on a Unix socket, a new server process connects to it to take over.
+ * The running server stops its event loops and sends a sequence of records:
+ * - HandoffRecord_Hello with HandoffHello,
+ * - HandoffRecord_Listener with HandoffListener and the welcome socket, for every welcome socket,
+ * - HandoffRecord_Session for every live session and every closed TCP session with unsent output,
+ *   with its socket unless it is shared, see handoff_send_session,
+ * - HandoffRecord_End, the new process acknowledges it by a single byte.
+ *
+ * Every record is a HandoffHeader followed by the body, the socket passed by SCM_RIGHTS comes with the header.
+ * Both processes are the same program on the same machine, so the records are in the native layout and byte order.
+ */
+
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include "session.h"
+#include <stdint.h>
+
+/// Identifies the format of the records and its version
+#define HANDOFF_MAGIC "IPKHOFF3"
+
+/**
+ * @brief Kind of a record.
+ */
+typedef enum {
+    HandoffRecord_Hello, /**< Configuration the sessions depend on. */
+    HandoffRecord_Listener, /**< Welcome socket of an event loop. */
+    HandoffRecord_Session, /**< State of a session. */
+    HandoffRecord_End, /**< Nothing else is going to be sent. */
+} HandoffRecordType;
+
+/**
+ * @brief Header of every record.
+ */
+typedef struct {
+    uint32_t type; /**< HandoffRecordType. */
+    uint32_t len; /**< Length of the body. */
+} HandoffHeader;
+
+/**
+ * @brief Body of HandoffRecord_Hello.
+ */
+typedef struct {
+    char magic[8]; /**< HANDOFF_MAGIC without the null terminator. */
+    uint16_t threads; /**< Number of event loops, the welcome sockets are bound to them one to one. */
+    uint8_t udp_shared; /**< UDP sessions are served by the welcome sockets. */
+} HandoffHello;
+
+/**
+ * @brief Body of HandoffRecord_Listener.
+ */
+typedef struct {
+    uint16_t loop; /**< Index of the event loop owning the socket. */
+    uint8_t mode; /**< Mode_TCP for the listening socket, Mode_UDP for the UDP welcome socket. */
+} HandoffListener;
+
+/**
+ * @brief Received record.
+ */
+typedef struct {
+    HandoffRecordType type; /**< Kind of the record. */
+    uint8_t *body; /**< Body of the record, NULL if it is empty. */
+    size_t len; /**< Length of the body. */
+    int fd; /**< Socket passed with the record, -1 if none. */
+} HandoffRecord;
+
+/**
+ * @brief Create the Unix socket a new server connects to, replacing the socket file of the previous server, if any.
+ * @param path Path of the socket.
+ * @return The listening socket, -1 on failure.
+ * @note This may set Error_Socket.
+ */
+int handoff_listen(const char *path);
+
+/**
+ * @brief Connect to the server running on the Unix socket.
+ * @param path Path of the socket.
+ * @return The connected socket, -1 if no server is running there.
+ */
+int handoff_connect(const char *path);
+
+/**
+ * @brief Accept the new server connecting to the listening socket.
+ * @param listener The listening socket from handoff_listen.
+ * @return The blocking connected socket, -1 on failure.
+ */
+int handoff_accept(int listener);
+
+/**
+ * @brief Send a record.
+ * @param fd The connected socket.
+ * @param type Kind of the record.
+ * @param body Body of the record.
+ * @param len Length of the body.
+ * @param passed_fd Socket to be passed with the record, -1 if none.
+ * @note This may set Error_Connection.
+ */
+void handoff_send(int fd, HandoffRecordType type, const void *body, size_t len, int passed_fd);
+
+/**
+ * @brief Receive a record.
+ * @param fd The connected socket.
+ * @return The received record, its body has to be freed by handoff_record_free.
+ * @note This may set Error_Connection or Error_OutOfMemory.
+ */
+HandoffRecord handoff_recv(int fd);
+
+/**
+ * @brief Free the body of the record and close the passed socket, if it has not been taken.
+ * @param record Pointer to the record.
+ */
+void handoff_record_free(HandoffRecord *record);
+
+/**
+ * @brief Send the state of a session, including its socket if it is not shared.
+ *
+ * The record holds the unsent part of the TCP output queue, the unprocessed TCP input,
+ * the IDs received over UDP and the unconfirmed UDP payloads.
+ * A closed session is restored as closed, its new server only writes the rest of its output.
+ *
+ * @param fd The connected socket.
+ * @param loop Index of the event loop serving the session.
+ * @param session Pointer to the session.
+ * @note This may set Error_Connection or Error_OutOfMemory.
+ */
+void handoff_send_session(int fd, uint16_t loop, const Session *session);
+
+/**
+ * @brief Restore a session from its record, taking the socket of the record.
+ *
+ * The unconfirmed UDP payloads are not armed, the caller sets the timers of the session and arms them.
+ * A shared UDP session gets -1 as its socket.
+ *
+ * @param record Pointer to the received HandoffRecord_Session.
+ * @param loop Output, index of the event loop that served the session.
+ * @param channel Output, the channel of the session, empty if it is not in any.
+ * @return Pointer to the new session, NULL on failure.
+ * @note This may set Error_InvalidPayload or Error_OutOfMemory.
+ */
+Session *handoff_session(HandoffRecord *record, uint16_t *loop, ChannelID channel);
+
+#endif
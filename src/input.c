@@ -7,32 +7,119 @@
 
 #include "input.h"
 #include "error.h"
-#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
 
-int readLineStdin(Bytes *bytes) {
+void input_init(Input *input) {
+    input->head = 0;
+    input->len = 0;
+    input->scanned = 0;
+    input->eof = false;
+    input->discarding = false;
+}
+
+/// Position of the n-th buffered byte in the ring
+static size_t input_index(const Input *input, size_t n) {
+    return (input->head + n) & (INPUT_SIZE - 1);
+}
+
+/// Drop n bytes from the front of the buffer
+static void input_consume(Input *input, size_t n) {
+    input->head = input_index(input, n);
+    input->len -= n;
+    input->scanned = 0;
+}
+
+ssize_t input_read(Input *input, int fd) {
     log("Reading user input from stdin");
-    if (feof(stdin)) return EOF;
+    size_t free_space = INPUT_SIZE - input->len;
+
+    if (!free_space) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    // The free space may wrap around the end of the ring
+    size_t tail = input_index(input, input->len);
+    size_t first = INPUT_SIZE - tail < free_space ? INPUT_SIZE - tail : free_space;
+
+    struct iovec iov[2] = {
+        { input->data + tail, first },
+        { input->data, free_space - first },
+    };
+
+    ssize_t len;
 
-    int ch;
-    int count = 0;
+    do {
+        len = readv(fd, iov, free_space > first ? 2 : 1);
+    } while (len < 0 && errno == EINTR);
+
+    if (len > 0) {
+        input->len += len;
+    } else if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        log("Got EOF");
+        input->eof = true;
+    }
 
-    while ((ch = fgetc(stdin)) != EOF && ch != '\n') {
-        if (count++ >= BYTES_SIZE) {
-            set_error(Error_InvalidInput);
-            continue;
+    return len;
+}
+
+/// Find the \n of the first line, resuming where the last scan stopped
+static bool input_scan(Input *input) {
+    while (input->scanned < input->len) {
+        size_t index = input_index(input, input->scanned);
+        size_t run = INPUT_SIZE - index;
+        if (run > input->len - input->scanned) run = input->len - input->scanned;
+
+        const uint8_t *found = memchr(input->data + index, '\n', run);
+
+        if (found) {
+            input->scanned += found - (input->data + index);
+            return true;
         }
 
-        bytes_push(bytes, ch);
+        input->scanned += run;
     }
 
-    if (ch == EOF) {
-        log("Got EOF");
-        return EOF;
+    return false;
+}
+
+bool input_next_line(Input *input, const uint8_t **line, size_t *len) {
+    if (!input_scan(input)) {
+        if (input->discarding || input->len >= BYTES_SIZE) {
+            // The \n cannot come soon enough for the line to fit
+            input->discarding = true;
+            input_consume(input, input->len);
+        }
+
+        return false;
+    }
+
+    size_t line_len = input->scanned;
+
+    if (input->discarding || line_len >= BYTES_SIZE) {
+        input->discarding = false;
+        input_consume(input, line_len + 1);
+        set_error(Error_InvalidInput);
+
+        *line = (const uint8_t *)"";
+        *len = 0;
+        return true;
     }
 
-    if (!get_error()) {
-        bytes_push(bytes, 0);
+    if (input->head + line_len < INPUT_SIZE) {
+        *line = input->data + input->head;
+        input->data[input->head + line_len] = '\0';
+    } else {
+        size_t first = INPUT_SIZE - input->head;
+        memcpy(input->line, input->data + input->head, first);
+        memcpy(input->line + first, input->data, line_len - first);
+        input->line[line_len] = '\0';
+        *line = input->line;
     }
 
-    return count;
+    *len = line_len;
+    input_consume(input, line_len + 1);
+    return true;
 }
@@ -3,26 +3,67 @@
  * @author Le Duy Nguyen, xnguye27, VUT FIT
  * @date 02/03/2024
  * @brief This module contains function to interact with the standard input
+ *
+ * The standard input is read by plain read calls into a ring buffer, bypassing stdio. A single read
+ * may bring many lines, all of them are taken out of the buffer one by one without reading again,
+ * so no line is left waiting in a buffer the epoll does not know about.
  */
 
 #ifndef INPUT_H
 #define INPUT_H
 
 #include "bytes.h"
-#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/// Capacity of the ring buffer, has to be a power of 2 and hold the longest line together with a burst of new ones
+#define INPUT_SIZE 65536
+
+/**
+ * @brief Ring buffer of the read, but not yet taken lines.
+ */
+typedef struct {
+    uint8_t data[INPUT_SIZE]; /**< The ring buffer. */
+    size_t head; /**< Position of the first buffered byte. */
+    size_t len; /**< Number of buffered bytes. */
+    size_t scanned; /**< Number of buffered bytes known not to be \n. */
+    bool eof; /**< The end of the input has been reached. */
+    bool discarding; /**< The buffered line is too long, it is being dropped up to its \n. */
+    uint8_t line[BYTES_SIZE]; /**< Copy of the last taken line if it crosses the end of the ring. */
+} Input;
+
+/**
+ * @brief Empty the buffer.
+ * @param input Pointer to the input.
+ */
+void input_init(Input *input);
+
+/**
+ * @brief Read once from the file descriptor into the free space of the ring buffer.
+ *
+ * Called when the descriptor is readable, the read does not block.
+ * The end of the input, or a failed read, marks the input as ended.
+ *
+ * @param input Pointer to the input.
+ * @param fd The file descriptor, typically STDIN_FILENO.
+ * @return Number of the bytes read, 0 at the end of the input, -1 on failure with errno set like by read.
+ */
+ssize_t input_read(Input *input, int fd);
 
 /**
- * @brief Read data from stdin and store it in the provided byte array.
+ * @brief Take the first complete line out of the buffer.
  *
- * This function reads data from the standard input (stdin) and stores it in the provided
- * byte array, it also append the NULL byte at the end to be used as a normal C-string. 
- * The byte array should have enough capacity to store the read data, including
- * the ending byte (byte 0).
+ * The \n is replaced by the null terminator, the line is a normal C-string. It stays in the ring,
+ * which is not written until the next input_read; only a line crossing the end of the ring is copied.
  *
- * @param bytes Pointer to the byte array to store the read data.
- * @return The number of bytes read (not including the NULL byte), or EOF.
- * @note It may set Error_InvalidInput if the input contains a 0 byte or exceeds the provided limit.
+ * @param input Pointer to the input.
+ * @param line Output, the null-terminated line without its \n.
+ * @param len Output, length of the line.
+ * @return true if a line has been taken, false if no complete line is buffered.
+ * @note It sets Error_InvalidInput if the line does not fit into Bytes, the line is dropped and taken as empty.
  */
-int readLineStdin(Bytes *bytes);
+bool input_next_line(Input *input, const uint8_t **line, size_t *len);
 
 #endif
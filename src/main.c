@@ -29,6 +29,13 @@ char *HELP = "Chat server implemented using IPK24chat protocol.\n"
 "  -p <PORT>                Server listening port for welcome sockets\n"
 "  -d <number>              UDP confirmation timeout.\n"
 "  -r <number>              Maximum number of UDP retransmissions.\n"
+"  -j <number>              Number of event loops, each in its own thread.\n"
+"  -u (dynamic|shared)      UDP clients get a socket each, or share the welcome sockets.\n"
+"  -b (epoll|io_uring)      Event loop backend, io_uring falls back to epoll if the kernel lacks it.\n"
+"  -c <file>                Credential index built by ipk24chat-credentials, every AUTH is accepted without it.\n"
+"  -q <number>              Maximum number of payloads queued for a slow TCP client, 1024 by default.\n"
+"  -o (disconnect|drop-oldest)  A client over the limit is disconnected with ERR, or loses its oldest payloads.\n"
+"  -U <path>                Unix socket for hot upgrades, a new server started with the same path takes over the clients.\n"
 "  -h                       Print this message.\n";
 
 #else
@@ -40,10 +47,17 @@ char *HELP = "Chat client implemented using IPK24chat protocol.\n"
 "\n"
 "Options:\n"
 "  -s <HOST>    (REQUIRED)  Server IP or hostname.\n"
-"  -t <tcp|udp> (REQUIRED)  Transport protocol used for connection.\n"
+"  -t <tcp|udp|mixed> (REQUIRED)  Transport protocol used for connection, mixed alternates it among the sessions.\n"
 "  -p <PORT>                Server port\n"
 "  -d <number>              UDP confirmation timeout.\n"
 "  -r <number>              Maximum number of UDP retransmissions.\n"
+"  -a <fixed|adaptive>      UDP confirmation timeout policy, fixed by default.\n"
+"                           An adaptive timeout follows the round-trip time, -d is its initial and maximum value.\n"
+"  -w <number>              Number of UDP messages sent without waiting for their CONFIRM, 1 by default.\n"
+"  -f <text|ndjson|binary>  Format of the received messages on stdout, text by default.\n"
+"                           ndjson and binary are meant for bots, see README.md.\n"
+"  -n <number>              Number of chat sessions run at once, 1 by default.\n"
+"                           Every line of stdin then starts with the number of its session, see README.md.\n"
 "  -h                       Print this message.\n";
 
 #endif
@@ -0,0 +1,321 @@
+/**
+ * @file output.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of output.h
+ */
+
+#include "output.h"
+#include "error.h"
+#include "time.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/// Part of the buffer going to a single file descriptor
+struct output_run {
+    int fd;
+    size_t len;
+};
+
+/// Records waiting to be written
+static struct {
+    Format format;
+    int fd;
+    int error_fd;
+    bool tagged;
+    int target;
+    uint8_t data[OUTPUT_SIZE];
+    size_t len;
+    struct output_run runs[OUTPUT_RUNS];
+    size_t run_count;
+    Timestamp since;
+} OUTPUT;
+
+void output_init(Format format, int fd, int error_fd, bool tagged) {
+    OUTPUT.format = format;
+    OUTPUT.fd = fd;
+    OUTPUT.error_fd = error_fd;
+    OUTPUT.tagged = tagged;
+    OUTPUT.target = fd;
+    OUTPUT.len = 0;
+    OUTPUT.run_count = 0;
+}
+
+/// Start a record going to the file descriptor, the records keep the order they have been started in
+static void output_target(int fd) {
+    bool new_run = !OUTPUT.run_count || OUTPUT.runs[OUTPUT.run_count - 1].fd != fd;
+
+    if (new_run && OUTPUT.run_count == OUTPUT_RUNS) {
+        output_flush();
+    }
+
+    if (!OUTPUT.len) {
+        OUTPUT.since = timestamp_now();
+    } else if (timestamp_elapsed(OUTPUT.since) >= OUTPUT_LATENCY) {
+        // A long loop iteration must not hold the records back
+        output_flush();
+        OUTPUT.since = timestamp_now();
+    }
+
+    OUTPUT.target = fd;
+}
+
+/// Make room for n bytes in the buffer
+static uint8_t *output_reserve(size_t n) {
+    if (OUTPUT.len + n > OUTPUT_SIZE) output_flush();
+    return OUTPUT.data + OUTPUT.len;
+}
+
+/// Account n bytes written into the reserved room to the current record
+static void output_commit(size_t n) {
+    if (!OUTPUT.run_count || OUTPUT.runs[OUTPUT.run_count - 1].fd != OUTPUT.target) {
+        OUTPUT.runs[OUTPUT.run_count].fd = OUTPUT.target;
+        OUTPUT.runs[OUTPUT.run_count].len = 0;
+        OUTPUT.run_count += 1;
+    }
+
+    OUTPUT.runs[OUTPUT.run_count - 1].len += n;
+    OUTPUT.len += n;
+}
+
+static void output_bytes(const void *data, size_t len) {
+    // An empty slice may have no data at all
+    if (len) memcpy(output_reserve(len), data, len);
+    output_commit(len);
+}
+
+#define output_literal(s) output_bytes(s, sizeof(s) - 1)
+
+static void output_slice(PayloadSlice slice) {
+    output_bytes(slice.data, slice.len);
+}
+
+static void output_string(const char *str) {
+    output_bytes(str, strlen(str));
+}
+
+/// JSON string of a field, the fields are printable ASCII, only the quote and backslash have to be escaped
+static void output_json_string(PayloadSlice slice) {
+    uint8_t *out = output_reserve(slice.len * 6 + 2);
+    uint8_t *start = out;
+    *out++ = '"';
+
+    for (size_t i = 0; i < slice.len; i++) {
+        uint8_t ch = slice.data[i];
+
+        if (ch == '"' || ch == '\\') {
+            *out++ = '\\';
+            *out++ = ch;
+        } else if (ch < 0x20) {
+            out += sprintf((char *)out, "\\u%04x", ch);
+        } else {
+            *out++ = ch;
+        }
+    }
+
+    *out++ = '"';
+    output_commit(out - start);
+}
+
+static void output_ndjson(uint16_t session, const PayloadView *payload) {
+    bool written = payload->type == PayloadType_Reply || payload->type == PayloadType_Message
+        || payload->type == PayloadType_Err || payload->type == PayloadType_Bye;
+
+    if (!written) return;
+
+    output_target(OUTPUT.fd);
+
+    if (OUTPUT.tagged) {
+        char tag[32];
+        int len = snprintf(tag, sizeof(tag), "{\"session\":%u,", session);
+        output_bytes(tag, len);
+    } else {
+        output_literal("{");
+    }
+
+    switch (payload->type) {
+        case PayloadType_Reply: {
+            char ref[32];
+            int len = snprintf(ref, sizeof(ref), ",\"ref\":%u,\"content\":", payload->ref_message_id);
+
+            output_literal("\"type\":\"reply\",\"ok\":");
+            if (payload->result) output_literal("true"); else output_literal("false");
+            output_bytes(ref, len);
+            output_json_string(payload->message_content);
+            output_literal("}\n");
+            break;
+        }
+
+        case PayloadType_Message:
+        case PayloadType_Err:
+            if (payload->type == PayloadType_Message) output_literal("\"type\":\"msg\",\"from\":");
+            else output_literal("\"type\":\"err\",\"from\":");
+
+            output_json_string(payload->display_name);
+            output_literal(",\"content\":");
+            output_json_string(payload->message_content);
+            output_literal("}\n");
+            break;
+
+        case PayloadType_Bye:
+            output_literal("\"type\":\"bye\"}\n");
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void output_binary(uint16_t session, const PayloadView *payload) {
+    uint8_t header[6];
+    size_t header_len = 3;
+    size_t len = 0;
+
+    switch (payload->type) {
+        case PayloadType_Reply:
+            header[3] = payload->result;
+            header[4] = payload->ref_message_id >> 8;
+            header[5] = payload->ref_message_id & 0xFF;
+            header_len = 6;
+            len = 3 + payload->message_content.len;
+            break;
+
+        case PayloadType_Message:
+        case PayloadType_Err:
+            header[3] = payload->display_name.len;
+            header_len = 4;
+            len = 1 + payload->display_name.len + payload->message_content.len;
+            break;
+
+        case PayloadType_Bye:
+            break;
+
+        default:
+            return;
+    }
+
+    header[0] = payload->type;
+    header[1] = len >> 8;
+    header[2] = len & 0xFF;
+
+    output_target(OUTPUT.fd);
+
+    if (OUTPUT.tagged) {
+        uint8_t tag[2] = { session >> 8, session & 0xFF };
+        output_bytes(tag, sizeof(tag));
+    }
+
+    output_bytes(header, header_len);
+    if (payload->type != PayloadType_Reply) output_slice(payload->display_name);
+    output_slice(payload->message_content);
+}
+
+/// Start a text line, with the number of the session if there are several
+static void output_line(int fd, int session) {
+    output_target(fd);
+    if (!OUTPUT.tagged || session < 0) return;
+
+    char tag[16];
+    int len = snprintf(tag, sizeof(tag), "[%d] ", session);
+    output_bytes(tag, len);
+}
+
+static void output_text(uint16_t session, const PayloadView *payload) {
+    switch (payload->type) {
+        case PayloadType_Reply:
+            output_line(OUTPUT.error_fd, session);
+            if (payload->result) output_literal("Success: "); else output_literal("Failure: ");
+            output_slice(payload->message_content);
+            output_literal("\n");
+            break;
+
+        case PayloadType_Message:
+            output_line(OUTPUT.fd, session);
+            output_slice(payload->display_name);
+            output_literal(": ");
+            output_slice(payload->message_content);
+            output_literal("\n");
+            break;
+
+        case PayloadType_Err:
+            output_line(OUTPUT.error_fd, session);
+            output_literal("ERR FROM ");
+            output_slice(payload->display_name);
+            output_literal(": ");
+            output_slice(payload->message_content);
+            output_literal("\n");
+            break;
+
+        default:
+            break;
+    }
+}
+
+void output_payload(uint16_t session, const PayloadView *payload) {
+    switch (OUTPUT.format) {
+        case Format_Text:
+            output_text(session, payload);
+            break;
+
+        case Format_Ndjson:
+            output_ndjson(session, payload);
+            break;
+
+        case Format_Binary:
+            output_binary(session, payload);
+            break;
+    }
+}
+
+void output_sent(uint16_t session, const uint8_t *display_name, PayloadSlice content) {
+    if (OUTPUT.format != Format_Text) return;
+
+    output_line(OUTPUT.fd, session);
+    output_string((const char *)display_name);
+    output_literal(": ");
+    output_slice(content);
+    output_literal("\n");
+}
+
+void output_notice(const char *text) {
+    // Stdout holds only the records in the formats for bots
+    output_target(OUTPUT.format == Format_Text ? OUTPUT.fd : OUTPUT.error_fd);
+    output_string(text);
+}
+
+void output_error(int session, const char *message) {
+    output_line(OUTPUT.error_fd, session);
+    output_literal("ERR: ");
+    output_string(message);
+    output_literal("\n");
+}
+
+void output_flush() {
+    size_t offset = 0;
+
+    for (size_t i = 0; i < OUTPUT.run_count; i++) {
+        const struct output_run *run = &OUTPUT.runs[i];
+        size_t written = 0;
+
+        while (written < run->len) {
+            ssize_t len = write(run->fd, OUTPUT.data + offset + written, run->len - written);
+
+            if (len < 0) {
+                if (errno == EINTR) continue;
+
+                // Nobody reads the output anymore
+                eprint("Cannot write the output");
+                break;
+            }
+
+            written += len;
+        }
+
+        offset += run->len;
+    }
+
+    OUTPUT.len = 0;
+    OUTPUT.run_count = 0;
+}
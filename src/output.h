@@ -0,0 +1,86 @@
+/**
+ * @file output.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides the output of the client, the received payloads in the format chosen by `-f`.
+ *
+ * Every record is formatted into a single buffer, which is written once per loop iteration, or sooner when it is
+ * full or its oldest record has waited for OUTPUT_LATENCY. The records going to stdout and stderr share the buffer
+ * as runs of consecutive records for the same descriptor, the runs are written in order, so the lines of both
+ * streams keep their order on a terminal while a busy channel costs a write per loop iteration instead of per line.
+ *
+ * - text, meant for a terminal: messages on stdout, replies, errors and the local error messages on stderr.
+ *
+ * The ndjson and binary formats are meant for bots, only their records go to stdout:
+ *
+ * - ndjson, a JSON object per line:
+ *   `{"type":"reply","ok":true,"ref":1,"content":"..."}`, `{"type":"msg","from":"...","content":"..."}`,
+ *   `{"type":"err","from":"...","content":"..."}` and `{"type":"bye"}`.
+ * - binary, a record per payload: the type of the payload as in the UDP variant (1 byte), the length of the rest
+ *   of the record (2 bytes, network byte order), then for REPLY the result (1 byte) and the referenced MessageID
+ *   (2 bytes) followed by the content, for MSG and ERR the length of the display name (1 byte), the display name
+ *   and the content, nothing for BYE.
+ *
+ * When the client runs several sessions, every record tells which one it belongs to: the text lines start with
+ * `[N] `, the JSON objects have the `"session":N` field first and the binary records are preceded by N (2 bytes,
+ * network byte order).
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "args.h"
+#include "payload.h"
+
+/// Capacity of the buffer of the records, has to hold several of the longest ones
+#define OUTPUT_SIZE 65536
+
+/// Maximum number of the runs of records going to the same descriptor, the buffer is written when they run out
+#define OUTPUT_RUNS 256
+
+/// Maximum time in milliseconds a record waits in the buffer
+#define OUTPUT_LATENCY 20
+
+/**
+ * @brief Set the format of the output.
+ * @param format Format of the output.
+ * @param fd File descriptor of the output, typically STDOUT_FILENO.
+ * @param error_fd File descriptor of the errors and of the text not meant for stdout, typically STDERR_FILENO.
+ * @param tagged Every record carries the number of its session.
+ */
+void output_init(Format format, int fd, int error_fd, bool tagged);
+
+/**
+ * @brief Output a received payload, only REPLY, MSG, ERR and BYE are written.
+ * @param session Number of the session the payload has been received by.
+ * @param payload Pointer to the payload.
+ */
+void output_payload(uint16_t session, const PayloadView *payload);
+
+/**
+ * @brief Output a message sent by the user, only the text format echoes it.
+ * @param session Number of the session the message has been sent by.
+ * @param display_name The display name the message has been sent under.
+ * @param content Content of the message.
+ */
+void output_sent(uint16_t session, const uint8_t *display_name, PayloadSlice content);
+
+/**
+ * @brief Output a text for the user such as the help, on stdout in the text format and on stderr in the others.
+ * @param text The null-terminated text, written as it is.
+ */
+void output_notice(const char *text);
+
+/**
+ * @brief Output a local error message to stderr, in every format.
+ * @param session Number of the session the error belongs to, -1 if it belongs to none.
+ * @param message The null-terminated message.
+ */
+void output_error(int session, const char *message);
+
+/**
+ * @brief Write everything that has been output so far.
+ */
+void output_flush();
+
+#endif
@@ -7,50 +7,111 @@
 
 #include "payload.h"
 #include "error.h"
+#include "scan.h"
 #include <string.h>
 
-/// The ID of the next payload, this will be incremented each time the payload_new function is called
-MessageID NEXT_MESSAGE_ID;
-
-Payload payload_new(PayloadType type, PayloadData *data) {
+Payload payload_new(PayloadType type, MessageID id, PayloadData *data) {
+    logfmt("New Payload ID %u", id);
     Payload payload;
     payload.type = type;
-    payload.id = NEXT_MESSAGE_ID++;
-    logfmt("New Payload ID %u", NEXT_MESSAGE_ID);
+    payload.id = id;
     if (data) memcpy(&payload.data, data, sizeof(PayloadData));
 
     return payload;
 }
 
-static bool is_valid_id(uint8_t ch) {
-    return ch == '-'
-        || (ch >= 'a' && ch <= 'z')
-        || (ch >= 'A' && ch <= 'Z')
-        || (ch >= '0' && ch <= '9');
+/// Slice of a null-terminated field
+static PayloadSlice slice(const uint8_t *field) {
+    PayloadSlice result = { field, strlen((const char *)field) };
+    return result;
+}
+
+PayloadView payload_view(const Payload *payload) {
+    PayloadView view = {0};
+    view.type = payload->type;
+    view.id = payload->id;
+
+    switch (payload->type) {
+        case PayloadType_Reply:
+            view.result = payload->data.reply.result;
+            view.ref_message_id = payload->data.reply.ref_message_id;
+            view.message_content = slice(payload->data.reply.message_content);
+            break;
+
+        case PayloadType_Auth:
+            view.username = slice(payload->data.auth.username);
+            view.display_name = slice(payload->data.auth.display_name);
+            view.secret = slice(payload->data.auth.secret);
+            break;
+
+        case PayloadType_Join:
+            view.channel_id = slice(payload->data.join.channel_id);
+            view.display_name = slice(payload->data.join.display_name);
+            break;
+
+        case PayloadType_Message:
+        case PayloadType_Err:
+            // MSG and ERR have the same layout
+            view.display_name = slice(payload->data.message.display_name);
+            view.message_content = slice(payload->data.message.message_content);
+            break;
+
+        case PayloadType_Confirm:
+        case PayloadType_Bye:
+            break;
+    }
+
+    return view;
 }
 
-static bool is_valid_display_name(uint8_t ch) {
-    return ch >= 0x21 && ch <= 0x7e;
+void payload_slice_copy(uint8_t *dest, PayloadSlice slice) {
+    memcpy(dest, slice.data, slice.len);
+    dest[slice.len] = '\0';
 }
 
-static bool is_valid_message_content(uint8_t ch) {
-    return ch >= 0x20 && ch <= 0x7e;
+void payload_from_view(Payload *payload, const PayloadView *view) {
+    payload->type = view->type;
+    payload->id = view->id;
+
+    switch (view->type) {
+        case PayloadType_Reply:
+            payload->data.reply.result = view->result;
+            payload->data.reply.ref_message_id = view->ref_message_id;
+            payload_slice_copy(payload->data.reply.message_content, view->message_content);
+            break;
+
+        case PayloadType_Auth:
+            payload_slice_copy(payload->data.auth.username, view->username);
+            payload_slice_copy(payload->data.auth.display_name, view->display_name);
+            payload_slice_copy(payload->data.auth.secret, view->secret);
+            break;
+
+        case PayloadType_Join:
+            payload_slice_copy(payload->data.join.channel_id, view->channel_id);
+            payload_slice_copy(payload->data.join.display_name, view->display_name);
+            break;
+
+        case PayloadType_Message:
+        case PayloadType_Err:
+            payload_slice_copy(payload->data.message.display_name, view->display_name);
+            payload_slice_copy(payload->data.message.message_content, view->message_content);
+            break;
+
+        case PayloadType_Confirm:
+        case PayloadType_Bye:
+            break;
+    }
 }
 
-typedef bool (*Validator)(uint8_t ch);
+/// Scan for the first byte outside of the character class of a field
+typedef size_t (*Validator)(const uint8_t *data, size_t len);
 
 static ssize_t read(uint8_t *dest, const Bytes *src, int limit, Validator validator) {
     const uint8_t *bytes = bytes_get(src);
-    int count = 0;
-
-    for (size_t i = 0; i < src->len; i++) {
-        /// If the character is not a valid character for the given validator
-        if (!validator(bytes[i])) break;
-        /// Hit limit
-        if (count >= limit) return -1;
-        /// else
-        count += 1;
-    }
+    size_t count = validator(bytes, src->len);
+
+    /// Hit limit
+    if (count > (size_t)limit) return -1;
 
     if (count) {
         memcpy(dest, bytes, count);
@@ -62,25 +123,25 @@ static ssize_t read(uint8_t *dest, const Bytes *src, int limit, Validator valida
 
 ssize_t read_username(Username dest, const Bytes *src) {
     logfmt("Reading username: %s", bytes_get(src));
-    return read(dest, src, USERNAME_LEN, is_valid_id);
+    return read(dest, src, USERNAME_LEN, scan_id);
 }
 
 ssize_t read_channel_id(ChannelID dest, const Bytes *src) {
     logfmt("Reading channel id: %s", bytes_get(src));
-    return read(dest, src, CHANNEL_ID_LEN, is_valid_id);
+    return read(dest, src, CHANNEL_ID_LEN, scan_id);
 }
 
 ssize_t read_secret(Secret dest, const Bytes *src) {
     logfmt("Reading secret: %s", bytes_get(src));
-    return read(dest, src, SECRET_LEN, is_valid_id);
+    return read(dest, src, SECRET_LEN, scan_id);
 }
 
 ssize_t read_display_name(DisplayName dest, const Bytes *src) {
     logfmt("Reading display name: %s", bytes_get(src));
-    return read(dest, src, DISPLAY_NAME_LEN, is_valid_display_name);
+    return read(dest, src, DISPLAY_NAME_LEN, scan_display_name);
 }
 
 ssize_t read_message_content(MessageContent dest, const Bytes *src) {
     logfmt("Reading message content: %s", bytes_get(src));
-    return read(dest, src, MESSAGE_CONTENT_LEN, is_valid_message_content);
+    return read(dest, src, MESSAGE_CONTENT_LEN, scan_message_content);
 }
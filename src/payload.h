@@ -19,6 +19,9 @@
 #define MESSAGE_CONTENT_LEN 1400
 
 // Define data types for payload components
+/// Maximum number of the pieces a payload is serialized into by tcp_serialize_iov or udp_serialize_iov
+#define PAYLOAD_IOV_MAX 7
+
 typedef uint16_t MessageID;
 typedef uint8_t Username[USERNAME_LEN + 1];
 typedef uint8_t ChannelID[CHANNEL_ID_LEN + 1];
@@ -80,15 +83,61 @@ typedef struct {
     MessageID id;          /**< MessageID as in IPK2024 specification */
 } Payload;
 
+/**
+ * @brief Field of a payload referenced where it is stored, it is not null-terminated.
+ */
+typedef struct {
+    const uint8_t *data; /**< First byte of the field. */
+    size_t len; /**< Length of the field. */
+} PayloadSlice;
+
+/**
+ * @brief Payload referencing its fields instead of holding them.
+ *
+ * A received payload references the receive buffer, it is valid until the next receive on the same buffer.
+ * Only the members used by the type of the payload are set.
+ */
+typedef struct {
+    PayloadType type; /**< Type of the payload. */
+    MessageID id; /**< MessageID as in IPK2024 specification. */
+    bool result; /**< REPLY: Result. */
+    MessageID ref_message_id; /**< REPLY: ID of the replied payload. */
+    PayloadSlice username; /**< AUTH: Username. */
+    PayloadSlice channel_id; /**< JOIN: Channel. */
+    PayloadSlice secret; /**< AUTH: Secret. */
+    PayloadSlice display_name; /**< AUTH, JOIN, MSG, ERR: Display name. */
+    PayloadSlice message_content; /**< REPLY, MSG, ERR: Content. */
+} PayloadView;
+
 /**
  * @brief Create a new payload with the specified type and data.
  * @param type The type of the payload.
+ * @param id The MessageID of the payload, every session numbers its payloads on its own.
  * @param data Pointer to the data of the payload. NULL if it not need any
  * @return The new payload.
- * @note this will automatically assign an ID into it.
- *       The ID will start from 0 and is incremented each time this function is called
  */
-Payload payload_new(PayloadType type, PayloadData *data);
+Payload payload_new(PayloadType type, MessageID id, PayloadData *data);
+
+/**
+ * @brief Reference the fields of a payload.
+ * @param payload Pointer to the payload, it has to outlive the view.
+ * @return The view of the payload.
+ */
+PayloadView payload_view(const Payload *payload);
+
+/**
+ * @brief Copy the fields referenced by a view into a payload.
+ * @param payload Output, the payload.
+ * @param view Pointer to the view, its fields have to fit into the payload.
+ */
+void payload_from_view(Payload *payload, const PayloadView *view);
+
+/**
+ * @brief Copy a field into a null-terminated array.
+ * @param dest The array, it has to hold the field and the null terminator.
+ * @param slice The field.
+ */
+void payload_slice_copy(uint8_t *dest, PayloadSlice slice);
 
 /**
  * These are a set of function to effectively read data of a bytes src into the dest
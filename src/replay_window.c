@@ -0,0 +1,85 @@
+/**
+ * @file replay_window.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of replay_window.h
+ */
+
+#include "replay_window.h"
+#include "error.h"
+#include <string.h>
+
+#define WORDS (REPLAY_WINDOW_BITS / 64)
+
+/// Distance of the ID from the highest one, positive if the ID is newer
+static int replay_window_distance(const ReplayWindow *window, MessageID msg_id) {
+    return (int16_t)(uint16_t)(msg_id - window->highest);
+}
+
+/// Move every bit n places towards the older IDs
+static void replay_window_shift(ReplayWindow *window, int n) {
+    if (n >= REPLAY_WINDOW_BITS) {
+        memset(window->bits, 0, sizeof(window->bits));
+        return;
+    }
+
+    int words = n / 64;
+    int bits = n % 64;
+
+    for (int i = WORDS - 1; i >= 0; i--) {
+        uint64_t word = 0;
+
+        if (i >= words) {
+            word = window->bits[i - words] << bits;
+
+            if (bits && i > words) {
+                word |= window->bits[i - words - 1] >> (64 - bits);
+            }
+        }
+
+        window->bits[i] = word;
+    }
+}
+
+void replay_window_init(ReplayWindow *window) {
+    memset(window, 0, sizeof(ReplayWindow));
+}
+
+void replay_window_insert(ReplayWindow *window, MessageID msg_id) {
+    logfmt("Inserting %u into replay window", msg_id);
+
+    if (!window->started) {
+        window->started = true;
+        window->highest = msg_id;
+        window->bits[0] = 1;
+        return;
+    }
+
+    int distance = replay_window_distance(window, msg_id);
+
+    if (distance > 0) {
+        replay_window_shift(window, distance);
+        window->highest = msg_id;
+        window->bits[0] |= 1;
+        return;
+    }
+
+    int n = -distance;
+    if (n >= REPLAY_WINDOW_BITS) return;
+
+    window->bits[n / 64] |= 1ULL << (n % 64);
+}
+
+bool replay_window_contains(const ReplayWindow *window, MessageID msg_id) {
+    logfmt("Searching %u in the replay window", msg_id);
+
+    if (!window->started) return false;
+
+    int distance = replay_window_distance(window, msg_id);
+    if (distance > 0) return false;
+
+    int n = -distance;
+    if (n >= REPLAY_WINDOW_BITS) return true;
+
+    return (window->bits[n / 64] >> (n % 64)) & 1;
+}
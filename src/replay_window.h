@@ -0,0 +1,52 @@
+/**
+ * @file replay_window.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides a sliding window of the recently received MessageIDs, used to detect duplicated UDP payloads.
+ *
+ * The window remembers REPLAY_WINDOW_BITS IDs up to the highest one received so far.
+ * IDs are compared by serial number arithmetic (RFC 1982), so the window keeps sliding when the 16-bit IDs wrap around.
+ * An ID older than the window is reported as received, a peer never retransmits that far back.
+ */
+
+#ifndef REPLAY_WINDOW_H
+#define REPLAY_WINDOW_H
+
+#include "payload.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Number of IDs remembered by the window, a multiple of 64
+#define REPLAY_WINDOW_BITS 256
+
+/**
+ * @brief Sliding window of the received MessageIDs.
+ */
+typedef struct {
+    uint64_t bits[REPLAY_WINDOW_BITS / 64]; /**< Bit n tells whether the ID `highest - n` has been received. */
+    MessageID highest; /**< Highest ID received so far. */
+    bool started; /**< At least one ID has been received. */
+} ReplayWindow;
+
+/**
+ * @brief Initialize an empty window.
+ * @param window Pointer to the window.
+ */
+void replay_window_init(ReplayWindow *window);
+
+/**
+ * @brief Insert a MessageID into the window, sliding it if the ID is newer than all of the received ones.
+ * @param window Pointer to the window.
+ * @param msg_id The MessageID to insert.
+ */
+void replay_window_insert(ReplayWindow *window, MessageID msg_id);
+
+/**
+ * @brief Check if a MessageID has been received.
+ * @param window Pointer to the window.
+ * @param msg_id The MessageID to check.
+ * @return true if the MessageID is in the window or older than it, false otherwise.
+ */
+bool replay_window_contains(const ReplayWindow *window, MessageID msg_id);
+
+#endif
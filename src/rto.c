@@ -0,0 +1,59 @@
+/**
+ * @file rto.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of rto.h
+ */
+
+#include "rto.h"
+#include "time.h"
+#include <stdlib.h>
+
+/// Keep the timeout between the bounds
+static int rto_clamp(const Rto *rto, int timeout) {
+    int min = rto->max < RTO_MIN ? rto->max : RTO_MIN;
+
+    if (timeout < min) return min;
+    if (timeout > rto->max) return rto->max;
+    return timeout;
+}
+
+Rto rto_new(uint16_t timeout, bool adaptive) {
+    Rto rto = {0};
+    rto.adaptive = adaptive;
+    rto.rto = timeout;
+    rto.max = timeout;
+    rto.seed = (unsigned int)timestamp_now();
+    return rto;
+}
+
+void rto_sample(Rto *rto, int rtt) {
+    if (!rto->adaptive) return;
+    if (rtt < 0) rtt = 0;
+
+    if (!rto->sampled) {
+        // SRTT = R, RTTVAR = R / 2
+        rto->srtt = rtt * 8;
+        rto->rttvar = rtt * 2;
+        rto->sampled = true;
+    } else {
+        // SRTT = 7/8 SRTT + 1/8 R, RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|
+        int delta = rtt - rto->srtt / 8;
+        rto->srtt += delta;
+        rto->rttvar += abs(delta) - rto->rttvar / 4;
+    }
+
+    // The clock has a granularity of a millisecond
+    int variation = rto->rttvar > 1 ? rto->rttvar : 1;
+    rto->rto = rto_clamp(rto, rto->srtt / 8 + variation);
+}
+
+int rto_backoff(Rto *rto) {
+    if (!rto->adaptive) return rto->rto;
+
+    rto->rto = rto_clamp(rto, rto->rto * 2);
+
+    // Up to a quarter of the timeout is taken away at random
+    int jitter = rand_r(&rto->seed) % (rto->rto / 4 + 1);
+    return rto_clamp(rto, rto->rto - jitter);
+}
@@ -0,0 +1,59 @@
+/**
+ * @file rto.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides the retransmission timeout of UDP payloads, estimated from their round-trip times as in RFC 6298.
+ *
+ * The smoothed round-trip time and its variation are updated by every sample,
+ * the timeout is `SRTT + max(1, 4 * RTTVAR)` milliseconds clamped to the range RTO_MIN to the maximum.
+ * Every retransmission doubles the timeout up to the maximum, reduced by a random part so the peers do not retransmit in step.
+ * The caller is responsible for Karn's rule, a retransmitted payload must not give a sample.
+ *
+ * A fixed timeout ignores the samples and never backs off, it is the behaviour of the `-d` argument alone.
+ */
+
+#ifndef RTO_H
+#define RTO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Lower bound of the estimated timeout in milliseconds, unless the maximum is lower
+#define RTO_MIN 10
+
+/**
+ * @brief Retransmission timeout estimator.
+ */
+typedef struct {
+    bool adaptive; /**< The timeout is estimated from the samples, otherwise it is fixed. */
+    bool sampled; /**< At least one sample has been taken. */
+    int srtt; /**< Smoothed round-trip time, scaled by 8. */
+    int rttvar; /**< Round-trip time variation, scaled by 4. */
+    int rto; /**< The current timeout in milliseconds. */
+    int max; /**< Upper bound of the timeout in milliseconds. */
+    unsigned int seed; /**< State of the random jitter. */
+} Rto;
+
+/**
+ * @brief Create an estimator.
+ * @param timeout The initial and maximum timeout in milliseconds.
+ * @param adaptive Whether the timeout is estimated from the samples.
+ * @return The estimator.
+ */
+Rto rto_new(uint16_t timeout, bool adaptive);
+
+/**
+ * @brief Update the estimate by a round-trip time of a payload sent only once.
+ * @param rto Pointer to the estimator.
+ * @param rtt The round-trip time in milliseconds.
+ */
+void rto_sample(Rto *rto, int rtt);
+
+/**
+ * @brief Back off the timeout after the retransmission timer expired, once for all payloads it retransmits.
+ * @param rto Pointer to the estimator.
+ * @return The timeout of the retransmitted payload in milliseconds.
+ */
+int rto_backoff(Rto *rto);
+
+#endif
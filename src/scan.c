@@ -0,0 +1,226 @@
+/**
+ * @file scan.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of scan.h
+ *
+ * The vector kernels rely on the signed comparison of bytes, every byte from 0x80 is negative,
+ * so it falls below every valid range at once.
+ */
+
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+
+/**
+ * @brief Set of the scans of one instruction set.
+ */
+typedef struct {
+    size_t (*crlf)(const uint8_t *data, size_t len);
+    size_t (*id)(const uint8_t *data, size_t len);
+    size_t (*display_name)(const uint8_t *data, size_t len);
+    size_t (*message_content)(const uint8_t *data, size_t len);
+} ScanImpl;
+
+static size_t scalar_crlf(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i + 1 < len; i++) {
+        if (data[i] == '\r' && data[i + 1] == '\n') return i;
+    }
+
+    return len;
+}
+
+static size_t scalar_id(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t ch = data[i];
+        uint8_t lower = ch | 0x20;
+
+        bool valid = ch == '-'
+            || (ch >= '0' && ch <= '9')
+            || (lower >= 'a' && lower <= 'z');
+
+        if (!valid) return i;
+    }
+
+    return len;
+}
+
+static size_t scalar_display_name(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] < 0x21 || data[i] > 0x7e) return i;
+    }
+
+    return len;
+}
+
+static size_t scalar_message_content(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] < 0x20 || data[i] > 0x7e) return i;
+    }
+
+    return len;
+}
+
+static const ScanImpl SCAN_SCALAR = {
+    scalar_crlf,
+    scalar_id,
+    scalar_display_name,
+    scalar_message_content,
+};
+
+#ifdef SCAN_X86
+
+/**
+ * @brief Define a scan for the first byte of a vector the kernel marks.
+ *
+ * The kernel gets the pointer p to the bytes at position i and returns the mask of the marked bytes,
+ * the remaining `reach` bytes after the last full vector are left to the fallback.
+ * SCAN_LEAVE_<prefix> prepares the registers for the fallback.
+ */
+#define SCAN_LOOP(prefix, name, width, reach, kernel, fallback) \
+    __attribute__((target(#prefix))) \
+    static size_t prefix##_##name(const uint8_t *data, size_t len) { \
+        size_t i = 0; \
+        for (; i + width + reach <= len; i += width) { \
+            const uint8_t *p = data + i; \
+            uint32_t mask = (uint32_t)(kernel); \
+            if (mask) return i + __builtin_ctz(mask); \
+        } \
+        SCAN_LEAVE_##prefix(); \
+        return i + fallback(data + i, len - i); \
+    }
+
+#define SCAN_LEAVE_sse2()
+
+#define SSE2_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define SSE2_SET(ch) _mm_set1_epi8((char)(ch))
+
+/// Bytes outside [low, high], both bounds are below 0x80
+#define SSE2_OUTSIDE(v, low, high) \
+    _mm_or_si128(_mm_cmpgt_epi8(SSE2_SET(low), v), _mm_cmpgt_epi8(v, SSE2_SET(high)))
+
+#define SSE2_CRLF(p) \
+    _mm_movemask_epi8(_mm_cmpeq_epi8(SSE2_LOAD(p), SSE2_SET('\r'))) \
+    & _mm_movemask_epi8(_mm_cmpeq_epi8(SSE2_LOAD(p + 1), SSE2_SET('\n')))
+
+/// Lowering the letters makes a single range of them
+#define SSE2_ID(p) _mm_movemask_epi8(_mm_andnot_si128( \
+    _mm_cmpeq_epi8(SSE2_LOAD(p), SSE2_SET('-')), \
+    _mm_and_si128(SSE2_OUTSIDE(SSE2_LOAD(p), '0', '9'), \
+        SSE2_OUTSIDE(_mm_or_si128(SSE2_LOAD(p), SSE2_SET(0x20)), 'a', 'z'))))
+
+#define SSE2_DISPLAY_NAME(p) _mm_movemask_epi8(SSE2_OUTSIDE(SSE2_LOAD(p), 0x21, 0x7e))
+#define SSE2_MESSAGE_CONTENT(p) _mm_movemask_epi8(SSE2_OUTSIDE(SSE2_LOAD(p), 0x20, 0x7e))
+
+SCAN_LOOP(sse2, crlf, 16, 1, SSE2_CRLF(p), scalar_crlf)
+SCAN_LOOP(sse2, id, 16, 0, SSE2_ID(p), scalar_id)
+SCAN_LOOP(sse2, display_name, 16, 0, SSE2_DISPLAY_NAME(p), scalar_display_name)
+SCAN_LOOP(sse2, message_content, 16, 0, SSE2_MESSAGE_CONTENT(p), scalar_message_content)
+
+/// The SSE2 fallback is slowed down by the upper halves of the AVX registers, unless they are cleared
+#define SCAN_LEAVE_avx2() _mm256_zeroupper()
+
+#define AVX2_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define AVX2_SET(ch) _mm256_set1_epi8((char)(ch))
+
+#define AVX2_OUTSIDE(v, low, high) \
+    _mm256_or_si256(_mm256_cmpgt_epi8(AVX2_SET(low), v), _mm256_cmpgt_epi8(v, AVX2_SET(high)))
+
+#define AVX2_CRLF(p) \
+    _mm256_movemask_epi8(_mm256_cmpeq_epi8(AVX2_LOAD(p), AVX2_SET('\r'))) \
+    & _mm256_movemask_epi8(_mm256_cmpeq_epi8(AVX2_LOAD(p + 1), AVX2_SET('\n')))
+
+#define AVX2_ID(p) _mm256_movemask_epi8(_mm256_andnot_si256( \
+    _mm256_cmpeq_epi8(AVX2_LOAD(p), AVX2_SET('-')), \
+    _mm256_and_si256(AVX2_OUTSIDE(AVX2_LOAD(p), '0', '9'), \
+        AVX2_OUTSIDE(_mm256_or_si256(AVX2_LOAD(p), AVX2_SET(0x20)), 'a', 'z'))))
+
+#define AVX2_DISPLAY_NAME(p) _mm256_movemask_epi8(AVX2_OUTSIDE(AVX2_LOAD(p), 0x21, 0x7e))
+#define AVX2_MESSAGE_CONTENT(p) _mm256_movemask_epi8(AVX2_OUTSIDE(AVX2_LOAD(p), 0x20, 0x7e))
+
+// The tail shorter than a 32 bytes vector still goes 16 bytes at a time
+SCAN_LOOP(avx2, crlf, 32, 1, AVX2_CRLF(p), sse2_crlf)
+SCAN_LOOP(avx2, id, 32, 0, AVX2_ID(p), sse2_id)
+SCAN_LOOP(avx2, display_name, 32, 0, AVX2_DISPLAY_NAME(p), sse2_display_name)
+SCAN_LOOP(avx2, message_content, 32, 0, AVX2_MESSAGE_CONTENT(p), sse2_message_content)
+
+static const ScanImpl SCAN_SSE2 = {
+    sse2_crlf,
+    sse2_id,
+    sse2_display_name,
+    sse2_message_content,
+};
+
+static const ScanImpl SCAN_AVX2 = {
+    avx2_crlf,
+    avx2_id,
+    avx2_display_name,
+    avx2_message_content,
+};
+
+#endif
+
+static const ScanImpl *SCAN_IMPL = &SCAN_SCALAR;
+static ScanLevel SCAN_LEVEL = ScanLevel_Scalar;
+
+bool scan_set_level(ScanLevel level) {
+    const ScanImpl *impl = NULL;
+
+    switch (level) {
+        case ScanLevel_Scalar:
+            impl = &SCAN_SCALAR;
+            break;
+
+#ifdef SCAN_X86
+        case ScanLevel_SSE2:
+            if (__builtin_cpu_supports("sse2")) impl = &SCAN_SSE2;
+            break;
+
+        case ScanLevel_AVX2:
+            if (__builtin_cpu_supports("avx2")) impl = &SCAN_AVX2;
+            break;
+#endif
+
+        default:
+            break;
+    }
+
+    if (!impl) return false;
+
+    SCAN_IMPL = impl;
+    SCAN_LEVEL = level;
+    return true;
+}
+
+ScanLevel scan_level() {
+    return SCAN_LEVEL;
+}
+
+/// Select the fastest implementation before main, so the event loop threads only read it
+__attribute__((constructor))
+static void scan_init() {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+#endif
+
+    if (!scan_set_level(ScanLevel_AVX2)) scan_set_level(ScanLevel_SSE2);
+}
+
+size_t scan_crlf(const uint8_t *data, size_t len) {
+    return SCAN_IMPL->crlf(data, len);
+}
+
+size_t scan_id(const uint8_t *data, size_t len) {
+    return SCAN_IMPL->id(data, len);
+}
+
+size_t scan_display_name(const uint8_t *data, size_t len) {
+    return SCAN_IMPL->display_name(data, len);
+}
+
+size_t scan_message_content(const uint8_t *data, size_t len) {
+    return SCAN_IMPL->message_content(data, len);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file scan.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides the scanning of received text for the \r\n terminator and the characters of the fields.
+ *
+ * The scans process 16 bytes at a time with SSE2 and 32 bytes at a time with AVX2, the fastest implementation
+ * supported by the CPU is selected when the program starts. Other architectures use the byte by byte implementation.
+ */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Instruction set used by the scans.
+ */
+typedef enum {
+    ScanLevel_Scalar, /**< Byte by byte. */
+    ScanLevel_SSE2, /**< 16 bytes at a time. */
+    ScanLevel_AVX2, /**< 32 bytes at a time. */
+} ScanLevel;
+
+/**
+ * @brief Find the \r\n terminator.
+ * @param data The bytes to scan.
+ * @param len Number of the bytes.
+ * @return Position of the \r of the first terminator, len if there is none.
+ */
+size_t scan_crlf(const uint8_t *data, size_t len);
+
+/**
+ * @brief Find the first byte that cannot be in a username, channel ID or secret, [A-Za-z0-9-].
+ * @param data The bytes to scan.
+ * @param len Number of the bytes.
+ * @return Position of the byte, len if all the bytes are valid.
+ */
+size_t scan_id(const uint8_t *data, size_t len);
+
+/**
+ * @brief Find the first byte that cannot be in a display name, the printable characters without space.
+ * @param data The bytes to scan.
+ * @param len Number of the bytes.
+ * @return Position of the byte, len if all the bytes are valid.
+ */
+size_t scan_display_name(const uint8_t *data, size_t len);
+
+/**
+ * @brief Find the first byte that cannot be in a message content, the printable characters with space.
+ * @param data The bytes to scan.
+ * @param len Number of the bytes.
+ * @return Position of the byte, len if all the bytes are valid.
+ */
+size_t scan_message_content(const uint8_t *data, size_t len);
+
+/// Instruction set currently used by the scans
+ScanLevel scan_level();
+
+/// Use the given instruction set, returns false if the CPU does not support it
+/// Exporting this just for testing purpose
+bool scan_set_level(ScanLevel level);
+
+#endif
@@ -1,17 +1,1922 @@
 /**
- * @file server.h
+ * @file server.c
  * @author Le Duy Nguyen (xnguye27)
  * @date 24/03/2024
  * @brief Implementation of server.h
  */
 
+// accept4, pthread_sigmask
+#define _GNU_SOURCE
+
 #include "server.h"
-#include "connection.h"
+#include "session.h"
+#include "channel.h"
+#include "address_table.h"
+#include "timer_wheel.h"
+#include "credentials.h"
+#include "uring.h"
+#include "handoff.h"
+#include "wire.h"
+#include "scan.h"
+#include "error.h"
+#include "tcp.h"
+#include "udp.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/// Max event of EPOLL returned by a single epoll_wait
+#define MAX_EVENT 256
+
+/// Display name used for messages generated by the server
+#define SERVER_DISPLAY_NAME "Server"
+
+/// Channel every client joins after a successful authentication
+#define DEFAULT_CHANNEL "default"
+
+/// Number of submission queue entries of the io_uring of an event loop
+#define URING_ENTRIES 1024
+
+/// Number and size of the buffers provided to io_uring for the received TCP data
+#define URING_BUFFERS 512
+#define URING_BUFFER_SIZE 2048
+
+/// Milliseconds a closed TCP session has to write the rest of its output queue, a client that does not read it is cut off
+#define CLOSE_TIMEOUT 2000
+
+/// Bits of the io_uring user data holding the UringOp, the rest is the pointer to the session, if any
+#define URING_OP_MASK 7
+
+/**
+ * @brief Kind of an io_uring request of the server.
+ */
+typedef enum {
+    UringOp_Cancel, /**< Cancellation of another request, nothing to do on completion. */
+    UringOp_Accept, /**< Multishot accept on the TCP welcome socket. */
+    UringOp_Recv, /**< Recv of a TCP session, multishot if the kernel supports it. */
+    UringOp_Send, /**< Vectored send of the front of the output queue of a TCP session. */
+    UringOp_Poll, /**< Multishot poll of the epoll, for everything else than TCP sessions. */
+} UringOp;
+
+/**
+ * @brief Message for the members of a channel, shared by all event loops it is delivered to.
+ *
+ * The message is serialized once for each transport, every recipient is sent the same wire buffer.
+ */
+typedef struct {
+    atomic_int refcount; /**< Number of event loops that have not delivered it yet. */
+    ChannelID channel_id; /**< Channel of the recipients. */
+    Wire *wires[2]; /**< The message serialized for each transport, indexed by Mode. */
+} Broadcast;
+
+/**
+ * @brief Queue of broadcasts posted by the other event loops.
+ */
+typedef struct {
+    pthread_mutex_t lock; /**< Guards the items. */
+    Broadcast **items; /**< Posted broadcasts, in order of arrival. */
+    size_t len; /**< Number of the posted broadcasts. */
+    size_t cap; /**< Capacity of the items array. */
+} Inbox;
+
+/**
+ * @brief State of a single event loop of the server.
+ *
+ * Every event loop runs in its own thread with its own welcome sockets bound using SO_REUSEPORT,
+ * so the kernel spreads new clients among them. A session is served only by the event loop that accepted it.
+ */
+typedef struct Server {
+    Args args; /**< Configuration of the server. */
+    size_t index; /**< Index of the event loop in the workers array. */
+    struct Server *workers; /**< All event loops of the server, including this one. */
+    pthread_t thread; /**< Thread running the event loop. */
+    int epoll_fd; /**< Epoll watching the welcome sockets and all sessions. */
+    struct sockaddr_in address; /**< Address the welcome sockets are bound to. */
+    EventSource tcp_listener; /**< TCP welcome socket. */
+    EventSource udp_welcome; /**< UDP welcome socket. */
+    EventSource inbox_event; /**< Eventfd signaled when a broadcast is posted into the inbox. */
+    EventSource upgrade; /**< First event loop only: Unix socket a new server connects to when it takes over. */
+    int successor; /**< First event loop only: Connection of the new server taking over, -1 if none. */
+    bool handed_off; /**< The sessions belong to the other server taking part in the handoff, they are not told BYE. */
+    Inbox inbox; /**< Broadcasts from the other event loops. */
+    ChannelRegistry channels; /**< Channels with the members served by this event loop. */
+    AddressTable udp_sessions; /**< UDP sessions by the address of the client. */
+    TimerWheel timers; /**< Confirmation deadlines of the UDP payloads sent by this event loop. */
+    TimerWheel closing; /**< Deadlines of the closed TCP sessions, see Session.close_timer. */
+    Session *sessions; /**< All sessions of the event loop. */
+    Session *closed; /**< Sessions to be freed at the end of the current loop iteration. */
+    Session *dirty; /**< Sessions with the output queue to be written at the end of the current loop iteration. */
+
+    bool uring_enabled; /**< TCP is served by io_uring, the epoll is polled through the ring. */
+    bool multishot_recv; /**< The kernel supports multishot recv. */
+    bool accepting; /**< The multishot accept is in flight. */
+    bool polling; /**< The multishot poll of the epoll is in flight. */
+    size_t uring_inflight; /**< Requests of the ring that have not posted their last completion yet. */
+    bool uring_stuck; /**< The ring could not be drained, the memory its requests reference is never freed. */
+    Uring ring; /**< io_uring of the event loop. */
+    UringBuffers buffers; /**< Buffers provided to io_uring for the received TCP data. */
+} Server;
+
+/// Set once every event loop has to stop, the loops check it after each wake up
+atomic_bool SERVER_SHOULD_STOP = false;
+
+/// Eventfd of the first event loop, the signal handler wakes it up so it does not wait for the next timeout
+static int SERVER_WAKE_FD = -1;
+
+/// Credential index shared read-only by all event loops, AUTH is always accepted if it is not loaded
+Credentials CREDENTIALS = {0};
+
+static void broadcast_unref(Broadcast *broadcast) {
+    if (atomic_fetch_sub(&broadcast->refcount, 1) != 1) return;
+
+    wire_unref(broadcast->wires[Mode_TCP]);
+    wire_unref(broadcast->wires[Mode_UDP]);
+    free(broadcast);
+}
+
+static void server_setup(Args args);
+static void server_init(Server *server, Args args, Server *workers, size_t index, const int *listeners);
+static void server_loop(Server *server);
+static void server_uring_loop(Server *server);
+static void server_uring_init(Server *server);
+static void server_uring_recv(Server *server, Session *session);
+static bool server_uring_send(Server *server, Session *session);
+static void server_uring_cancel(Server *server, Session *session);
+static bool server_uring_drain(Server *server);
+static void server_wake_all(Server *server);
+static void server_stop(Server *server);
+static void server_shutdown(Server *server);
+static void server_listen_upgrade(Server *server);
+static void server_handle_upgrade(Server *server);
+static bool server_handoff(Server *workers, size_t count);
+static int *server_takeover_listeners(int fd, Args *args);
+static void server_takeover_sessions(Server *workers, int fd);
+static void server_add_session(Server *server, Session *session);
+static void server_mark_dirty(Server *server, Session *session);
+static void server_accept(Server *server);
+static void server_handle_welcome(Server *server);
+static void server_handle_session(Server *server, Session *session, uint32_t events);
+static void server_handle_tcp_input(Server *server, Session *session);
+static void server_handle_tcp_data(Server *server, Session *session, const uint8_t *data, size_t len);
+static void server_handle_datagram(Server *server, Session *session, const uint8_t *data, size_t len);
+static void server_handle_payload(Server *server, Session *session, const PayloadView *payload);
+static void server_handle_timeout(Server *server);
+static int server_next_timeout(Server *server);
+static void server_send(Server *server, Session *session, PayloadType type, PayloadData *data);
+static void server_broadcast(Server *server, Session *except, const uint8_t *channel_id, const char *fmt, const DisplayName name);
+static void server_broadcast_view(Server *server, Session *except, const uint8_t *channel_id, const PayloadView *view);
+static void server_handle_inbox(Server *server);
+static void server_join(Server *server, Session *session, const uint8_t *channel_id);
+static void server_leave(Server *server, Session *session);
+static void server_protocol_error(Server *server, Session *session, const char *message);
+static void server_end_session(Server *server, Session *session);
+static void server_close_session(Server *server, Session *session);
+static void server_discard_output(Session *session);
+static void server_watch_output(Server *server, Session *session);
+static bool server_flush_session(Server *server, Session *session);
+static void server_flush(Server *server);
+
+static void handle_sigint(int sig) {
+    (void)sig;
+    atomic_store(&SERVER_SHOULD_STOP, true);
+
+    // write is async-signal-safe, the flag alone would be seen only once epoll_wait returns
+    uint64_t value = 1;
+    if (SERVER_WAKE_FD >= 0 && write(SERVER_WAKE_FD, &value, sizeof(value)) < 0) {
+        // The counter is already non-zero, the event loop will wake up anyway
+    }
+}
 
-Connection UDP_CONNECTION;
-Connection TCP_CONNECTION;
+static void *server_thread(void *arg) {
+    server_loop(arg);
+    return NULL;
+}
 
 void server_run(Args args) {
-    (void)args;
-    // TODO
+    server_setup(args);
+
+    // A server started with the upgrade socket of a running one takes over its welcome sockets and clients
+    int predecessor = args.upgrade && !get_error() ? handoff_connect(args.upgrade) : -1;
+    int *listeners = predecessor >= 0 ? server_takeover_listeners(predecessor, &args) : NULL;
+
+    Server *workers = get_error() ? NULL : calloc(args.threads, sizeof(Server));
+
+    if (!workers && !get_error()) {
+        set_error(Error_OutOfMemory);
+    }
+
+    size_t initialized = 0;
+
+    while (!get_error() && initialized < args.threads) {
+        server_init(&workers[initialized], args, workers, initialized, listeners ? listeners + initialized * 2 : NULL);
+        initialized += 1;
+    }
+
+    if (listeners) {
+        // Sockets of the event loops that have not been initialized
+        for (size_t i = initialized * 2; i < (size_t)args.threads * 2; i++) {
+            if (listeners[i] >= 0) close(listeners[i]);
+        }
+
+        free(listeners);
+    }
+
+    if (predecessor >= 0) {
+        if (!get_error()) server_takeover_sessions(workers, predecessor);
+        close(predecessor);
+    }
+
+    if (!get_error() && args.upgrade) {
+        server_listen_upgrade(&workers[0]);
+    }
+
+    if (!get_error()) {
+        // Signals are handled by the main thread only, the other threads inherit the mask
+        sigset_t mask, old_mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+
+        size_t started = 1;
+
+        for (; started < args.threads; started++) {
+            if (pthread_create(&workers[started].thread, NULL, server_thread, &workers[started]) != 0) {
+                eprint("Cannot create a thread for the event loop");
+                set_error(Error_Internal);
+                break;
+            }
+        }
+
+        SERVER_WAKE_FD = workers[0].inbox_event.fd;
+        pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+
+        // The first event loop runs in the main thread
+        if (started == args.threads) {
+            server_loop(&workers[0]);
+        }
+
+        server_stop(&workers[0]);
+        SERVER_WAKE_FD = -1;
+
+        for (size_t i = 1; i < started; i++) {
+            pthread_join(workers[i].thread, NULL);
+        }
+
+        if (workers[0].successor >= 0 && !server_handoff(workers, args.threads)) {
+            eprint("The new server has not taken over, disconnecting the clients");
+        }
+    }
+
+    for (size_t i = 0; i < initialized; i++) {
+        server_shutdown(&workers[i]);
+    }
+
+    tcp_destroy();
+    credentials_close(&CREDENTIALS);
+    free(workers);
+}
+
+static void server_handle_events(Server *server, struct epoll_event *events, int num_events) {
+    for (int i = 0; i < num_events; i++) {
+        EventSource *source = events[i].data.ptr;
+
+        switch (source->type) {
+            case EventSource_TcpListener:
+                server_accept(server);
+                break;
+
+            case EventSource_UdpWelcome:
+                server_handle_welcome(server);
+                break;
+
+            case EventSource_Inbox:
+                server_handle_inbox(server);
+                break;
+
+            case EventSource_Upgrade:
+                server_handle_upgrade(server);
+                break;
+
+            case EventSource_Session:
+                server_handle_session(server, (Session *)source, events[i].events);
+                break;
+        }
+    }
+}
+
+/// Sessions are freed at the end of the loop iteration since the events may still reference them
+static void server_free_closed(Server *server) {
+    Session **it = &server->closed;
+
+    while (*it) {
+        Session *session = *it;
+
+        // The ring had no room for the cancel when the session was closed
+        if (server->uring_enabled && session->mode == Mode_TCP && !session->canceled) {
+            server_uring_cancel(server, session);
+        }
+
+        // Requests of io_uring still reference the session, or the rest of the output queue is being written
+        if (session->inflight || session->output.len) {
+            it = &session->next;
+            continue;
+        }
+
+        *it = session->next;
+        timer_wheel_cancel(&server->closing, &session->close_timer);
+        session_free(session);
+    }
+}
+
+static void server_loop(Server *server) {
+    if (server->uring_enabled) {
+        server_uring_loop(server);
+        return;
+    }
+
+    struct epoll_event events[MAX_EVENT];
+
+    while (!atomic_load(&SERVER_SHOULD_STOP)) {
+        int timeout = server_next_timeout(server);
+        int num_fds = epoll_wait(server->epoll_fd, events, MAX_EVENT, timeout);
+
+        if (num_fds < 0) {
+            if (errno == EINTR) continue;
+
+            perror("ERR: epoll_wait");
+            set_error(Error_Internal);
+            server_stop(server);
+            break;
+        }
+
+        server_handle_events(server, events, num_fds);
+        server_handle_timeout(server);
+        server_flush(server);
+        server_free_closed(server);
+    }
+}
+
+static int server_socket(Server *server, int type) {
+    int fd = socket(AF_INET, type | SOCK_NONBLOCK, 0);
+
+    if (fd < 0) {
+        perror("ERR: socket");
+        set_error(Error_Socket);
+        return -1;
+    }
+
+    // Every event loop binds its own welcome sockets to the same address
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+
+    if (bind(fd, (struct sockaddr *)&server->address, sizeof(server->address)) < 0) {
+        perror("ERR: bind");
+        set_error(Error_Socket);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void server_watch(Server *server, EventSource *source) {
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = source;
+
+    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, source->fd, &event) == -1) {
+        perror("ERR: epoll_ctl");
+        set_error(Error_Internal);
+    }
+}
+
+/// Setup shared by all event loops
+static void server_setup(Args args) {
+    signal(SIGINT, handle_sigint);
+    signal(SIGTERM, handle_sigint);
+
+    // Every session needs a file descriptor, use as many as we are allowed to
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    tcp_setup();
+
+    if (args.credentials) {
+        CREDENTIALS = credentials_open(args.credentials);
+    }
+}
+
+/// The welcome sockets are either bound here, or taken over from the previous server as a pair of TCP and UDP socket
+static void server_init(Server *server, Args args, Server *workers, size_t index, const int *listeners) {
+    logfmt("Initializing event loop %lu", index);
+    memset(server, 0, sizeof(Server));
+    server->args = args;
+    server->index = index;
+    server->workers = workers;
+    server->epoll_fd = -1;
+    server->tcp_listener.type = EventSource_TcpListener;
+    server->tcp_listener.fd = -1;
+    server->udp_welcome.type = EventSource_UdpWelcome;
+    server->udp_welcome.fd = -1;
+    server->inbox_event.type = EventSource_Inbox;
+    server->inbox_event.fd = -1;
+    server->ring.fd = -1;
+    server->upgrade.type = EventSource_Upgrade;
+    server->upgrade.fd = -1;
+    server->successor = -1;
+    pthread_mutex_init(&server->inbox.lock, NULL);
+    server->channels = channel_registry_new();
+    server->udp_sessions = address_table_new();
+    timer_wheel_init(&server->timers, timestamp_now());
+    timer_wheel_init(&server->closing, timestamp_now());
+
+    server->address.sin_family = AF_INET;
+    server->address.sin_port = htons(args.port);
+
+    if (inet_pton(AF_INET, args.host, &server->address.sin_addr) != 1) {
+        eprintf("Invalid listening address %s", args.host);
+        set_error(Error_InvalidArgument);
+        return;
+    }
+
+    server->epoll_fd = epoll_create1(0);
+
+    if (server->epoll_fd < 0) {
+        perror("ERR: epoll_create");
+        set_error(Error_Internal);
+        return;
+    }
+
+    if (listeners && listeners[Mode_TCP] >= 0) {
+        server->tcp_listener.fd = listeners[Mode_TCP];
+    } else {
+        server->tcp_listener.fd = server_socket(server, SOCK_STREAM);
+        if (get_error()) return;
+
+        if (listen(server->tcp_listener.fd, SOMAXCONN) < 0) {
+            perror("ERR: listen");
+            set_error(Error_Socket);
+            return;
+        }
+    }
+
+    if (listeners && listeners[Mode_UDP] >= 0) {
+        server->udp_welcome.fd = listeners[Mode_UDP];
+    } else {
+        server->udp_welcome.fd = server_socket(server, SOCK_DGRAM);
+        if (get_error()) return;
+    }
+
+    if (args.io_uring) {
+        server_uring_init(server);
+    }
+
+    // The ring accepts the TCP clients itself
+    if (!server->uring_enabled) {
+        server_watch(server, &server->tcp_listener);
+        if (get_error()) return;
+    }
+
+    server_watch(server, &server->udp_welcome);
+    if (get_error()) return;
+
+    server->inbox_event.fd = eventfd(0, EFD_NONBLOCK);
+
+    if (server->inbox_event.fd < 0) {
+        perror("ERR: eventfd");
+        set_error(Error_Internal);
+        return;
+    }
+
+    server_watch(server, &server->inbox_event);
+    log("Initialized");
+}
+
+static void server_wake(Server *server) {
+    uint64_t value = 1;
+
+    if (write(server->inbox_event.fd, &value, sizeof(value)) < 0) {
+        // The counter is already non-zero, the event loop will wake up anyway
+    }
+}
+
+static void server_wake_all(Server *server) {
+    for (size_t i = 0; i < server->args.threads; i++) {
+        if (server->workers[i].inbox_event.fd >= 0) {
+            server_wake(&server->workers[i]);
+        }
+    }
+}
+
+/// Stop every event loop, each one is woken up to notice it
+static void server_stop(Server *server) {
+    atomic_store(&SERVER_SHOULD_STOP, true);
+    server_wake_all(server);
+}
+
+static void server_listen_upgrade(Server *server) {
+    server->upgrade.fd = handoff_listen(server->args.upgrade);
+    if (get_error()) return;
+
+    server_watch(server, &server->upgrade);
+}
+
+/// A new server connected to the upgrade socket, stop the event loops so the clients can be handed over to it
+static void server_handle_upgrade(Server *server) {
+    int fd = handoff_accept(server->upgrade.fd);
+    if (fd < 0) return;
+
+    if (server->successor >= 0) {
+        close(fd);
+        return;
+    }
+
+    log("A new server is taking over");
+    server->successor = fd;
+    server_stop(server);
+}
+
+/// Pass the welcome sockets and the sessions to the new server, every event loop has stopped already
+static bool server_handoff(Server *workers, size_t count) {
+    int fd = workers[0].successor;
+
+    HandoffHello hello = {0};
+    memcpy(hello.magic, HANDOFF_MAGIC, sizeof(hello.magic));
+    hello.threads = count;
+    hello.udp_shared = workers[0].args.udp_shared;
+    handoff_send(fd, HandoffRecord_Hello, &hello, sizeof(hello), -1);
+
+    for (size_t i = 0; i < count && !get_error(); i++) {
+        HandoffListener tcp = { i, Mode_TCP };
+        HandoffListener udp = { i, Mode_UDP };
+
+        handoff_send(fd, HandoffRecord_Listener, &tcp, sizeof(tcp), workers[i].tcp_listener.fd);
+        if (!get_error()) handoff_send(fd, HandoffRecord_Listener, &udp, sizeof(udp), workers[i].udp_welcome.fd);
+    }
+
+    for (size_t i = 0; i < count && !get_error(); i++) {
+        Server *server = &workers[i];
+
+        // The output queues have to be settled before they are sent
+        if (server->uring_enabled) {
+            server->uring_stuck = !server_uring_drain(server);
+            server->uring_enabled = false;
+        }
+
+        for (Session *session = server->sessions; session && !get_error(); session = session->next) {
+            handoff_send_session(fd, i, session);
+        }
+
+        // The new server writes what is left for the closed clients, usually their ERR and BYE
+        for (Session *session = server->closed; session && !get_error(); session = session->next) {
+            if (session->mode == Mode_TCP && session->output.len) handoff_send_session(fd, i, session);
+        }
+    }
+
+    if (!get_error()) handoff_send(fd, HandoffRecord_End, NULL, 0, -1);
+
+    // The new server acknowledges it has all the sessions
+    uint8_t ack;
+    bool done = !get_error() && recv(fd, &ack, 1, 0) == 1;
+
+    error_clear();
+    close(fd);
+    workers[0].successor = -1;
+
+    for (size_t i = 0; i < count; i++) {
+        workers[i].handed_off = done;
+    }
+
+    return done;
+}
+
+/// Receive the configuration and the welcome sockets of the running server, a pair of sockets for each event loop
+static int *server_takeover_listeners(int fd, Args *args) {
+    HandoffRecord record = handoff_recv(fd);
+    HandoffHello hello;
+
+    if (!get_error() && (record.type != HandoffRecord_Hello || record.len != sizeof(hello)
+        || memcmp(record.body, HANDOFF_MAGIC, sizeof(hello.magic)) != 0)
+    ) {
+        eprint("The running server cannot hand its clients over to this one");
+        set_error(Error_Connection);
+    }
+
+    if (get_error()) {
+        handoff_record_free(&record);
+        return NULL;
+    }
+
+    memcpy(&hello, record.body, sizeof(hello));
+    handoff_record_free(&record);
+
+    // The event loops are taken over one to one, the kernel keeps spreading the clients among the same sockets
+    args->threads = hello.threads;
+    args->udp_shared = hello.udp_shared;
+
+    size_t count = (size_t)hello.threads * 2;
+    int *listeners = malloc(count * sizeof(int));
+
+    if (!listeners) {
+        set_error(Error_OutOfMemory);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) listeners[i] = -1;
+
+    for (size_t i = 0; i < count && !get_error(); i++) {
+        record = handoff_recv(fd);
+
+        HandoffListener listener;
+
+        if (!get_error() && record.type == HandoffRecord_Listener && record.len == sizeof(listener)) {
+            memcpy(&listener, record.body, sizeof(listener));
+
+            size_t index = (size_t)listener.loop * 2 + (listener.mode == Mode_UDP);
+
+            if (listener.loop < hello.threads && listeners[index] < 0) {
+                listeners[index] = record.fd;
+                record.fd = -1;
+            }
+        }
+
+        handoff_record_free(&record);
+    }
+
+    return listeners;
+}
+
+/// Restore a session of the previous server into this event loop
+static void server_adopt_session(Server *server, Session *session, const uint8_t *channel_id) {
+    // A closed session is served like a live one until it is closed here again
+    bool closed = session->closed;
+    session->closed = false;
+
+    if (session->mode == Mode_UDP) {
+        if (session->shared_socket) session->source.fd = server->udp_welcome.fd;
+
+        session->timers = &server->timers;
+        session->udp_timeout = server->args.udp_timeout;
+
+        Timestamp deadline = timestamp_now() + session->udp_timeout;
+
+        for (SessionPending *it = session->pending; it; it = it->next) {
+            timer_wheel_arm(&server->timers, &it->timer, deadline);
+        }
+
+        address_table_insert(&server->udp_sessions, &session->address, session);
+
+        if (get_error()) {
+            session_free(session);
+            return;
+        }
+    }
+
+    server_add_session(server, session);
+
+    if (get_error()) {
+        if (session->mode == Mode_UDP) address_table_remove(&server->udp_sessions, &session->address);
+        return;
+    }
+
+    if (closed) {
+        server_close_session(server, session);
+    } else if (session->mode == Mode_TCP && server->uring_enabled) {
+        server_uring_recv(server, session);
+    }
+
+    // Nobody is told about the join, the client has been there all the time
+    if (session->state == SessionState_Open && channel_id[0]) {
+        server_join(server, session, channel_id);
+    }
+
+    if (session->output.len) {
+        server_mark_dirty(server, session);
+    }
+}
+
+/// Receive the sessions of the running server and acknowledge them
+static void server_takeover_sessions(Server *workers, int fd) {
+    size_t count = 0;
+
+    while (!get_error()) {
+        HandoffRecord record = handoff_recv(fd);
+
+        if (get_error() || record.type != HandoffRecord_Session) {
+            if (!get_error() && record.type != HandoffRecord_End) set_error(Error_Connection);
+            handoff_record_free(&record);
+            break;
+        }
+
+        uint16_t loop = 0;
+        ChannelID channel_id;
+        Session *session = handoff_session(&record, &loop, channel_id);
+        handoff_record_free(&record);
+
+        if (!session) break;
+
+        if (loop >= workers[0].args.threads) loop = 0;
+        server_adopt_session(&workers[loop], session, channel_id);
+        error_clear();
+        count += 1;
+    }
+
+    if (get_error()) {
+        eprint("Cannot take over the clients of the running server");
+
+        // Without the acknowledgement, the running server says BYE to the clients itself
+        for (size_t i = 0; i < workers[0].args.threads; i++) {
+            workers[i].handed_off = true;
+        }
+
+        return;
+    }
+
+    uint8_t ack = 0;
+
+    if (send(fd, &ack, 1, MSG_NOSIGNAL) != 1) {
+        perror("ERR: Cannot acknowledge the handoff");
+        set_error(Error_Connection);
+        return;
+    }
+
+    logfmt("Took over %lu sessions", count);
+
+    // Write what the previous server has not managed to
+    for (size_t i = 0; i < workers[0].args.threads; i++) {
+        server_flush(&workers[i]);
+    }
+}
+
+static void server_shutdown(Server *server) {
+    log("Shutting down");
+
+    // The BYEs below are sent directly, after every request of the ring is done
+    if (server->uring_enabled) {
+        server->uring_stuck = !server_uring_drain(server);
+        server->uring_enabled = false;
+    }
+
+    // Be polite to the clients, the server is not going to wait for the confirmation though
+    while (server->sessions) {
+        Session *session = server->sessions;
+        server->sessions = session->next;
+
+        // The kernel may still write into it
+        if (server->uring_stuck && session->inflight) continue;
+
+        // The clients of a handed off session do not notice anything
+        if (session->state != SessionState_End && !server->handed_off) {
+            server_send(server, session, PayloadType_Bye, NULL);
+            error_clear();
+        }
+
+        if (session->mode == Mode_TCP && !server->handed_off) {
+            session_flush(session);
+            error_clear();
+        }
+
+        session_free(session);
+    }
+
+    server->dirty = NULL;
+
+    while (server->closed) {
+        Session *session = server->closed;
+        server->closed = session->next;
+
+        if (server->uring_stuck && session->inflight) continue;
+
+        // The new server writes the rest of the output after a handoff
+        if (session->mode == Mode_TCP && !server->handed_off) {
+            session_flush(session);
+            error_clear();
+        }
+
+        session_free(session);
+    }
+
+    for (size_t i = 0; i < server->inbox.len; i++) {
+        Broadcast *broadcast = server->inbox.items[i];
+        broadcast_unref(broadcast);
+    }
+
+    free(server->inbox.items);
+    pthread_mutex_destroy(&server->inbox.lock);
+    channel_registry_free(&server->channels);
+    address_table_free(&server->udp_sessions);
+
+    if (!server->uring_stuck) uring_buffers_free(&server->ring, &server->buffers);
+    uring_free(&server->ring);
+
+    if (server->tcp_listener.fd >= 0) close(server->tcp_listener.fd);
+    if (server->udp_welcome.fd >= 0) close(server->udp_welcome.fd);
+    if (server->inbox_event.fd >= 0) close(server->inbox_event.fd);
+
+    // The socket file belongs to the new server after the handoff
+    if (server->upgrade.fd >= 0) {
+        close(server->upgrade.fd);
+        if (!server->handed_off) unlink(server->args.upgrade);
+    }
+    if (server->epoll_fd >= 0) close(server->epoll_fd);
+}
+
+/// Datagrams for a session on a shared socket arrive through the welcome socket, io_uring receives TCP by itself
+static bool server_watches(const Server *server, const Session *session) {
+    if (session->shared_socket) return false;
+    return !(server->uring_enabled && session->mode == Mode_TCP);
+}
+
+static void server_add_session(Server *server, Session *session) {
+    if (server_watches(server, session)) {
+        server_watch(server, &session->source);
+
+        if (get_error()) {
+            session_free(session);
+            return;
+        }
+
+        session->epoll_events = EPOLLIN;
+    }
+
+    session->prev = NULL;
+    session->next = server->sessions;
+    if (server->sessions) server->sessions->prev = session;
+    server->sessions = session;
+}
+
+static void server_new_tcp_session(Server *server, int fd, const struct sockaddr_in *address) {
+    logfmt("Accepted TCP client %s:%u", inet_ntoa(address->sin_addr), ntohs(address->sin_port));
+    Session *session = session_new(Mode_TCP, fd, address);
+
+    if (!session) {
+        close(fd);
+        error_clear();
+        return;
+    }
+
+    server_add_session(server, session);
+
+    if (!get_error() && server->uring_enabled) {
+        server_uring_recv(server, session);
+    }
+
+    error_clear();
+}
+
+static void server_accept(Server *server) {
+    while (1) {
+        struct sockaddr_in address;
+        socklen_t address_len = sizeof(address);
+        int fd = accept4(server->tcp_listener.fd, (struct sockaddr *)&address, &address_len, SOCK_NONBLOCK);
+
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("ERR: accept");
+            }
+
+            return;
+        }
+
+        server_new_tcp_session(server, fd, &address);
+    }
+}
+
+/// Create a UDP session with its own socket on a dynamic port
+static Session *server_new_dynamic_session(const Server *server, const struct sockaddr_in *address) {
+    struct sockaddr_in local = server->address;
+    local.sin_port = 0;
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+
+    if (fd < 0) {
+        perror("ERR: socket");
+        return NULL;
+    }
+
+    // Connected so the kernel delivers only datagrams of this client to the socket
+    if (bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0
+        || connect(fd, (const struct sockaddr *)address, sizeof(*address)) < 0
+    ) {
+        perror("ERR: Cannot setup a socket for the UDP client");
+        close(fd);
+        return NULL;
+    }
+
+    Session *session = session_new(Mode_UDP, fd, address);
+    if (!session) close(fd);
+
+    return session;
+}
+
+/// Create a UDP session, either with its own socket or served by the welcome socket
+static Session *server_new_udp_session(Server *server, const struct sockaddr_in *address) {
+    Session *session = NULL;
+
+    if (server->args.udp_shared) {
+        session = session_new(Mode_UDP, server->udp_welcome.fd, address);
+        if (session) session->shared_socket = true;
+    } else {
+        session = server_new_dynamic_session(server, address);
+    }
+
+    if (!session) return NULL;
+
+    session->timers = &server->timers;
+    session->udp_timeout = server->args.udp_timeout;
+
+    address_table_insert(&server->udp_sessions, address, session);
+
+    if (get_error()) {
+        session_free(session);
+        return NULL;
+    }
+
+    server_add_session(server, session);
+
+    if (get_error()) {
+        address_table_remove(&server->udp_sessions, address);
+        return NULL;
+    }
+
+    return session;
+}
+
+static void server_handle_welcome(Server *server) {
+    while (1) {
+        uint8_t buffer[BYTES_SIZE];
+        struct sockaddr_in address;
+        socklen_t address_len = sizeof(address);
+
+        ssize_t len = recvfrom(server->udp_welcome.fd, buffer, BYTES_SIZE, 0, (struct sockaddr *)&address, &address_len);
+        if (len < 0) return;
+
+        // Either a shared socket session, or a retransmission of a payload the session has not confirmed yet
+        Session *session = address_table_get(&server->udp_sessions, &address);
+
+        if (!session) {
+            // Nothing to start a session with
+            if (len < 3 || buffer[0] == PayloadType_Confirm) continue;
+
+            logfmt("New UDP client %s:%u", inet_ntoa(address.sin_addr), ntohs(address.sin_port));
+            session = server_new_udp_session(server, &address);
+        }
+
+        if (!session) {
+            error_clear();
+            continue;
+        }
+
+        if (!session->closed) {
+            server_handle_datagram(server, session, buffer, len);
+        }
+    }
+}
+
+static void server_handle_tcp(Server *server, Session *session) {
+    Bytes *input = &session->input;
+    size_t free_space = BYTES_SIZE - input->offset - input->len;
+    ssize_t len = recv(session->source.fd, input->data + input->offset + input->len, free_space, 0);
+
+    if (len < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            server_close_session(server, session);
+        }
+
+        return;
+    }
+
+    if (len == 0) {
+        logfmt("TCP client %d disconnected", session->source.fd);
+        server_close_session(server, session);
+        return;
+    }
+
+    input->len += len;
+    server_handle_tcp_input(server, session);
+}
+
+/// Data received by io_uring are copied into the input in chunks the input can hold
+static void server_handle_tcp_data(Server *server, Session *session, const uint8_t *data, size_t len) {
+    Bytes *input = &session->input;
+
+    while (len && !session->closed && session->state != SessionState_End) {
+        size_t free_space = BYTES_SIZE - input->offset - input->len;
+        size_t chunk = len < free_space ? len : free_space;
+
+        memcpy(input->data + input->offset + input->len, data, chunk);
+        input->len += chunk;
+        data += chunk;
+        len -= chunk;
+
+        server_handle_tcp_input(server, session);
+    }
+}
+
+static void server_handle_tcp_input(Server *server, Session *session) {
+    Bytes *input = &session->input;
+
+    // Handle every complete message
+    while (!session->closed && session->state != SessionState_End) {
+        const uint8_t *data = bytes_get(input);
+        size_t terminator = scan_crlf(data, input->len);
+
+        if (terminator == input->len) break;
+
+        // The payload references the input, skipping it does not move the data
+        PayloadView payload;
+        tcp_deserialize_view(data, terminator + 2, &payload);
+        bytes_skip_first_n(input, terminator + 2);
+
+        if (get_error()) {
+            error_clear();
+            server_protocol_error(server, session, "Received malformed payload");
+            return;
+        }
+
+        server_handle_payload(server, session, &payload);
+        error_clear();
+    }
+
+    // Move the incomplete message to the beginning
+    memmove(input->data, bytes_get(input), input->len);
+    input->offset = 0;
+
+    if (input->len == BYTES_SIZE && !session->closed) {
+        server_protocol_error(server, session, "Received payload is too long");
+    }
+}
+
+static void server_handle_session(Server *server, Session *session, uint32_t events) {
+    if (session->mode == Mode_TCP) {
+        // A closed session is watched only until the rest of its output queue is written
+        if (session->closed || (events & EPOLLOUT)) server_flush_session(server, session);
+        if (!session->closed && (events & ~EPOLLOUT)) server_handle_tcp(server, session);
+        return;
+    }
+
+    while (!session->closed) {
+        uint8_t buffer[BYTES_SIZE];
+        ssize_t len = recv(session->source.fd, buffer, BYTES_SIZE, 0);
+
+        // The error can be caused by an ICMP message, the retransmission handles the disconnection
+        if (len < 0) return;
+
+        server_handle_datagram(server, session, buffer, len);
+    }
+}
+
+static void server_handle_datagram(Server *server, Session *session, const uint8_t *data, size_t len) {
+    // Without a header, there is nothing to reply to
+    if (len < 3) return;
+
+    PayloadView payload;
+    udp_deserialize_view(data, len, &payload);
+
+    if (payload.type == PayloadType_Confirm) {
+        error_clear();
+        session_confirm(session, payload.id);
+
+        if (session->state == SessionState_End && !session->pending) {
+            server_close_session(server, session);
+        }
+
+        return;
+    }
+
+    Payload confirm;
+    confirm.type = PayloadType_Confirm;
+    confirm.id = payload.id;
+
+    if (get_error()) {
+        error_clear();
+        session_send(session, &confirm);
+        error_clear();
+        server_protocol_error(server, session, "Received malformed payload");
+        return;
+    }
+
+    session_send(session, &confirm);
+    error_clear();
+
+    if (replay_window_contains(&session->received_ids, payload.id)) {
+        log("Received duplicated payload");
+        return;
+    }
+
+    replay_window_insert(&session->received_ids, payload.id);
+
+    if (session->state != SessionState_End) {
+        server_handle_payload(server, session, &payload);
+        error_clear();
+    }
+}
+
+static void server_handle_payload(Server *server, Session *session, const PayloadView *payload) {
+    logfmt("Handling payload type %u from session %d", payload->type, session->source.fd);
+
+    switch (payload->type) {
+        case PayloadType_Auth: {
+            if (session->state != SessionState_Auth) {
+                server_protocol_error(server, session, "Already authenticated");
+                return;
+            }
+
+            PayloadData data = {0};
+            data.reply.ref_message_id = payload->id;
+
+            // The index looks up null-terminated strings
+            Username username;
+            Secret secret;
+            payload_slice_copy(username, payload->username);
+            payload_slice_copy(secret, payload->secret);
+
+            if (CREDENTIALS.map && !credentials_verify(&CREDENTIALS, username, secret)) {
+                strcpy((void *)data.reply.message_content, "Authentication failed.");
+                server_send(server, session, PayloadType_Reply, &data);
+                return;
+            }
+
+            payload_slice_copy(session->display_name, payload->display_name);
+
+            data.reply.result = true;
+            strcpy((void *)data.reply.message_content, "Authentication successful.");
+            server_send(server, session, PayloadType_Reply, &data);
+
+            session->state = SessionState_Open;
+            server_join(server, session, (const uint8_t *)DEFAULT_CHANNEL);
+            server_broadcast(server, NULL, (const uint8_t *)DEFAULT_CHANNEL, "%s has joined %s.", session->display_name);
+            return;
+        }
+
+        case PayloadType_Join: {
+            if (session->state != SessionState_Open) {
+                server_protocol_error(server, session, "Authenticate first before joining a channel");
+                return;
+            }
+
+            ChannelID channel_id;
+            payload_slice_copy(channel_id, payload->channel_id);
+            payload_slice_copy(session->display_name, payload->display_name);
+
+            PayloadData data = {0};
+            data.reply.result = true;
+            data.reply.ref_message_id = payload->id;
+            strcpy((void *)data.reply.message_content, "Join successful.");
+            server_send(server, session, PayloadType_Reply, &data);
+
+            server_leave(server, session);
+            server_join(server, session, channel_id);
+            server_broadcast(server, NULL, channel_id, "%s has joined %s.", session->display_name);
+            return;
+        }
+
+        case PayloadType_Message: {
+            if (session->state != SessionState_Open) {
+                server_protocol_error(server, session, "Authenticate first before sending messages");
+                return;
+            }
+
+            payload_slice_copy(session->display_name, payload->display_name);
+
+            // The message is serialized right from the receive buffer
+            if (session->channel) {
+                server_broadcast_view(server, session, session->channel->name, payload);
+            }
+
+            return;
+        }
+
+        case PayloadType_Err:
+            server_send(server, session, PayloadType_Bye, NULL);
+            server_end_session(server, session);
+            return;
+
+        case PayloadType_Bye:
+            server_close_session(server, session);
+            return;
+
+        case PayloadType_Reply:
+        case PayloadType_Confirm:
+            server_protocol_error(server, session, "Unexpected payload");
+            return;
+    }
+}
+
+/// The output queue of the session is written at the end of the loop iteration, together with the payloads queued later
+static void server_mark_dirty(Server *server, Session *session) {
+    if (session->dirty) return;
+
+    session->dirty = true;
+    session->next_dirty = server->dirty;
+    server->dirty = session;
+}
+
+/// The queue of a slow client is full, apply the policy of the server
+static bool server_output_full(Server *server, Session *session) {
+    // ERR and BYE of an ending session are not limited
+    if (session->state == SessionState_End) return false;
+    if (session->slow) return true;
+    if (session->output.len < server->args.output_limit) return false;
+
+    // Write what the socket accepts right away, only the rest is the backlog of a slow client
+    if (!session->sending) {
+        session_flush(session);
+
+        if (get_error()) {
+            error_clear();
+            server_discard_output(session);
+        }
+
+        if (session->output.len < server->args.output_limit) return false;
+    }
+    if (server->args.output_drop_oldest && session_output_drop_oldest(session)) return false;
+
+    // Disconnecting right away could change the channel being delivered to, see server_flush
+    session->slow = true;
+    server_mark_dirty(server, session);
+    return true;
+}
+
+/// TCP payloads are queued, the queues are written at the end of the loop iteration
+static void server_send_wire(Server *server, Session *session, Wire *wire) {
+    if (session->mode != Mode_TCP) {
+        session_send_wire(session, wire);
+        return;
+    }
+
+    if (server_output_full(server, session)) return;
+
+    session_queue_wire(session, wire);
+    if (!get_error()) server_mark_dirty(server, session);
+}
+
+static void server_send(Server *server, Session *session, PayloadType type, PayloadData *data) {
+    Payload payload = {0};
+    payload.type = type;
+    if (data) memcpy(&payload.data, data, sizeof(PayloadData));
+
+    if (session->mode != Mode_TCP) {
+        session_send(session, &payload);
+        return;
+    }
+
+    if (type == PayloadType_Confirm) return;
+
+    Wire *wire = wire_new(&payload, Mode_TCP);
+    if (!wire) return;
+
+    server_send_wire(server, session, wire);
+    wire_unref(wire);
+}
+
+static void server_broadcast(Server *server, Session *except, const uint8_t *channel_id, const char *fmt, const DisplayName name) {
+    char content[MESSAGE_CONTENT_LEN + 1];
+    int len = snprintf(content, sizeof(content), fmt, name, channel_id);
+    if (len < 0) return;
+    if ((size_t)len >= sizeof(content)) len = MESSAGE_CONTENT_LEN;
+
+    PayloadView view = {0};
+    view.type = PayloadType_Message;
+    view.display_name.data = (const uint8_t *)SERVER_DISPLAY_NAME;
+    view.display_name.len = strlen(SERVER_DISPLAY_NAME);
+    view.message_content.data = (const uint8_t *)content;
+    view.message_content.len = len;
+
+    server_broadcast_view(server, except, channel_id, &view);
+}
+
+/// Get the message serialized for the transport, it is serialized by the first recipient using the transport
+static Wire *server_wire(Wire *wires[2], Mode mode, const PayloadView *payload) {
+    if (!wires[mode]) wires[mode] = wire_new_view(payload, mode);
+    return wires[mode];
+}
+
+/// Deliver a message to the members of the channel served by this event loop
+static void server_deliver(Server *server, Session *except, const uint8_t *channel_id, Wire *wires[2], const PayloadView *payload) {
+    Channel *channel = channel_registry_get(&server->channels, channel_id);
+    if (!channel) return;
+
+    for (size_t i = 0; i < channel->len; i++) {
+        Session *member = channel->members[i];
+        if (member == except) continue;
+
+        Wire *wire = server_wire(wires, member->mode, payload);
+        if (wire) server_send_wire(server, member, wire);
+        error_clear();
+    }
+}
+
+static void server_join(Server *server, Session *session, const uint8_t *channel_id) {
+    session->channel = channel_join(&server->channels, channel_id, session, &session->channel_index);
+}
+
+/// Leave the channel and announce it to the remaining members
+static void server_leave(Server *server, Session *session) {
+    if (!session->channel) return;
+
+    // The channel is freed when its last member leaves
+    ChannelID channel_id;
+    memcpy(channel_id, session->channel->name, CHANNEL_ID_LEN + 1);
+
+    Session *moved = channel_leave(&server->channels, session->channel, session->channel_index);
+    if (moved) moved->channel_index = session->channel_index;
+
+    session->channel = NULL;
+    server_broadcast(server, NULL, channel_id, "%s has left %s.", session->display_name);
+}
+
+/// Deliver a message to the members of the channel in all event loops
+static void server_broadcast_view(Server *server, Session *except, const uint8_t *channel_id, const PayloadView *payload) {
+    Wire *wires[2] = { NULL, NULL };
+    server_deliver(server, except, channel_id, wires, payload);
+
+    size_t threads = server->args.threads;
+    Broadcast *broadcast = NULL;
+
+    if (threads > 1) {
+        broadcast = malloc(sizeof(Broadcast));
+        if (!broadcast) set_error(Error_OutOfMemory);
+    }
+
+    // The other event loops may serve clients of both transports
+    if (broadcast && (!server_wire(wires, Mode_TCP, payload) || !server_wire(wires, Mode_UDP, payload))) {
+        free(broadcast);
+        broadcast = NULL;
+    }
+
+    if (!broadcast) {
+        wire_unref(wires[Mode_TCP]);
+        wire_unref(wires[Mode_UDP]);
+        return;
+    }
+
+    atomic_init(&broadcast->refcount, threads - 1);
+    strcpy((void *)broadcast->channel_id, (void *)channel_id);
+    broadcast->wires[Mode_TCP] = wires[Mode_TCP];
+    broadcast->wires[Mode_UDP] = wires[Mode_UDP];
+
+    for (size_t i = 0; i < threads; i++) {
+        if (i == server->index) continue;
+
+        Server *worker = &server->workers[i];
+        Inbox *inbox = &worker->inbox;
+
+        pthread_mutex_lock(&inbox->lock);
+
+        if (inbox->len == inbox->cap) {
+            size_t cap = inbox->cap ? inbox->cap * 2 : 16;
+            Broadcast **items = realloc(inbox->items, cap * sizeof(Broadcast *));
+
+            if (!items) {
+                pthread_mutex_unlock(&inbox->lock);
+                broadcast_unref(broadcast);
+                continue;
+            }
+
+            inbox->items = items;
+            inbox->cap = cap;
+        }
+
+        inbox->items[inbox->len++] = broadcast;
+        bool was_empty = inbox->len == 1;
+        pthread_mutex_unlock(&inbox->lock);
+
+        // Otherwise the event loop has been woken up already and has not drained the inbox yet
+        if (was_empty) server_wake(worker);
+    }
+}
+
+static void server_handle_inbox(Server *server) {
+    uint64_t value;
+    if (read(server->inbox_event.fd, &value, sizeof(value)) < 0) {
+        // Nothing to read, the counter has been reset already
+    }
+
+    Inbox *inbox = &server->inbox;
+
+    pthread_mutex_lock(&inbox->lock);
+    Broadcast **items = inbox->items;
+    size_t len = inbox->len;
+    inbox->items = NULL;
+    inbox->len = 0;
+    inbox->cap = 0;
+    pthread_mutex_unlock(&inbox->lock);
+
+    for (size_t i = 0; i < len; i++) {
+        Broadcast *broadcast = items[i];
+        server_deliver(server, NULL, broadcast->channel_id, broadcast->wires, NULL);
+        broadcast_unref(broadcast);
+    }
+
+    free(items);
+}
+
+static void server_protocol_error(Server *server, Session *session, const char *message) {
+    PayloadData data = {0};
+    strcpy((void *)data.err.display_name, SERVER_DISPLAY_NAME);
+    strncpy((void *)data.err.message_content, message, MESSAGE_CONTENT_LEN);
+
+    server_send(server, session, PayloadType_Err, &data);
+    error_clear();
+    server_send(server, session, PayloadType_Bye, NULL);
+    error_clear();
+    server_end_session(server, session);
+}
+
+/// BYE has been sent, TCP can be closed right away, UDP has to wait for the confirmation
+static void server_end_session(Server *server, Session *session) {
+    session->state = SessionState_End;
+    server_leave(server, session);
+
+    if (session->mode == Mode_TCP || !session->pending) {
+        server_close_session(server, session);
+    }
+}
+
+static void server_close_session(Server *server, Session *session) {
+    if (session->closed) return;
+
+    logfmt("Closing session %d", session->source.fd);
+
+    session->state = SessionState_End;
+    server_leave(server, session);
+
+    if (session->mode == Mode_UDP) {
+        address_table_remove(&server->udp_sessions, &session->address);
+    }
+
+    if (session->prev) {
+        session->prev->next = session->next;
+    } else {
+        server->sessions = session->next;
+    }
+
+    if (session->next) session->next->prev = session->prev;
+
+    session->closed = true;
+
+    // The queued payloads are still sent, the session is freed after the output queue is written or the deadline passes
+    if (session->mode == Mode_TCP) {
+        timer_wheel_arm(&server->closing, &session->close_timer, timestamp_now() + CLOSE_TIMEOUT);
+    }
+
+    if (server_watches(server, session)) {
+        if (session->mode == Mode_TCP) {
+            server_watch_output(server, session);
+        } else {
+            epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, session->source.fd, NULL);
+        }
+    } else if (server->uring_enabled && session->mode == Mode_TCP) {
+        server_uring_cancel(server, session);
+    }
+
+    session->prev = NULL;
+    session->next = server->closed;
+    server->closed = session;
+}
+
+/// The client has not read the output queue of the closed session in time, drop it so the session can be freed
+static void server_expire_closed(Session *session) {
+    if (!session->output.len) return;
+
+    logfmt("Session %d has not written its output in time", session->source.fd);
+
+    // Requests of io_uring in flight on the socket fail, the payloads being sent are dropped on their completion
+    shutdown(session->source.fd, SHUT_RDWR);
+
+    if (session->sending) {
+        session_output_clear(session);
+    } else {
+        server_discard_output(session);
+    }
+}
+
+/// The output queue cannot be written anymore
+static void server_discard_output(Session *session) {
+    session->output.busy = 0;
+    session->output.offset = 0;
+    session_output_clear(session);
+}
+
+/// Watch the socket for EPOLLOUT only while the output queue cannot be written, a closed session only for that
+static void server_watch_output(Server *server, Session *session) {
+    if (!server_watches(server, session) || !session->epoll_events) return;
+
+    uint32_t events = session->closed ? 0 : EPOLLIN;
+    if (session->output.len) events |= EPOLLOUT;
+    if (events == session->epoll_events) return;
+
+    struct epoll_event event;
+    event.events = events;
+    event.data.ptr = &session->source;
+
+    if (epoll_ctl(server->epoll_fd, events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL, session->source.fd, &event) == -1) {
+        perror("ERR: epoll_ctl");
+        server_discard_output(session);
+    }
+
+    session->epoll_events = events;
+}
+
+/// Write as much of the output queue as possible by a single vectored system call, returns false to be retried later
+static bool server_flush_session(Server *server, Session *session) {
+    if (server->uring_enabled) {
+        return session->sending || !session->output.len || server_uring_send(server, session);
+    }
+
+    session_flush(session);
+
+    if (get_error()) {
+        error_clear();
+        server_discard_output(session);
+        server_close_session(server, session);
+    }
+
+    server_watch_output(server, session);
+    return true;
+}
+
+/// Write the output queues of the sessions that got new payloads during the loop iteration
+static void server_flush(Server *server) {
+    Session *retry = NULL;
+
+    while (server->dirty) {
+        Session *session = server->dirty;
+        server->dirty = session->next_dirty;
+        session->dirty = false;
+
+        if (session->slow && !session->closed) {
+            session->slow = false;
+            session_output_clear(session);
+
+            // The limit does not apply to the ERR and BYE anymore
+            session->state = SessionState_End;
+            server_protocol_error(server, session, "Too many messages waiting to be sent, the client is too slow");
+        }
+
+        // The submission queue of io_uring is full, the session stays dirty for the next loop iteration
+        if (!server_flush_session(server, session)) {
+            session->dirty = true;
+            session->next_dirty = retry;
+            retry = session;
+        }
+    }
+
+    server->dirty = retry;
+}
+
+static void server_handle_timeout(Server *server) {
+    Timestamp now = timestamp_now();
+    TimerNode *timer;
+
+    while ((timer = timer_wheel_expire(&server->timers, now))) {
+        SessionPending *pending = (SessionPending *)timer;
+        Session *session = pending->session;
+
+        // The pending payloads are freed together with the session
+        if (session->closed) continue;
+
+        if (!session_retransmit(session, pending, server->args.udp_retransmissions)) {
+            // Consider disconnected
+            server_close_session(server, session);
+        }
+    }
+
+    while ((timer = timer_wheel_expire(&server->closing, now))) {
+        server_expire_closed((Session *)((uint8_t *)timer - offsetof(Session, close_timer)));
+    }
+}
+
+static int server_next_timeout(Server *server) {
+    Timestamp now = timestamp_now();
+    int timeout = timer_wheel_next_timeout(&server->timers, now);
+    int closing = timer_wheel_next_timeout(&server->closing, now);
+
+    return timeout < 0 || (closing >= 0 && closing < timeout) ? closing : timeout;
+}
+
+static uint64_t uring_data(void *source, UringOp op) {
+    return (uint64_t)(uintptr_t)source | op;
+}
+
+/// Get an entry of the ring for a request, counted in flight until its last completion
+static struct io_uring_sqe *server_uring_sqe(Server *server) {
+    struct io_uring_sqe *sqe = uring_sqe(&server->ring);
+    if (sqe) server->uring_inflight += 1;
+
+    return sqe;
+}
+
+static void server_uring_init(Server *server) {
+    if (!uring_init(&server->ring, URING_ENTRIES)) {
+        if (server->index == 0) eprint("io_uring is not available, falling back to epoll");
+        return;
+    }
+
+    // Rings of provided buffers come with the multishot requests
+    if (!uring_buffers_init(&server->ring, &server->buffers, 0, URING_BUFFERS, URING_BUFFER_SIZE)) {
+        if (server->index == 0) eprint("io_uring lacks the provided buffer rings, falling back to epoll");
+        uring_free(&server->ring);
+        return;
+    }
+
+    server->uring_enabled = true;
+    server->multishot_recv = true;
+}
+
+/// The multishot requests are armed again by the event loop, even if the ring had no room for them
+static void server_uring_accept(Server *server) {
+    struct io_uring_sqe *sqe = server_uring_sqe(server);
+    if (!sqe) return;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server->tcp_listener.fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK;
+    sqe->user_data = uring_data(NULL, UringOp_Accept);
+    server->accepting = true;
+}
+
+static void server_uring_poll(Server *server) {
+    struct io_uring_sqe *sqe = server_uring_sqe(server);
+    if (!sqe) return;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = server->epoll_fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = EPOLLIN;
+    sqe->user_data = uring_data(NULL, UringOp_Poll);
+    server->polling = true;
+}
+
+static void server_uring_recv(Server *server, Session *session) {
+    struct io_uring_sqe *sqe = server_uring_sqe(server);
+
+    // Nothing would be received from the client anymore
+    if (!sqe) {
+        server_close_session(server, session);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = session->source.fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = server->buffers.group;
+    sqe->ioprio = server->multishot_recv ? IORING_RECV_MULTISHOT : 0;
+    sqe->user_data = uring_data(session, UringOp_Recv);
+    session->inflight += 1;
+}
+
+/// Returns false if the ring has no room for the write
+static bool server_uring_send(Server *server, Session *session) {
+    if (!session->write) {
+        session->write = calloc(1, sizeof(SessionWrite));
+
+        if (!session->write) {
+            server_discard_output(session);
+            if (!session->closed) server_close_session(server, session);
+            return true;
+        }
+    }
+
+    struct io_uring_sqe *sqe = server_uring_sqe(server);
+    if (!sqe) return false;
+
+    SessionWrite *write = session->write;
+    write->msg.msg_iov = write->iov;
+    write->msg.msg_iovlen = session_output_iov(session, write->iov, SESSION_IOV_MAX);
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = session->source.fd;
+    sqe->addr = (uint64_t)(uintptr_t)&write->msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = uring_data(session, UringOp_Send);
+    session->output.busy = write->msg.msg_iovlen;
+    session->inflight += 1;
+    session->sending = true;
+    return true;
+}
+
+/// Stop receiving from the session, retried by server_free_closed if the ring has no room for it
+static void server_uring_cancel(Server *server, Session *session) {
+    struct io_uring_sqe *sqe = server_uring_sqe(server);
+    if (!sqe) return;
+
+    session->canceled = true;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = uring_data(session, UringOp_Recv);
+    sqe->user_data = uring_data(NULL, UringOp_Cancel);
+}
+
+static void server_uring_accepted(Server *server, const struct io_uring_cqe *cqe) {
+    if (cqe->res >= 0) {
+        // Multishot accept does not return the address
+        struct sockaddr_in address = {0};
+        socklen_t address_len = sizeof(address);
+        getpeername(cqe->res, (struct sockaddr *)&address, &address_len);
+
+        server_new_tcp_session(server, cqe->res, &address);
+    } else if (cqe->res != -ECANCELED) {
+        errno = -cqe->res;
+        perror("ERR: accept");
+    }
+
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        server->accepting = false;
+    }
+}
+
+static void server_uring_received(Server *server, Session *session, const struct io_uring_cqe *cqe) {
+    bool more = cqe->flags & IORING_CQE_F_MORE;
+    if (!more) session->inflight -= 1;
+
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        uint16_t id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+        if (cqe->res > 0 && !session->closed) {
+            server_handle_tcp_data(server, session, uring_buffer(&server->buffers, id), cqe->res);
+        }
+
+        uring_buffers_recycle(&server->buffers, id);
+    }
+
+    if (session->closed) return;
+
+    if (cqe->res == -EINVAL && server->multishot_recv) {
+        // Kernels before 6.0 support only a single recv per request
+        server->multishot_recv = false;
+    } else if (cqe->res == 0) {
+        logfmt("TCP client %d disconnected", session->source.fd);
+        server_close_session(server, session);
+        return;
+    } else if (cqe->res < 0 && cqe->res != -ENOBUFS) {
+        server_close_session(server, session);
+        return;
+    }
+
+    if (!more) server_uring_recv(server, session);
+}
+
+static void server_uring_sent(Server *server, Session *session, const struct io_uring_cqe *cqe) {
+    session->inflight -= 1;
+    session->sending = false;
+    session->output.busy = 0;
+
+    if (cqe->res < 0) {
+        // Nothing else can be sent
+        server_discard_output(session);
+        if (!session->closed) server_close_session(server, session);
+        return;
+    }
+
+    session_output_sent(session, cqe->res);
+
+    // A closed session still sends its queue, BYE is usually the last item
+    if (session->output.len) server_mark_dirty(server, session);
+}
+
+static void server_uring_complete(Server *server, const struct io_uring_cqe *cqe) {
+    UringOp op = cqe->user_data & URING_OP_MASK;
+    Session *session = (Session *)(uintptr_t)(cqe->user_data & ~(uint64_t)URING_OP_MASK);
+
+    if (!(cqe->flags & IORING_CQE_F_MORE)) server->uring_inflight -= 1;
+
+    switch (op) {
+        case UringOp_Cancel:
+            break;
+
+        case UringOp_Accept:
+            server_uring_accepted(server, cqe);
+            break;
+
+        case UringOp_Recv:
+            server_uring_received(server, session, cqe);
+            break;
+
+        case UringOp_Send:
+            server_uring_sent(server, session, cqe);
+            break;
+
+        case UringOp_Poll: {
+            struct epoll_event events[MAX_EVENT];
+            int num_events = epoll_wait(server->epoll_fd, events, MAX_EVENT, 0);
+
+            if (num_events > 0) {
+                server_handle_events(server, events, num_events);
+            }
+
+            if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                server->polling = false;
+            }
+
+            break;
+        }
+    }
+}
+
+/// Like server_loop, the requests prepared during an iteration are submitted by a single system call
+static void server_uring_loop(Server *server) {
+    while (!atomic_load(&SERVER_SHOULD_STOP)) {
+        // Armed for the first time, or again after the kernel ended the multishot request
+        if (!server->accepting) server_uring_accept(server);
+        if (!server->polling) server_uring_poll(server);
+
+        int ret = uring_submit(&server->ring, server_next_timeout(server));
+
+        if (ret < 0) {
+            errno = -ret;
+            perror("ERR: io_uring_enter");
+            set_error(Error_Internal);
+            server_stop(server);
+            break;
+        }
+
+        struct io_uring_cqe *cqe;
+
+        while ((cqe = uring_cqe(&server->ring))) {
+            struct io_uring_cqe completion = *cqe;
+            uring_cqe_seen(&server->ring);
+            server_uring_complete(server, &completion);
+        }
+
+        server_handle_timeout(server);
+        server_flush(server);
+        server_free_closed(server);
+    }
+}
+
+/// Cancel every request in flight and wait for their completion, returns false if the ring failed before that
+static bool server_uring_drain(Server *server) {
+    bool cancel = true;
+
+    while (server->uring_inflight) {
+        // Ring buffers and multishot requests need kernel 5.19, which has the cancellation of all requests too
+        struct io_uring_sqe *sqe = cancel ? server_uring_sqe(server) : NULL;
+
+        if (sqe) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+            sqe->user_data = uring_data(NULL, UringOp_Cancel);
+            cancel = false;
+        }
+
+        int ret = uring_submit(&server->ring, 100);
+
+        if (ret < 0) {
+            errno = -ret;
+            perror("ERR: io_uring_enter");
+            return false;
+        }
+
+        bool completed = false;
+        struct io_uring_cqe *cqe;
+
+        while ((cqe = uring_cqe(&server->ring))) {
+            UringOp op = cqe->user_data & URING_OP_MASK;
+            Session *session = (Session *)(uintptr_t)(cqe->user_data & ~(uint64_t)URING_OP_MASK);
+
+            if (!(cqe->flags & IORING_CQE_F_MORE)) server->uring_inflight -= 1;
+
+            if (op == UringOp_Recv && !(cqe->flags & IORING_CQE_F_MORE)) {
+                session->inflight -= 1;
+            } else if (op == UringOp_Send) {
+                session->inflight -= 1;
+                session->sending = false;
+                session->output.busy = 0;
+                if (cqe->res > 0) session_output_sent(session, cqe->res);
+            }
+
+            if (op == UringOp_Recv && (cqe->flags & IORING_CQE_F_BUFFER)) {
+                uring_buffers_recycle(&server->buffers, cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            }
+
+            if (op == UringOp_Accept && cqe->res >= 0) {
+                close(cqe->res);
+            }
+
+            uring_cqe_seen(&server->ring);
+            completed = true;
+        }
+
+        // Nothing has completed for a while, cancel whatever has not been matched the last time
+        if (!completed) cancel = true;
+    }
+
+    return true;
 }
@@ -0,0 +1,317 @@
+/**
+ * @file session.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of session.h
+ */
+
+#include "session.h"
+#include "error.h"
+#include "tcp.h"
+#include "udp.h"
+#include "wire.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+Session *session_new(Mode mode, int fd, const struct sockaddr_in *address) {
+    Session *session = calloc(1, sizeof(Session));
+
+    if (!session) {
+        set_error(Error_OutOfMemory);
+        return NULL;
+    }
+
+    session->source.type = EventSource_Session;
+    session->source.fd = fd;
+    session->mode = mode;
+    session->state = SessionState_Auth;
+    session->address = *address;
+
+    replay_window_init(&session->received_ids);
+
+    return session;
+}
+
+void session_free(Session *session) {
+    logfmt("Freeing session %d", session->source.fd);
+
+    while (session->pending) {
+        SessionPending *next = session->pending->next;
+        timer_wheel_cancel(session->timers, &session->pending->timer);
+        wire_unref(session->pending->wire);
+        free(session->pending);
+        session->pending = next;
+    }
+
+    session->output.busy = 0;
+    session->output.offset = 0;
+    session_output_clear(session);
+    free(session->output.items);
+    free(session->write);
+
+    if (!session->shared_socket && close(session->source.fd) == -1) {
+        eprint("Cannot close the socket of a session");
+    }
+
+    free(session);
+}
+
+/// A shared socket is not connected to the client, the datagram has to be addressed
+static void session_send_iov(Session *session, struct iovec *iov, size_t iov_len) {
+    struct msghdr msg = {0};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_len;
+
+    if (session->shared_socket) {
+        msg.msg_name = &session->address;
+        msg.msg_namelen = sizeof(session->address);
+    }
+
+    size_t len = 0;
+    for (size_t i = 0; i < iov_len; i++) len += iov[i].iov_len;
+
+    ssize_t sent = sendmsg(session->source.fd, &msg, MSG_NOSIGNAL);
+
+    if (sent != (ssize_t)len) {
+        set_error(Error_Connection);
+    }
+}
+
+static void session_send_bytes(Session *session, const uint8_t *data, size_t len) {
+    struct iovec iov = { (void *)data, len };
+    session_send_iov(session, &iov, 1);
+}
+
+/// Send a UDP wire buffer with the header of the payload replaced, the shared buffer stays untouched
+static void session_send_udp_wire(Session *session, const Wire *wire, MessageID id) {
+    uint8_t header[WIRE_UDP_HEADER_LEN];
+    wire_udp_header(wire, id, header);
+
+    struct iovec iov[2] = {
+        { header, WIRE_UDP_HEADER_LEN },
+        { (void *)(wire->data + WIRE_UDP_HEADER_LEN), wire->len - WIRE_UDP_HEADER_LEN },
+    };
+
+    session_send_iov(session, iov, 2);
+}
+
+void session_send(Session *session, Payload *payload) {
+    if (session->mode == Mode_TCP) {
+        if (payload->type == PayloadType_Confirm) return;
+
+        struct iovec iov[PAYLOAD_IOV_MAX];
+        size_t count = tcp_serialize_iov(payload, iov);
+        if (get_error()) return;
+
+        session_send_iov(session, iov, count);
+        return;
+    }
+
+    if (payload->type == PayloadType_Confirm) {
+        uint8_t header[UDP_HEADER_MAX];
+        struct iovec iov[PAYLOAD_IOV_MAX];
+        size_t count = udp_serialize_iov(payload, header, iov);
+
+        session_send_iov(session, iov, count);
+        return;
+    }
+
+    Wire *wire = wire_new(payload, Mode_UDP);
+    if (!wire) return;
+
+    session_send_wire(session, wire);
+    wire_unref(wire);
+}
+
+void session_send_wire(Session *session, Wire *wire) {
+    if (session->mode == Mode_TCP) {
+        session_send_bytes(session, wire->data, wire->len);
+        return;
+    }
+
+    MessageID id = session->next_message_id++;
+    session_send_udp_wire(session, wire, id);
+
+    // Even if it could not be sent, retransmission may be successful
+    SessionPending *pending = malloc(sizeof(SessionPending));
+
+    if (!pending) {
+        set_error(Error_OutOfMemory);
+        return;
+    }
+
+    memset(&pending->timer, 0, sizeof(TimerNode));
+    pending->session = session;
+    pending->next = NULL;
+    pending->id = id;
+    pending->retry_count = 0;
+    pending->wire = wire_ref(wire);
+    timer_wheel_arm(session->timers, &pending->timer, timestamp_now() + session->udp_timeout);
+
+    if (session->pending_tail) {
+        session->pending_tail->next = pending;
+    } else {
+        session->pending = pending;
+    }
+
+    session->pending_tail = pending;
+}
+
+/// Index of the n-th payload of the output queue in its ring
+static size_t session_output_index(const SessionOutput *output, size_t n) {
+    return (output->head + n) & (output->cap - 1);
+}
+
+void session_queue_wire(Session *session, Wire *wire) {
+    SessionOutput *output = &session->output;
+
+    if (output->len == output->cap) {
+        size_t cap = output->cap ? output->cap * 2 : 8;
+        Wire **items = malloc(cap * sizeof(Wire *));
+
+        if (!items) {
+            set_error(Error_OutOfMemory);
+            return;
+        }
+
+        for (size_t i = 0; i < output->len; i++) {
+            items[i] = output->items[session_output_index(output, i)];
+        }
+
+        free(output->items);
+        output->items = items;
+        output->head = 0;
+        output->cap = cap;
+    }
+
+    output->items[session_output_index(output, output->len)] = wire_ref(wire);
+    output->len += 1;
+}
+
+size_t session_output_iov(const Session *session, struct iovec *iov, size_t max) {
+    const SessionOutput *output = &session->output;
+    size_t count = output->len < max ? output->len : max;
+
+    for (size_t i = 0; i < count; i++) {
+        Wire *wire = output->items[session_output_index(output, i)];
+        size_t offset = i == 0 ? output->offset : 0;
+
+        iov[i].iov_base = wire->data + offset;
+        iov[i].iov_len = wire->len - offset;
+    }
+
+    return count;
+}
+
+void session_output_sent(Session *session, size_t len) {
+    SessionOutput *output = &session->output;
+    output->offset += len;
+
+    while (output->len) {
+        Wire *wire = output->items[output->head];
+        if (output->offset < wire->len) break;
+
+        output->offset -= wire->len;
+        output->head = session_output_index(output, 1);
+        output->len -= 1;
+        wire_unref(wire);
+    }
+}
+
+void session_flush(Session *session) {
+    struct iovec iov[SESSION_IOV_MAX];
+
+    while (session->output.len) {
+        struct msghdr msg = {0};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = session_output_iov(session, iov, SESSION_IOV_MAX);
+
+        // Like writev, but without SIGPIPE
+        ssize_t sent = sendmsg(session->source.fd, &msg, MSG_NOSIGNAL);
+
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) set_error(Error_Connection);
+            return;
+        }
+
+        session_output_sent(session, sent);
+    }
+}
+
+/// Index in the queue of the first payload that can be dropped
+static size_t session_output_droppable(const SessionOutput *output) {
+    // A partially sent payload has to be finished, otherwise the stream would be broken
+    if (output->offset && !output->busy) return 1;
+    return output->busy;
+}
+
+bool session_output_drop_oldest(Session *session) {
+    SessionOutput *output = &session->output;
+    size_t first = session_output_droppable(output);
+
+    if (first >= output->len) return false;
+
+    wire_unref(output->items[session_output_index(output, first)]);
+
+    // Move the payloads before the dropped one by one place
+    for (size_t i = first; i > 0; i--) {
+        output->items[session_output_index(output, i)] = output->items[session_output_index(output, i - 1)];
+    }
+
+    output->head = session_output_index(output, 1);
+    output->len -= 1;
+    return true;
+}
+
+void session_output_clear(Session *session) {
+    SessionOutput *output = &session->output;
+    size_t first = session_output_droppable(output);
+
+    while (output->len > first) {
+        output->len -= 1;
+        wire_unref(output->items[session_output_index(output, output->len)]);
+    }
+}
+
+void session_confirm(Session *session, MessageID id) {
+    SessionPending *prev = NULL;
+
+    for (SessionPending *it = session->pending; it; prev = it, it = it->next) {
+        if (it->id != id) continue;
+
+        logfmt("Confirmed %u", id);
+
+        if (prev) {
+            prev->next = it->next;
+        } else {
+            session->pending = it->next;
+        }
+
+        if (session->pending_tail == it) {
+            session->pending_tail = prev;
+        }
+
+        timer_wheel_cancel(session->timers, &it->timer);
+        wire_unref(it->wire);
+        free(it);
+        return;
+    }
+}
+
+bool session_retransmit(Session *session, SessionPending *pending, uint8_t retransmissions) {
+    if (++pending->retry_count > retransmissions) {
+        return false;
+    }
+
+    logfmt("Retransmitting %u", pending->id);
+    session_send_udp_wire(session, pending->wire, pending->id);
+    error_clear();
+
+    timer_wheel_arm(session->timers, &pending->timer, timestamp_now() + session->udp_timeout);
+    return true;
+}
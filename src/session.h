@@ -0,0 +1,227 @@
+/**
+ * @file session.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides the data structure representing a client connected to the server.
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "args.h"
+#include "payload.h"
+#include "replay_window.h"
+#include "channel.h"
+#include "wire.h"
+#include "timer_wheel.h"
+#include "time.h"
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/// Maximum number of queued payloads written by a single system call
+#define SESSION_IOV_MAX 64
+
+/**
+ * @brief Kind of an object registered in the epoll of the server.
+ */
+typedef enum {
+    EventSource_TcpListener, /**< TCP welcome socket. */
+    EventSource_UdpWelcome, /**< UDP welcome socket. */
+    EventSource_Inbox, /**< Eventfd of the broadcasts posted by the other event loops. */
+    EventSource_Upgrade, /**< Unix socket a new server connects to when it takes over. */
+    EventSource_Session, /**< Socket of a connected client. */
+} EventSourceType;
+
+/**
+ * @brief Header of every object registered in the epoll, the epoll data pointer points to this.
+ */
+typedef struct {
+    EventSourceType type; /**< Kind of the object. */
+    int fd; /**< File descriptor being watched. */
+} EventSource;
+
+/**
+ * @brief State of a session as in the IPK2024 specification.
+ */
+typedef enum {
+    SessionState_Auth, /**< Waiting for a successful AUTH. */
+    SessionState_Open, /**< Authenticated, the client is in a channel. */
+    SessionState_End, /**< BYE has been sent, waiting for the session to be destroyed. */
+} SessionState;
+
+/**
+ * @brief Payload sent over UDP that has not been confirmed by the client yet.
+ */
+typedef struct SessionPending {
+    TimerNode timer; /**< Has to be the first member, confirmation deadline of the payload. */
+    struct Session *session; /**< Session the payload has been sent to. */
+    struct SessionPending *next; /**< Next pending payload, in order of sending. */
+    MessageID id; /**< ID of the payload. */
+    int retry_count; /**< How many times it has been retransmitted. */
+    Wire *wire; /**< Serialized payload, the MessageID in its header is replaced by the id. */
+} SessionPending;
+
+/**
+ * @brief Queue of serialized payloads waiting to be sent over TCP.
+ *
+ * The queue is written by a single vectored system call whenever the socket is writable,
+ * its length is bounded by the server, see server_send_wire.
+ */
+typedef struct {
+    Wire **items; /**< Ring of the queued payloads. */
+    size_t head; /**< Index of the first payload in the ring. */
+    size_t len; /**< Number of the queued payloads. */
+    size_t cap; /**< Capacity of the ring, a power of 2. */
+    size_t offset; /**< Bytes of the first payload that have been sent already. */
+    size_t busy; /**< Payloads at the front of the queue being sent by io_uring, they cannot be dropped. */
+} SessionOutput;
+
+/**
+ * @brief Vectored write of the output queue, it has to stay valid until io_uring completes it.
+ */
+typedef struct {
+    struct msghdr msg; /**< Message of the sendmsg request. */
+    struct iovec iov[SESSION_IOV_MAX]; /**< Parts of the queued payloads. */
+} SessionWrite;
+
+/**
+ * @brief Structure representing a client connected to the server.
+ */
+typedef struct Session {
+    EventSource source; /**< Has to be the first member, see EventSource. */
+    Mode mode; /**< Transport used by the client. */
+    SessionState state; /**< Current state of the session. */
+    bool closed; /**< The session is waiting to be freed at the end of the event loop iteration. */
+    struct sockaddr_in address; /**< Address of the client. */
+    DisplayName display_name; /**< Last display name used by the client. */
+    Channel *channel; /**< Channel the client is in, valid in the Open state. */
+    size_t channel_index; /**< Index of the session in the members of the channel. */
+
+    bool shared_socket; /**< UDP: The socket is a welcome socket of the server, it is not owned by the session. */
+    MessageID next_message_id; /**< UDP: ID of the next payload sent to the client. */
+    ReplayWindow received_ids; /**< UDP: Recently received IDs of the payloads from the client. */
+    TimerWheel *timers; /**< UDP: Wheel of the event loop holding the confirmation deadlines. */
+    uint16_t udp_timeout; /**< UDP: Confirmation timeout in milliseconds. */
+    SessionPending *pending; /**< UDP: Unconfirmed payloads, in order of sending. */
+    SessionPending *pending_tail; /**< UDP: Last item of the pending list. */
+
+    Bytes input; /**< TCP: Received data that does not form a whole message yet. */
+    SessionOutput output; /**< TCP: Payloads waiting to be sent. */
+    uint32_t epoll_events; /**< TCP: Events the socket is watched for, EPOLLOUT only while the output queue cannot be written. */
+    bool slow; /**< TCP: The output queue is full, the client is going to be disconnected. */
+    TimerNode close_timer; /**< TCP: Deadline of the closed session to write its output queue, it is freed anyway after that. */
+
+    unsigned inflight; /**< io_uring: Requests in flight referencing the session, it cannot be freed before they complete. */
+    bool sending; /**< io_uring: A write of the output queue is in flight. */
+    bool canceled; /**< io_uring: The recv of the closed session has been cancelled. */
+    SessionWrite *write; /**< io_uring: The write in flight, allocated with the first one. */
+
+    bool dirty; /**< The output queue has to be written at the end of the event loop iteration. */
+    struct Session *next_dirty; /**< Next session with the output queue to be written. */
+
+    struct Session *prev; /**< Previous session of the server. */
+    struct Session *next; /**< Next session of the server. */
+} Session;
+
+/**
+ * @brief Create a new session.
+ * @param mode Transport used by the client.
+ * @param fd Socket used to communicate with the client, it is owned by the session.
+ * @param address Address of the client.
+ * @return Pointer to the new session, NULL on failure.
+ * @note This may set Error_OutOfMemory.
+ */
+Session *session_new(Mode mode, int fd, const struct sockaddr_in *address);
+
+/**
+ * @brief Close the socket, unless it is shared, and free all resources of the session.
+ * @param session Pointer to the session.
+ */
+void session_free(Session *session);
+
+/**
+ * @brief Serialize and send a payload to the client.
+ *
+ * In UDP, the ID of the payload is assigned by the session and the payload is kept until it is confirmed,
+ * its confirmation deadline is armed in the timers of the session.
+ *
+ * @param session Pointer to the session.
+ * @param payload The payload to send.
+ * @note This may set Error_Connection or Error_OutOfMemory.
+ */
+void session_send(Session *session, Payload *payload);
+
+/**
+ * @brief Send an already serialized payload to the client.
+ *
+ * The wire buffer may be shared by many sessions, it has to be serialized for the transport of the session.
+ * In UDP, the session assigns its own ID in the header and keeps a reference to the buffer until it is confirmed.
+ *
+ * @param session Pointer to the session.
+ * @param wire The serialized payload.
+ * @note This may set Error_Connection or Error_OutOfMemory.
+ */
+void session_send_wire(Session *session, Wire *wire);
+
+/**
+ * @brief Queue a serialized payload to be sent to the client later, the session keeps a reference to it.
+ * @param session Pointer to the session.
+ * @param wire The serialized payload.
+ * @note This may set Error_OutOfMemory.
+ */
+void session_queue_wire(Session *session, Wire *wire);
+
+/**
+ * @brief Describe the front of the output queue for a vectored write.
+ * @param session Pointer to the session.
+ * @param iov Output, the parts of the queued payloads.
+ * @param max Maximum number of the parts.
+ * @return Number of the parts.
+ */
+size_t session_output_iov(const Session *session, struct iovec *iov, size_t max);
+
+/**
+ * @brief Advance the output queue after a part of it has been sent.
+ * @param session Pointer to the session.
+ * @param len Number of bytes sent from the front of the queue.
+ */
+void session_output_sent(Session *session, size_t len);
+
+/**
+ * @brief Write as much of the output queue as the socket accepts without blocking.
+ * @param session Pointer to the session.
+ * @note This may set Error_Connection.
+ */
+void session_flush(Session *session);
+
+/**
+ * @brief Drop the oldest payload of the output queue that has not been started to be sent.
+ * @param session Pointer to the session.
+ * @return false if there is not any such payload.
+ */
+bool session_output_drop_oldest(Session *session);
+
+/**
+ * @brief Drop every payload of the output queue that has not been started to be sent.
+ * @param session Pointer to the session.
+ */
+void session_output_clear(Session *session);
+
+/**
+ * @brief Mark a UDP payload sent to the client as confirmed.
+ * @param session Pointer to the session.
+ * @param id ID of the confirmed payload.
+ */
+void session_confirm(Session *session, MessageID id);
+
+/**
+ * @brief Retransmit a UDP payload whose confirmation deadline has passed and arm the next deadline.
+ * @param session Pointer to the session.
+ * @param pending The expired payload of the session.
+ * @param retransmissions Maximum number of retransmissions.
+ * @return false if the payload exceeded the number of retransmissions, true otherwise.
+ */
+bool session_retransmit(Session *session, SessionPending *pending, uint8_t retransmissions);
+
+#endif
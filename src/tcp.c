@@ -7,8 +7,10 @@
 #include "tcp.h"
 #include "error.h"
 #include "bytes.h"
-#include "trie.h"
+#include "scan.h"
+#include <ctype.h>
 #include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/socket.h>
@@ -20,49 +22,147 @@
  */
 #define TCP_CONNECT_TIMEOUT 5000
 
+/// Number of states the DFA can have, state 0 rejects and state 1 starts
+#define TCP_DFA_STATES 128
+
+/// Maximum number of fields of a message
+#define TCP_RULE_FIELDS 3
+
 /**
- * @brief Check if a byte array starts with a given null-terminated C string.
- *
- * @param bytes Pointer to the byte array to check.
- * @param len Length of the byte array.
- * @param str Pointer to the null-terminated C string to compare.
- * @return true if the byte array starts with the given C string, false otherwise.
+ * @brief Field of a message, read as a whole by its scan.
  */
-static bool starts_with(const Bytes *bytes, const char *str);
+typedef struct {
+    size_t offset; /**< Offset of the PayloadSlice of the field in PayloadView. */
+    size_t limit; /**< Maximum length of the field. */
+    size_t (*scan)(const uint8_t *data, size_t len); /**< Scan for the first byte that cannot be in the field. */
+} TcpField;
 
-static int tcp_prefix_index(uint8_t ch);
+#define TCP_FIELD(member, limit, scan) { offsetof(PayloadView, member), limit, scan }
 
-Trie *TCP_TRIE;
+/**
+ * @brief Grammar of a message.
+ */
+typedef struct {
+    PayloadType type; /**< Type of the message. */
+    bool result; /**< Result of a REPLY. */
+    const char *pattern; /**< The keywords and separators, matched case-insensitively, each % is the next field. */
+    TcpField fields[TCP_RULE_FIELDS]; /**< The fields in the order of the pattern. */
+} TcpRule;
+
+static const TcpRule TCP_RULES[] = {
+    { PayloadType_Join, false, "JOIN % AS %\r\n", {
+        TCP_FIELD(channel_id, CHANNEL_ID_LEN, scan_id),
+        TCP_FIELD(display_name, DISPLAY_NAME_LEN, scan_display_name),
+    } },
+    { PayloadType_Auth, false, "AUTH % AS % USING %\r\n", {
+        TCP_FIELD(username, USERNAME_LEN, scan_id),
+        TCP_FIELD(display_name, DISPLAY_NAME_LEN, scan_display_name),
+        TCP_FIELD(secret, SECRET_LEN, scan_id),
+    } },
+    { PayloadType_Message, false, "MSG FROM % IS %\r\n", {
+        TCP_FIELD(display_name, DISPLAY_NAME_LEN, scan_display_name),
+        TCP_FIELD(message_content, MESSAGE_CONTENT_LEN, scan_message_content),
+    } },
+    { PayloadType_Err, false, "ERR FROM % IS %\r\n", {
+        TCP_FIELD(display_name, DISPLAY_NAME_LEN, scan_display_name),
+        TCP_FIELD(message_content, MESSAGE_CONTENT_LEN, scan_message_content),
+    } },
+    { PayloadType_Reply, true, "REPLY OK IS %\r\n", {
+        TCP_FIELD(message_content, MESSAGE_CONTENT_LEN, scan_message_content),
+    } },
+    { PayloadType_Reply, false, "REPLY NOK IS %\r\n", {
+        TCP_FIELD(message_content, MESSAGE_CONTENT_LEN, scan_message_content),
+    } },
+    { PayloadType_Bye, false, "BYE\r\n", {{0}} },
+};
+
+/**
+ * @brief State of the DFA recognizing every message of the grammar.
+ *
+ * A state reading a field is entered by the first byte of the field, the whole field is then
+ * taken by its scan and the DFA continues with the byte following it.
+ */
+typedef struct {
+    uint8_t next[256]; /**< Next state for each byte. */
+    const TcpField *field; /**< Field read in this state, NULL if none. */
+    const TcpRule *accept; /**< Rule of the message fully read in this state, NULL if not complete. */
+} TcpState;
+
+static TcpState TCP_DFA[TCP_DFA_STATES];
+static size_t TCP_DFA_LEN;
+
+/// Next state on the byte, a new one is created if there is no transition yet
+static uint8_t tcp_dfa_follow(uint8_t state, uint8_t byte) {
+    if (TCP_DFA[state].next[byte]) return TCP_DFA[state].next[byte];
+
+    if (TCP_DFA_LEN == TCP_DFA_STATES) {
+        set_error(Error_Internal);
+        return 0;
+    }
+
+    uint8_t next = TCP_DFA_LEN++;
+    TCP_DFA[state].next[byte] = next;
+    return next;
+}
 
 void tcp_setup() {
-    TCP_TRIE = trie_new(tcp_prefix_index);
-    if (get_error()) return;
+    // The table depends only on the grammar, it is generated once
+    if (TCP_DFA_LEN) return;
+
+    log("Generating the TCP parser");
+    TCP_DFA_LEN = 2;
+
+    for (size_t i = 0; i < sizeof(TCP_RULES) / sizeof(TCP_RULES[0]); i++) {
+        const TcpRule *rule = &TCP_RULES[i];
+        const TcpField *field = rule->fields;
+        uint8_t state = 1;
+
+        for (const char *p = rule->pattern; *p && !get_error(); p++) {
+            if (*p != '%') {
+                // Rules share their common beginning, the keywords are matched in any case
+                uint8_t next = tcp_dfa_follow(state, toupper(*p));
+                TCP_DFA[state].next[tolower(*p)] = next;
+                state = next;
+                continue;
+            }
+
+            uint8_t next = TCP_DFA_LEN < TCP_DFA_STATES ? TCP_DFA_LEN++ : 0;
+            TCP_DFA[next].field = field;
+
+            for (int byte = 0; byte < 256; byte++) {
+                uint8_t ch = byte;
+                if (!field->scan(&ch, 1)) continue;
+
+                // A field cannot start where another rule continues by a keyword
+                if (TCP_DFA[state].next[ch]) next = 0;
+
+                TCP_DFA[state].next[ch] = next;
+                TCP_DFA[next].next[ch] = next;
+            }
+
+            if (!next) set_error(Error_Internal);
+
+            state = next;
+            field += 1;
+        }
 
-    char *prefixes[] = {"JOIN ", "AUTH ", "MSG FROM ", "ERR FROM ", "REPLY ", "BYE\r\n", NULL };
-    PayloadType payload_type[] = {
-        PayloadType_Join,
-        PayloadType_Auth,
-        PayloadType_Message,
-        PayloadType_Err,
-        PayloadType_Reply,
-        PayloadType_Bye,
-    };
-
-    log("Establish TCP connection");
-    for (int i = 0; prefixes[i]; i++) {
-        trie_insert(TCP_TRIE, (void *)prefixes[i], payload_type[i]);
-        if (get_error()) return;
+        TCP_DFA[state].accept = rule;
     }
 
-    log("Established");
+    if (get_error()) {
+        eprint("Cannot generate the TCP parser");
+        return;
+    }
+
+    logfmt("Generated %zu states", TCP_DFA_LEN);
 }
 
 void tcp_destroy() {
-    trie_free(TCP_TRIE);
+    // The table is static and stays for the next connection
 }
 
 void tcp_connect(Connection *conn) {
-    // setup the trie
+    // setup the parser
     tcp_setup();
     if (get_error()) return;
 
@@ -95,104 +195,141 @@ void tcp_connect(Connection *conn) {
     }
 }
 
-void tcp_send(Connection *conn, Payload payload) {
-    if (payload.type == PayloadType_Confirm) {
+void tcp_send(Connection *conn, const PayloadView *payload) {
+    if (payload->type == PayloadType_Confirm) {
         /// We do not send confirm in TCP
         return;
     }
     
-    Bytes bytes = tcp_serialize(&payload);
+    struct msghdr msg = {0};
+    struct iovec iov[PAYLOAD_IOV_MAX];
+    msg.msg_iov = iov;
+    msg.msg_iovlen = tcp_serialize_view_iov(payload, iov);
 
     if (get_error()) return;
 
-    logfmt("Sending message: %s", bytes.data);
-    if (send(conn->sockfd, bytes.data, bytes.len, 0) < 0) {
+    logfmt("Sending payload type %u", payload->type);
+    if (sendmsg(conn->sockfd, &msg, 0) < 0) {
         set_error(Error_Connection);
         perror("ERR: Cannot send packet to the server");
     }
-
-    bytes_clear(&bytes);
 }
 
-Payload tcp_receive(Connection *conn) {
+PayloadView tcp_receive(Connection *conn) {
     log("Receiving TCP packet");
-    Payload payload;
-    Bytes buffer = bytes_new();
+    PayloadView payload = {0};
+    const uint8_t *data;
+    size_t len;
 
-    ssize_t len = recv(conn->sockfd, buffer.data, BYTES_SIZE, 0);
+    if (!framer_next_view(&conn->framer, &data, &len)) {
+        if (get_error()) return payload;
 
-    if (len < 0) {
-        set_error(Error_Connection);
-        perror("ERR: Cannot receive packet from the server");
-    } else {
-        buffer.len = len;
-        payload = tcp_deserialize(buffer);
-        logfmt("Received payload type %u", payload.type);
+        ssize_t read = framer_read(&conn->framer, conn->sockfd);
+
+        if (read < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                set_error(Error_NoPayload);
+                return payload;
+            }
+
+            set_error(Error_Connection);
+            perror("ERR: Cannot receive packet from the server");
+            return payload;
+        }
+
+        if (read == 0) {
+            set_error(Error_Connection);
+            eprint("The server has closed the connection");
+            return payload;
+        }
+
+        if (!framer_next_view(&conn->framer, &data, &len)) {
+            // Only a part of a message has arrived, the rest comes with the next read
+            if (!get_error()) set_error(Error_NoPayload);
+            return payload;
+        }
     }
 
+    tcp_deserialize_view(data, len, &payload);
+    logfmt("Received payload type %u", payload.type);
     return payload;
 }
 
+bool tcp_pending(Connection *conn) {
+    return framer_pending(&conn->framer);
+}
+
 void tcp_disconnect(Connection *conn) {
     log("Disconnecting TCP connection");
     shutdown(conn->sockfd, SHUT_RDWR);
     tcp_destroy();
 }
 
-Bytes tcp_serialize(const Payload *payload) {
+size_t tcp_serialize_iov(const Payload *payload, struct iovec iov[PAYLOAD_IOV_MAX]) {
+    PayloadView view = payload_view(payload);
+    return tcp_serialize_view_iov(&view, iov);
+}
+
+size_t tcp_serialize_view_iov(const PayloadView *view, struct iovec iov[PAYLOAD_IOV_MAX]) {
     // Don't have to validate the input since it has been validated in command parsing state
-    Bytes buffer = bytes_new();
-    
+    size_t count = 0;
+
+    // The keywords are static, their length is known at compile time
     #define PUSH(str) \
-        if (strlen((void *)str) == 0) { \
+        iov[count].iov_base = (void *)str; \
+        iov[count++].iov_len = sizeof(str) - 1
+
+    #define PUSH_FIELD(field) \
+        iov[count].iov_base = (void *)field.data; \
+        iov[count].iov_len = field.len; \
+        if (iov[count++].iov_len == 0) { \
             set_error(Error_InvalidPayload); \
-            return buffer; \
-        } \
-        bytes_push_c_str(&buffer, (char *)str); \
-        if (get_error()) return buffer
+            return 0; \
+        }
 
-    switch (payload->type) {
+    switch (view->type) {
         case PayloadType_Confirm:
             set_error(Error_InvalidPayload);
-            return buffer;
+            return 0;
 
         case PayloadType_Auth:
             PUSH("AUTH ");
-            PUSH(payload->data.auth.username);
+            PUSH_FIELD(view->username);
             PUSH(" AS ");
-            PUSH(payload->data.auth.display_name);
+            PUSH_FIELD(view->display_name);
             PUSH(" USING ");
-            PUSH(payload->data.auth.secret);
+            PUSH_FIELD(view->secret);
             break;
 
         case PayloadType_Reply:
-            PUSH("REPLY ");
-            if (!payload->data.reply.result) {
-                PUSH("N");
+            if (view->result) {
+                PUSH("REPLY OK IS ");
+            } else {
+                PUSH("REPLY NOK IS ");
             }
-            PUSH("OK IS ");
-            PUSH(payload->data.reply.message_content);
+
+            PUSH_FIELD(view->message_content);
             break;
 
         case PayloadType_Join:
             PUSH("JOIN ");
-            PUSH(payload->data.join.channel_id);
+            PUSH_FIELD(view->channel_id);
             PUSH(" AS ");
-            PUSH(payload->data.join.display_name);
+            PUSH_FIELD(view->display_name);
             break;
 
         case PayloadType_Message:
             PUSH("MSG FROM ");
-            PUSH(payload->data.message.display_name);
+            PUSH_FIELD(view->display_name);
             PUSH(" IS ");
-            PUSH(payload->data.message.message_content);
+            PUSH_FIELD(view->message_content);
             break;
 
         case PayloadType_Err:
             PUSH("ERR FROM ");
-            PUSH(payload->data.message.display_name);
+            PUSH_FIELD(view->display_name);
             PUSH(" IS ");
-            PUSH(payload->data.message.message_content);
+            PUSH_FIELD(view->message_content);
             break;
 
         case PayloadType_Bye:
@@ -202,101 +339,70 @@ Bytes tcp_serialize(const Payload *payload) {
 
     PUSH("\r\n");
 
-    return buffer;
+    return count;
 }
 
-Payload tcp_deserialize(Bytes buffer) {
-    Payload payload;
-    ssize_t read;
-
-    #define READ(select, buf) \
-        read = read_##buf(payload.data.select.buf, &buffer); \
-        if (read <= 0) { \
-            set_error(Error_InvalidPayload); \
-            return payload; \
-        } \
-        bytes_skip_first_n(&buffer, read)
-
-    #define SKIP_STR(str) \
-        if (!starts_with(&buffer, str)) { \
-            set_error(Error_InvalidPayload); \
-            return payload; \
-        } \
-        bytes_skip_first_n(&buffer, strlen(str))
+Bytes tcp_serialize(const Payload *payload) {
+    Bytes buffer = bytes_new();
+    struct iovec iov[PAYLOAD_IOV_MAX];
+    size_t count = tcp_serialize_iov(payload, iov);
 
-    int maybe_payload_type = trie_match_prefix(TCP_TRIE, bytes_get(&buffer));
+    for (size_t i = 0; i < count && !get_error(); i++) {
+        bytes_push_arr(&buffer, iov[i].iov_base, iov[i].iov_len);
+    }
 
-    switch (maybe_payload_type) {
-        case PayloadType_Join:
-            bytes_skip_first_n(&buffer, strlen("JOIN "));
-            READ(join, channel_id); 
-            SKIP_STR(" AS ");
-            READ(join, display_name); 
-            SKIP_STR("\r\n");
-            break;
+    return buffer;
+}
 
-        case PayloadType_Auth:
-            bytes_skip_first_n(&buffer, strlen("AUTH "));
-            READ(auth, username); 
-            SKIP_STR(" AS ");
-            READ(auth, display_name); 
-            SKIP_STR(" USING ");
-            READ(auth, secret); 
-            SKIP_STR("\r\n");
-            break;
+Payload tcp_deserialize(Bytes buffer) {
+    PayloadView view;
+    tcp_deserialize_view(bytes_get(&buffer), buffer.len, &view);
 
-        case PayloadType_Reply:
-            bytes_skip_first_n(&buffer, strlen("REPLY "));
+    if (get_error()) {
+        Payload payload = {0};
+        return payload;
+    }
 
-            payload.data.reply.result = bytes_get(&buffer)[0] != 'N';
-            bytes_skip_first_n(&buffer, !payload.data.reply.result);
+    Payload payload;
+    payload_from_view(&payload, &view);
+    return payload;
+}
 
-            SKIP_STR("OK IS ");
-            READ(reply, message_content); 
-            SKIP_STR("\r\n");
-            break;
+void tcp_deserialize_view(const uint8_t *data, size_t len, PayloadView *view) {
+    memset(view, 0, sizeof(PayloadView));
+    uint8_t state = 1;
 
-        case PayloadType_Message:
-            bytes_skip_first_n(&buffer, strlen("MSG FROM "));
-            READ(message, display_name); 
-            SKIP_STR(" IS ");
-            READ(message, message_content); 
-            SKIP_STR("\r\n");
-            break;
+    for (size_t i = 0; i < len && state;) {
+        state = TCP_DFA[state].next[data[i]];
+        const TcpField *field = TCP_DFA[state].field;
 
-        case PayloadType_Err:
-            bytes_skip_first_n(&buffer, strlen("ERR FROM "));
-            READ(err, display_name); 
-            SKIP_STR(" IS ");
-            READ(err, message_content); 
-            SKIP_STR("\r\n");
-            break;
+        if (!field) {
+            i += 1;
+            continue;
+        }
 
-        case PayloadType_Bye:
-            bytes_skip_first_n(&buffer, strlen("BYE\r\n"));
-            break;
+        size_t field_len = field->scan(data + i, len - i);
 
-        default:
+        if (field_len > field->limit) {
             set_error(Error_InvalidPayload);
-            return payload;
+            return;
+        }
+
+        // The field stays where it has been received
+        PayloadSlice *slice = (PayloadSlice *)((uint8_t *)view + field->offset);
+        slice->data = data + i;
+        slice->len = field_len;
+        i += field_len;
     }
 
-    /// It should be fully deserialized with nothing left
-    if (buffer.len != 0) set_error(Error_InvalidPayload);
-
-    payload.type = maybe_payload_type;
-    return payload;
-}
-
+    // Nothing can follow the \r\n, so the message has been read entirely
+    const TcpRule *rule = TCP_DFA[state].accept;
 
-static bool starts_with(const Bytes *bytes, const char *str) {
-    if (bytes->len < strlen(str)) return false;
-    return memcmp(bytes_get(bytes), str, strlen(str)) == 0;
-}
+    if (!rule) {
+        set_error(Error_InvalidPayload);
+        return;
+    }
 
-static int tcp_prefix_index(uint8_t ch) {
-    if (ch == ' ') return 26;
-    ch |= 1 << 5; // an ASCII trick to make a character lowercase.
-    if (ch >= 'a' && ch <= 'z') return ch - 'a';
-    return -1;
+    view->type = rule->type;
+    view->result = rule->result;
 }
@@ -10,6 +10,7 @@
 
 #include "connection.h"
 #include <stdint.h>
+#include <sys/uio.h>
 
 /**
  * @brief Establish a non-blocing TCP connection to the specified host and port.
@@ -20,16 +21,29 @@ void tcp_connect(Connection *connection);
 /**
  * @brief Send a payload over a TCP connection.
  * @param connection Pointer to the Connection object representing the TCP connection.
- * @param payload The payload to send.
+ * @param payload Pointer to the payload to send, its fields are written from where they are.
  */
-void tcp_send(Connection *connection, Payload payload);
+void tcp_send(Connection *connection, const PayloadView *payload);
 
 /**
  * @brief Receive a payload over a TCP connection.
+ *
+ * A buffered message is returned without reading from the socket, otherwise the socket is read once
+ * and the first message completed by the read is returned.
+ *
  * @param connection Pointer to the Connection object representing the TCP connection.
- * @return The received payload.
+ * @return The received payload, referencing the framer of the connection until the next receive.
+ * @note This sets Error_NoPayload if the read has not completed any message,
+ * Error_Connection if the server has closed the connection.
  */
-Payload tcp_receive(Connection *connection);
+PayloadView tcp_receive(Connection *connection);
+
+/**
+ * @brief Check whether a complete message is buffered.
+ * @param connection Pointer to the Connection object representing the TCP connection.
+ * @return true if the next tcp_receive does not read from the socket.
+ */
+bool tcp_pending(Connection *connection);
 
 /**
  * @brief Disconnect from a TCP connection.
@@ -45,6 +59,24 @@ void tcp_setup();
 /// Exporting this just for testing purpose
 void tcp_destroy();
 
+/**
+ * @brief Serialize a payload into pieces referencing the static keywords and the fields of the payload.
+ * @param payload Pointer to the payload, it has to outlive the pieces.
+ * @param iov Output, the pieces in the order of the message.
+ * @return Number of the pieces.
+ * @note This may set Error_InvalidPayload if the payload cannot be sent over TCP or has an empty field.
+ */
+size_t tcp_serialize_iov(const Payload *payload, struct iovec iov[PAYLOAD_IOV_MAX]);
+
+/**
+ * @brief Serialize a payload into pieces referencing the static keywords and the fields referenced by the view.
+ * @param view Pointer to the view, its fields have to outlive the pieces.
+ * @param iov Output, the pieces in the order of the message.
+ * @return Number of the pieces.
+ * @note This may set Error_InvalidPayload if the payload cannot be sent over TCP or has an empty field.
+ */
+size_t tcp_serialize_view_iov(const PayloadView *view, struct iovec iov[PAYLOAD_IOV_MAX]);
+
 /// Serialize payload into bytes to be sent to the server
 /// Exported for testing purpose
 Bytes tcp_serialize(const Payload *payload);
@@ -53,4 +85,13 @@ Bytes tcp_serialize(const Payload *payload);
 /// Exported for testing purpose
 Payload tcp_deserialize(Bytes bytes);
 
+/**
+ * @brief Parse and validate a message where it has been received.
+ * @param data The message including its \r\n.
+ * @param len Length of the message.
+ * @param view Output, the payload referencing its fields in the data.
+ * @note This sets Error_InvalidPayload if the message is malformed.
+ */
+void tcp_deserialize_view(const uint8_t *data, size_t len, PayloadView *view);
+
 #endif
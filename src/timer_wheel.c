@@ -0,0 +1,120 @@
+/**
+ * @file timer_wheel.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of timer_wheel.h
+ */
+
+#include "timer_wheel.h"
+#include <string.h>
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define BITMAP_WORDS (TIMER_WHEEL_SLOTS / 64)
+
+static bool wheel_occupied(const TimerWheel *wheel, size_t slot) {
+    return wheel->occupied[slot / 64] & (1ULL << (slot % 64));
+}
+
+void timer_wheel_init(TimerWheel *wheel, Timestamp now) {
+    memset(wheel, 0, sizeof(TimerWheel));
+    wheel->current = now;
+}
+
+void timer_wheel_arm(TimerWheel *wheel, TimerNode *node, Timestamp deadline) {
+    timer_wheel_cancel(wheel, node);
+
+    // A deadline in the past goes to the next slot to be expired
+    size_t slot = (deadline < wheel->current ? wheel->current : deadline) & SLOT_MASK;
+
+    node->deadline = deadline;
+    node->slot = slot;
+    node->armed = true;
+    node->prev = NULL;
+    node->next = wheel->slots[slot];
+
+    if (node->next) node->next->prev = node;
+
+    wheel->slots[slot] = node;
+    wheel->occupied[slot / 64] |= 1ULL << (slot % 64);
+    wheel->len += 1;
+}
+
+void timer_wheel_cancel(TimerWheel *wheel, TimerNode *node) {
+    if (!node->armed) return;
+
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        wheel->slots[node->slot] = node->next;
+    }
+
+    if (node->next) node->next->prev = node->prev;
+
+    if (!wheel->slots[node->slot]) {
+        wheel->occupied[node->slot / 64] &= ~(1ULL << (node->slot % 64));
+    }
+
+    node->armed = false;
+    node->prev = NULL;
+    node->next = NULL;
+    wheel->len -= 1;
+}
+
+TimerNode *timer_wheel_expire(TimerWheel *wheel, Timestamp now) {
+    // Nothing to visit, the timers armed later start from now
+    if (!wheel->len) {
+        if (wheel->current < now) wheel->current = now;
+        return NULL;
+    }
+
+    // Every slot is visited at most once no matter how long the event loop has been blocked
+    if (wheel->current <= now && now - wheel->current >= TIMER_WHEEL_SLOTS) {
+        wheel->current = now - TIMER_WHEEL_SLOTS + 1;
+    }
+
+    while (wheel->current <= now) {
+        size_t slot = wheel->current & SLOT_MASK;
+
+        if (wheel_occupied(wheel, slot)) {
+            for (TimerNode *it = wheel->slots[slot]; it; it = it->next) {
+                if (it->deadline > now) continue;
+
+                timer_wheel_cancel(wheel, it);
+                return it;
+            }
+        }
+
+        // The current millisecond is not over yet, more timers may be armed into it
+        if (wheel->current == now) break;
+
+        wheel->current += 1;
+    }
+
+    return NULL;
+}
+
+int timer_wheel_next_timeout(const TimerWheel *wheel, Timestamp now) {
+    if (!wheel->len) return -1;
+
+    size_t start = wheel->current & SLOT_MASK;
+    size_t distance = TIMER_WHEEL_SLOTS;
+
+    // Find the first occupied slot at or after the current one, wrapping around the wheel
+    for (size_t i = 0; i <= BITMAP_WORDS; i++) {
+        size_t word = (start / 64 + i) % BITMAP_WORDS;
+        uint64_t bits = wheel->occupied[word];
+
+        // The slots before the current one are in the same word, they are the last to be visited
+        if (i == 0) bits &= ~0ULL << (start % 64);
+        if (!bits) continue;
+
+        size_t slot = word * 64 + __builtin_ctzll(bits);
+        distance = (slot - start) & SLOT_MASK;
+        break;
+    }
+
+    Timestamp deadline = wheel->current + distance;
+    if (deadline <= now) return 0;
+
+    return deadline - now;
+}
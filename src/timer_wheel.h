@@ -0,0 +1,85 @@
+/**
+ * @file timer_wheel.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides a hashed timer wheel holding the deadlines of many timers with constant cost per timer.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "time.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Number of slots of the wheel, one slot per millisecond, has to be a power of 2 and a multiple of 64
+#define TIMER_WHEEL_SLOTS 1024
+
+/**
+ * @brief Timer embedded into the structure it belongs to.
+ */
+typedef struct TimerNode {
+    struct TimerNode *prev; /**< Previous timer in the slot. */
+    struct TimerNode *next; /**< Next timer in the slot. */
+    Timestamp deadline; /**< When the timer expires. */
+    size_t slot; /**< Slot the timer is in. */
+    bool armed; /**< The timer is in the wheel. */
+} TimerNode;
+
+/**
+ * @brief Hashed timer wheel.
+ *
+ * A timer is put into the slot of its deadline modulo the number of slots, deadlines further than
+ * TIMER_WHEEL_SLOTS milliseconds stay in their slot for more turns of the wheel.
+ * Arming and cancelling cost constant time, expiring visits only the slots of the elapsed milliseconds.
+ */
+typedef struct {
+    TimerNode *slots[TIMER_WHEEL_SLOTS]; /**< Timers in each slot. */
+    uint64_t occupied[TIMER_WHEEL_SLOTS / 64]; /**< Bitmap of the non-empty slots. */
+    Timestamp current; /**< First millisecond that has not been expired yet. */
+    size_t len; /**< Number of armed timers. */
+} TimerWheel;
+
+/**
+ * @brief Initialize an empty wheel.
+ * @param wheel Pointer to the wheel.
+ * @param now The current timestamp.
+ */
+void timer_wheel_init(TimerWheel *wheel, Timestamp now);
+
+/**
+ * @brief Arm a timer, rearming it if it is armed already.
+ * @param wheel Pointer to the wheel.
+ * @param node Pointer to the timer.
+ * @param deadline When the timer expires.
+ */
+void timer_wheel_arm(TimerWheel *wheel, TimerNode *node, Timestamp deadline);
+
+/**
+ * @brief Remove a timer from the wheel, nothing happens if it is not armed.
+ * @param wheel Pointer to the wheel.
+ * @param node Pointer to the timer.
+ */
+void timer_wheel_cancel(TimerWheel *wheel, TimerNode *node);
+
+/**
+ * @brief Take out a timer whose deadline has passed.
+ * @param wheel Pointer to the wheel.
+ * @param now The current timestamp.
+ * @return Pointer to the expired timer, which is not armed anymore, NULL if no timer has expired.
+ */
+TimerNode *timer_wheel_expire(TimerWheel *wheel, Timestamp now);
+
+/**
+ * @brief Get the time until the next non-empty slot of the wheel.
+ *
+ * The slot may contain only timers of the later turns of the wheel, so the time may be shorter than the closest deadline.
+ *
+ * @param wheel Pointer to the wheel.
+ * @param now The current timestamp.
+ * @return The time in milliseconds, -1 if there is not any armed timer.
+ */
+int timer_wheel_next_timeout(const TimerWheel *wheel, Timestamp now);
+
+#endif
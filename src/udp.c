@@ -5,16 +5,22 @@
  * @brief Implementation for udp.h
  */
 
+// recvmmsg, sendmmsg
+#define _GNU_SOURCE
+
 #include "udp.h"
 #include "connection.h"
 #include "error.h"
 #include "payload.h"
+#include "scan.h"
 #include <netdb.h>
 #include <netinet/in.h>
+#include <errno.h>
 #include <string.h>
+#include <sys/socket.h>
 
-static size_t read_message_id(const Bytes *bytes, uint16_t *output);
-static size_t read_result(const Bytes *bytes, uint8_t *output);
+/// Scan for the first byte outside of the character class of a field
+typedef size_t (*Validator)(const uint8_t *data, size_t len);
 
 void udp_connect(Connection *conn) {
     // UDP is connectionless protocol, it does not have to establish a connection to the server
@@ -22,67 +28,153 @@ void udp_connect(Connection *conn) {
     log("Connected");
 }
 
-void udp_send(Connection *conn, Payload payload) {
-    logfmt("Sending payload type %u", payload.type);
-    Bytes bytes = udp_serialize(&payload);
+void udp_send(Connection *conn, const PayloadView *payload) {
+    logfmt("Sending payload type %u", payload->type);
 
-    #ifdef DEBUG_F
-    const uint8_t *bytes_slice = bytes_get(&bytes);
-    for (size_t i = 0; i < bytes.len; i++) {
-        fprintf(stderr, "0x%02x ", bytes_slice[i]);
+    uint8_t header[UDP_HEADER_MAX];
+    struct iovec iov[PAYLOAD_IOV_MAX];
+    size_t count = udp_serialize_view_iov(payload, header, iov);
+    size_t len = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        len += iov[i].iov_len;
+
+        #ifdef DEBUG_F
+        for (size_t j = 0; j < iov[i].iov_len; j++) {
+            fprintf(stderr, "0x%02x ", ((const uint8_t *)iov[i].iov_base)[j]);
+        }
+        #endif
     }
+
+    #ifdef DEBUG_F
     fprintf(stderr, "\n");
     #endif
 
-
-    struct sockaddr *address = conn->address_info->ai_addr;
-    socklen_t address_len = conn->address_info->ai_addrlen;
+    struct msghdr msg = {0};
+    msg.msg_name = conn->address_info->ai_addr;
+    msg.msg_namelen = conn->address_info->ai_addrlen;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
     int flags = 0;
 
-    ssize_t bytes_tx = sendto(conn->sockfd, bytes.data, bytes.len, flags, address, address_len);
+    ssize_t bytes_tx = sendmsg(conn->sockfd, &msg, flags);
 
-    if (bytes_tx != (ssize_t)bytes.len) {
+    if (bytes_tx != (ssize_t)len) {
         set_error(Error_Connection);
         perror("ERR: Cannot send packet to the server");
     }
 }
 
-Payload udp_receive(Connection *conn) {
-    log("Received payload");
+PayloadView udp_receive(Connection *conn) {
+    PayloadView payload = {0};
+    Error error = Error_None;
 
-    Payload payload = {0};
-    Bytes buffer = bytes_new();
+    size_t count = udp_receive_batch(conn, &payload, &error, 1);
 
-    struct sockaddr_in address;
-    socklen_t address_len = sizeof(address);
+    if (!get_error()) {
+        set_error(count ? error : Error_NoPayload);
+    }
 
-    int flags = 0;
-    ssize_t bytes_rx = recvfrom(conn->sockfd, buffer.data, BYTES_SIZE, flags, (struct sockaddr *)&address, &address_len);
+    return payload;
+}
+
+size_t udp_receive_batch(Connection *conn, PayloadView *payloads, Error *errors, size_t max) {
+    log("Receiving payloads");
+
+    if (max > UDP_BATCH_MAX) max = UDP_BATCH_MAX;
+
+    struct iovec iov[UDP_BATCH_MAX];
+    struct sockaddr_in addresses[UDP_BATCH_MAX];
+    struct mmsghdr msgs[UDP_BATCH_MAX];
+    memset(msgs, 0, max * sizeof(struct mmsghdr));
+
+    for (size_t i = 0; i < max; i++) {
+        iov[i].iov_base = conn->datagrams[i];
+        iov[i].iov_len = BYTES_SIZE;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addresses[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+
+    int count = recvmmsg(conn->sockfd, msgs, max, 0, NULL);
+
+    if (count < 0) {
+        // The socket is non-blocking, a wakeup may be spurious
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
 
-    if (bytes_rx < 0) {
         set_error(Error_Connection);
         perror("ERR: Cannot receive packet from server");
-        return payload;
+        return 0;
     }
 
     // Address of the server
     struct sockaddr_in *server_address = (struct sockaddr_in *)conn->address_info->ai_addr;
 
-    // Check if the incoming packet is from the same address
-    if (memcmp(&address.sin_addr, &server_address->sin_addr, sizeof(address.sin_addr)) != 0) {
-        set_error(Error_RecvFromWrongAddress);
-        return payload;
+    for (int i = 0; i < count; i++) {
+        memset(&payloads[i], 0, sizeof(PayloadView));
+
+        // Check if the incoming packet is from the same address
+        if (memcmp(&addresses[i].sin_addr, &server_address->sin_addr, sizeof(addresses[i].sin_addr)) != 0) {
+            errors[i] = Error_RecvFromWrongAddress;
+            continue;
+        }
+
+        // Change port based on the sender port
+        logfmt("Port %u", ntohs(addresses[i].sin_port));
+        server_address->sin_port = addresses[i].sin_port;
+
+        // The payload references the datagram, which stays until the next receive
+        udp_deserialize_view(conn->datagrams[i], msgs[i].msg_len, &payloads[i]);
+        errors[i] = get_error();
+        error_clear();
+
+        logfmt("Received payload with ID %u", payloads[i].id);
     }
 
-    // Change port based on the sender port
-    logfmt("Port %u", ntohs(address.sin_port));
-    server_address->sin_port = address.sin_port;
+    return count;
+}
 
-    buffer.len = bytes_rx;
-    payload = udp_deserialize(buffer);
-    
-    logfmt("Received payload with ID %u", payload.id);
-    return payload;
+void udp_confirm_batch(Connection *conn, const MessageID *ids, size_t len) {
+    if (!len) return;
+    logfmt("Sending %zu confirms", len);
+
+    uint8_t headers[UDP_BATCH_MAX][3];
+    struct iovec iov[UDP_BATCH_MAX];
+    struct mmsghdr msgs[UDP_BATCH_MAX];
+    memset(msgs, 0, len * sizeof(struct mmsghdr));
+
+    for (size_t i = 0; i < len; i++) {
+        headers[i][0] = PayloadType_Confirm;
+        headers[i][1] = ids[i] >> 8;
+        headers[i][2] = ids[i] & 0xFF;
+
+        iov[i].iov_base = headers[i];
+        iov[i].iov_len = 3;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = conn->address_info->ai_addr;
+        msgs[i].msg_hdr.msg_namelen = conn->address_info->ai_addrlen;
+    }
+
+    size_t sent = 0;
+
+    while (sent < len) {
+        int count = sendmmsg(conn->sockfd, msgs + sent, len - sent, 0);
+
+        if (count <= 0) {
+            set_error(Error_Connection);
+            perror("ERR: Cannot send packet to the server");
+            return;
+        }
+
+        sent += count;
+    }
+}
+
+bool udp_pending(Connection *conn) {
+    (void)conn;
+    return false;
 }
 
 void udp_disconnect(Connection *conn) {
@@ -91,161 +183,177 @@ void udp_disconnect(Connection *conn) {
     (void)conn;
 }
 
-Bytes udp_serialize(const Payload *payload) {
-    Bytes buffer = bytes_new();
-    uint8_t header[3];
+/// Fields referenced by a view of a received payload are not terminated, the terminator is a piece of its own
+static size_t udp_serialize_slices(const PayloadView *view, uint8_t header[UDP_HEADER_MAX], struct iovec iov[PAYLOAD_IOV_MAX], bool terminated) {
+    static const uint8_t terminator = 0;
+    size_t header_len = 3;
 
-    header[0] = payload->type;
-    header[1] = payload->id >> 8;
-    header[2] = payload->id & 0xFF;
+    header[0] = view->type;
+    header[1] = view->id >> 8;
+    header[2] = view->id & 0xFF;
+
+    if (view->type == PayloadType_Reply) {
+        header[3] = view->result;
+        header[4] = view->ref_message_id >> 8;
+        header[5] = view->ref_message_id & 0xFF;
+        header_len = 6;
+    }
 
-    bytes_push_arr(&buffer, header, 3);
-    if (get_error()) return buffer;
+    iov[0].iov_base = header;
+    iov[0].iov_len = header_len;
+    size_t count = 1;
 
-    #define PUSH_BYTES(bytes) \
-        logfmt("Pushing %s", bytes); \
-        bytes_push_c_str(&buffer, (void *)bytes); \
-        bytes_push(&buffer, 0); \
-        if (get_error()) return buffer
+    // The null terminator of the field is sent too
+    #define PUSH_SLICE(slice) \
+        iov[count].iov_base = (void *)slice.data; \
+        iov[count++].iov_len = slice.len + terminated; \
+        if (!terminated) { \
+            iov[count].iov_base = (void *)&terminator; \
+            iov[count++].iov_len = 1; \
+        }
 
-    switch (payload->type) {
+    switch (view->type) {
         case PayloadType_Bye:
         case PayloadType_Confirm:
             break;
 
         case PayloadType_Reply:
-            bytes_push(&buffer, payload->data.reply.result);
-            bytes_push(&buffer, payload->data.reply.ref_message_id >> 8);
-            bytes_push(&buffer, payload->data.reply.ref_message_id & 0xFF);
-            PUSH_BYTES(payload->data.reply.message_content);
+            PUSH_SLICE(view->message_content);
             break;
 
         case PayloadType_Auth:
-            PUSH_BYTES(payload->data.auth.username);
-            PUSH_BYTES(payload->data.auth.display_name);
-            PUSH_BYTES(payload->data.auth.secret);
+            PUSH_SLICE(view->username);
+            PUSH_SLICE(view->display_name);
+            PUSH_SLICE(view->secret);
             break;
 
         case PayloadType_Join:
-            PUSH_BYTES(payload->data.join.channel_id);
-            PUSH_BYTES(payload->data.join.display_name);
+            PUSH_SLICE(view->channel_id);
+            PUSH_SLICE(view->display_name);
             break;
 
         case PayloadType_Message:
-            PUSH_BYTES(payload->data.message.display_name);
-            PUSH_BYTES(payload->data.message.message_content);
-            break;
-
         case PayloadType_Err:
-            PUSH_BYTES(payload->data.err.display_name);
-            PUSH_BYTES(payload->data.err.message_content);
+            PUSH_SLICE(view->display_name);
+            PUSH_SLICE(view->message_content);
             break;
     }
 
+    return count;
+}
+
+size_t udp_serialize_iov(const Payload *payload, uint8_t header[UDP_HEADER_MAX], struct iovec iov[PAYLOAD_IOV_MAX]) {
+    PayloadView view = payload_view(payload);
+    return udp_serialize_slices(&view, header, iov, true);
+}
+
+size_t udp_serialize_view_iov(const PayloadView *view, uint8_t header[UDP_HEADER_MAX], struct iovec iov[PAYLOAD_IOV_MAX]) {
+    return udp_serialize_slices(view, header, iov, false);
+}
+
+Bytes udp_serialize(const Payload *payload) {
+    Bytes buffer = bytes_new();
+    uint8_t header[UDP_HEADER_MAX];
+    struct iovec iov[PAYLOAD_IOV_MAX];
+    size_t count = udp_serialize_iov(payload, header, iov);
+
+    for (size_t i = 0; i < count && !get_error(); i++) {
+        bytes_push_arr(&buffer, iov[i].iov_base, iov[i].iov_len);
+    }
+
     return buffer;
 }
 
 Payload udp_deserialize(Bytes buffer) {
-    Payload payload = {0};
-
-    if (buffer.len < 3) {
-        set_error(Error_InvalidPayload);
+    PayloadView view;
+    udp_deserialize_view(bytes_get(&buffer), buffer.len, &view);
+
+    if (get_error()) {
+        // The header is still needed to confirm the malformed payload
+        Payload payload = {0};
+        payload.type = view.type;
+        payload.id = view.id;
         return payload;
     }
 
-    size_t read = 0;
-    uint8_t type = bytes_get(&buffer)[0];
+    Payload payload;
+    payload_from_view(&payload, &view);
+    return payload;
+}
+
+/// Take a null-terminated field, it has to be valid and not empty
+static bool udp_read_field(const uint8_t **data, size_t *len, PayloadSlice *field, size_t limit, Validator validator) {
+    size_t count = validator(*data, *len);
+
+    if (count == 0 || count > limit || count >= *len || (*data)[count] != 0) {
+        return false;
+    }
 
-    payload.type = type;
-    bytes_skip_first_n(&buffer, 1);
+    field->data = *data;
+    field->len = count;
+    *data += count + 1;
+    *len -= count + 1;
+    return true;
+}
 
-    read_message_id(&buffer, &payload.id);
-    bytes_skip_first_n(&buffer, 2);
+void udp_deserialize_view(const uint8_t *data, size_t len, PayloadView *view) {
+    memset(view, 0, sizeof(PayloadView));
 
-    if (type != PayloadType_Confirm
-        && type != PayloadType_Reply
-        && type != PayloadType_Auth
-        && type != PayloadType_Join
-        && type != PayloadType_Message
-        && type != PayloadType_Err
-        && type != PayloadType_Bye
-    ) {
+    if (len < 3) {
         set_error(Error_InvalidPayload);
-        return payload;
+        return;
     }
 
-    #define READ_FUNC(func, output) \
-        read = read_##func(&buffer, (void *)output); \
-        if (read <= 0) { \
-            set_error(Error_InvalidPayload); \
-            return payload; \
-        } \
-        bytes_skip_first_n(&buffer, read)
+    uint8_t type = data[0];
+    view->type = type;
+    view->id = (data[1] << 8) | data[2];
+    data += 3;
+    len -= 3;
 
-    #define READ(select, buf) \
-        read = read_##buf(payload.data.select.buf, &buffer); \
-        if (read <= 0 || bytes_get(&buffer)[read] != 0) { \
+    #define READ_FIELD(field, limit, validator) \
+        if (!udp_read_field(&data, &len, &view->field, limit, validator)) { \
             set_error(Error_InvalidPayload); \
-            return payload; \
-        } \
-        bytes_skip_first_n(&buffer, read + 1);
+            return; \
+        }
 
     switch (type) {
         case PayloadType_Reply:
-            READ_FUNC(result, &payload.data.reply.result);
-            READ_FUNC(message_id, &payload.data.reply.ref_message_id);
-            READ(reply, message_content);
+            // Result has to be 0 or 1
+            if (len < 3 || data[0] > 1) {
+                set_error(Error_InvalidPayload);
+                return;
+            }
+
+            view->result = data[0];
+            view->ref_message_id = (data[1] << 8) | data[2];
+            data += 3;
+            len -= 3;
+
+            READ_FIELD(message_content, MESSAGE_CONTENT_LEN, scan_message_content);
             break;
         case PayloadType_Auth:
-            READ(auth, username);
-            READ(auth, display_name);
-            READ(auth, secret);
+            READ_FIELD(username, USERNAME_LEN, scan_id);
+            READ_FIELD(display_name, DISPLAY_NAME_LEN, scan_display_name);
+            READ_FIELD(secret, SECRET_LEN, scan_id);
             break;
         case PayloadType_Join:
-            READ(join, channel_id);
-            READ(join, display_name);
+            READ_FIELD(channel_id, CHANNEL_ID_LEN, scan_id);
+            READ_FIELD(display_name, DISPLAY_NAME_LEN, scan_display_name);
             break;
         case PayloadType_Message:
-            READ(message, display_name);
-            READ(message, message_content);
-            break;
-        case PayloadType_Err: 
-            READ(err, display_name);
-            READ(err, message_content);
+        case PayloadType_Err:
+            READ_FIELD(display_name, DISPLAY_NAME_LEN, scan_display_name);
+            READ_FIELD(message_content, MESSAGE_CONTENT_LEN, scan_message_content);
             break;
         case PayloadType_Confirm:
         case PayloadType_Bye:
             break;
+        default:
+            set_error(Error_InvalidPayload);
+            return;
     }
 
-    if (buffer.len != 0) {
-        set_error(Error_InvalidPayload);
-    }
-
-    return payload;
-}
-
-static size_t read_message_id(const Bytes *bytes, uint16_t *output) {
-    if (bytes->len < 2) return -1;
-    const uint8_t *slice = bytes_get(bytes);
-    *output = (slice[0] << 8) | slice[1];
-    return 2;
-}
-
-static size_t read_result(const Bytes *bytes, uint8_t *output) {
-    if (!bytes->len) {
-        set_error(Error_InvalidPayload);
-        return 0;
-    }
-
-    uint8_t res = bytes_get(bytes)[0];
-
-    if (res != 0 && res != 1) {
+    if (len != 0) {
         set_error(Error_InvalidPayload);
-        return 0;
     }
-
-    logfmt("Reading result. Got %d", res);
-    *output = res;
-    return 1;
 }
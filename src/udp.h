@@ -9,6 +9,8 @@
 #define UDP_H
 
 #include "connection.h"
+#include "error.h"
+#include <sys/uio.h>
 
 /**
  * @brief Establish a UDP connection.
@@ -19,16 +21,50 @@ void udp_connect(Connection *connection);
 /**
  * @brief Send a payload over a UDP connection.
  * @param connection Pointer to the Connection object representing the UDP connection.
- * @param payload The payload to send.
+ * @param payload Pointer to the payload to send, its fields are written from where they are.
  */
-void udp_send(Connection *connection, Payload payload);
+void udp_send(Connection *connection, const PayloadView *payload);
 
 /**
  * @brief Receive a payload over a UDP connection.
  * @param connection Pointer to the Connection object representing the UDP connection.
- * @return The received payload.
+ * @return The received payload, referencing the datagrams of the connection until the next receive.
  */
-Payload udp_receive(Connection *connection);
+PayloadView udp_receive(Connection *connection);
+
+/// Maximum number of datagrams received or confirmed by a single system call
+#define UDP_BATCH_MAX CONNECTION_DATAGRAMS
+
+/**
+ * @brief Receive the datagrams waiting on the socket by a single system call.
+ *
+ * Every datagram from the server address updates the port of the server, as in udp_receive.
+ * The datagrams are received into the connection, the payloads reference them until the next receive.
+ *
+ * @param connection Pointer to the Connection object representing the UDP connection.
+ * @param payloads Output, the received payloads.
+ * @param errors Output, Error_None, Error_RecvFromWrongAddress or Error_InvalidPayload for each payload.
+ * @param max Capacity of the outputs, at most UDP_BATCH_MAX are received.
+ * @return Number of the received payloads, 0 if no datagram is waiting.
+ * @note This may set Error_Connection.
+ */
+size_t udp_receive_batch(Connection *connection, PayloadView *payloads, Error *errors, size_t max);
+
+/**
+ * @brief Send a CONFIRM for each of the MessageIDs by a single system call.
+ * @param connection Pointer to the Connection object representing the UDP connection.
+ * @param ids The confirmed MessageIDs.
+ * @param len Number of the MessageIDs, at most UDP_BATCH_MAX.
+ * @note This may set Error_Connection.
+ */
+void udp_confirm_batch(Connection *connection, const MessageID *ids, size_t len);
+
+/**
+ * @brief Check whether a received payload is waiting, every datagram is a single payload.
+ * @param connection Pointer to the Connection object representing the UDP connection.
+ * @return Always false.
+ */
+bool udp_pending(Connection *connection);
 
 /**
  * @brief Disconnect from a UDP connection.
@@ -36,6 +72,30 @@ Payload udp_receive(Connection *connection);
  */
 void udp_disconnect(Connection *connection);
 
+/// Length of the part of a datagram preceding the first string, the longest is the one of REPLY
+#define UDP_HEADER_MAX 6
+
+/**
+ * @brief Serialize a payload into its header and pieces referencing the null-terminated fields of the payload.
+ * @param payload Pointer to the payload, it has to outlive the pieces.
+ * @param header Output, storage of the header, the first piece references it.
+ * @param iov Output, the pieces in the order of the datagram.
+ * @return Number of the pieces.
+ */
+size_t udp_serialize_iov(const Payload *payload, uint8_t header[UDP_HEADER_MAX], struct iovec iov[PAYLOAD_IOV_MAX]);
+
+/**
+ * @brief Serialize a payload into its header and pieces referencing the fields referenced by the view.
+ *
+ * The fields of a view are not null-terminated, every terminator is a piece of its own.
+ *
+ * @param view Pointer to the view, its fields have to outlive the pieces.
+ * @param header Output, storage of the header, the first piece references it.
+ * @param iov Output, the pieces in the order of the datagram.
+ * @return Number of the pieces.
+ */
+size_t udp_serialize_view_iov(const PayloadView *view, uint8_t header[UDP_HEADER_MAX], struct iovec iov[PAYLOAD_IOV_MAX]);
+
 /// Serialize payload into bytes to be sent to the server
 /// Exported for testing purpose
 Bytes udp_serialize(const Payload *payload);
@@ -44,4 +104,13 @@ Bytes udp_serialize(const Payload *payload);
 /// Exported for testing purpose
 Payload udp_deserialize(Bytes buffer);
 
+/**
+ * @brief Parse and validate a datagram where it has been received.
+ * @param data The datagram.
+ * @param len Length of the datagram.
+ * @param view Output, the payload referencing its fields in the data. The type and ID are set even if the datagram is malformed.
+ * @note This sets Error_InvalidPayload if the datagram is malformed.
+ */
+void udp_deserialize_view(const uint8_t *data, size_t len, PayloadView *view);
+
 #endif
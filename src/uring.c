@@ -0,0 +1,226 @@
+/**
+ * @file uring.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of uring.h
+ */
+
+#include "uring.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t arg_size) {
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+bool uring_init(Uring *ring, unsigned entries) {
+    memset(ring, 0, sizeof(Uring));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+
+    ring->fd = io_uring_setup(entries, &params);
+    if (ring->fd < 0) return false;
+
+    // Both are needed, the kernels without them lack the multishot requests anyway
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        close(ring->fd);
+        ring->fd = -1;
+        return false;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->rings_size = sq_size > cq_size ? sq_size : cq_size;
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->rings = mmap(NULL, ring->rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+    if (ring->rings == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->rings != MAP_FAILED) munmap(ring->rings, ring->rings_size);
+        if (ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+        close(ring->fd);
+        ring->fd = -1;
+        return false;
+    }
+
+    uint8_t *rings = ring->rings;
+    ring->sq_head = (unsigned *)(rings + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(rings + params.sq_off.tail);
+    ring->sq_mask = *(unsigned *)(rings + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    ring->sq_array = (unsigned *)(rings + params.sq_off.array);
+    ring->cq_head = (unsigned *)(rings + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(rings + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(rings + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(rings + params.cq_off.cqes);
+
+    // Entry i always goes to slot i, so the array never changes
+    for (unsigned i = 0; i < ring->sq_entries; i++) {
+        ring->sq_array[i] = i;
+    }
+
+    return true;
+}
+
+void uring_free(Uring *ring) {
+    if (ring->fd < 0) return;
+
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->rings, ring->rings_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+/// Entries published in the queue that the kernel has not consumed yet
+static unsigned uring_sq_ready(const Uring *ring) {
+    return *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+struct io_uring_sqe *uring_sqe(Uring *ring) {
+    unsigned tail = *ring->sq_tail;
+
+    // The slot at the tail is still the oldest entry not consumed by the kernel
+    if (uring_sq_ready(ring) == ring->sq_entries) {
+        if (uring_submit(ring, 0) < 0 || uring_sq_ready(ring) == ring->sq_entries) return NULL;
+    }
+
+    struct io_uring_sqe *sqe = &ring->sqes[tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+
+    // The kernel does not look at the entry before it is submitted
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return sqe;
+}
+
+int uring_submit(Uring *ring, int timeout) {
+    unsigned flags = 0;
+    unsigned wait = 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+
+    if (timeout != 0) {
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        wait = 1;
+
+        if (timeout > 0) {
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000L;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+    }
+
+    int ret;
+
+    // The kernel moves the head past the consumed entries, the rest is submitted by the next call
+    do {
+        ret = io_uring_enter(ring->fd, uring_sq_ready(ring), wait, flags, flags ? &arg : NULL, flags ? sizeof(arg) : 0);
+    } while (ret < 0 && errno == EINTR && !wait);
+
+    // Interrupted or timed out while waiting
+    if (ret >= 0 || errno == ETIME || errno == EINTR) return 0;
+
+    // The completion queue overflows, the kernel takes new entries once the completions are reaped
+    if (errno == EBUSY || errno == EAGAIN) return 0;
+
+    return -errno;
+}
+
+struct io_uring_cqe *uring_cqe(Uring *ring) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) return NULL;
+
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+void uring_cqe_seen(Uring *ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+bool uring_buffers_init(Uring *ring, UringBuffers *buffers, uint16_t group, unsigned entries, unsigned buffer_size) {
+    memset(buffers, 0, sizeof(UringBuffers));
+
+    size_t ring_size = entries * sizeof(struct io_uring_buf);
+    void *ring_mem = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring_mem == MAP_FAILED) return false;
+
+    void *data = mmap(NULL, (size_t)entries * buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (data == MAP_FAILED) {
+        munmap(ring_mem, ring_size);
+        return false;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring_mem;
+    reg.ring_entries = entries;
+    reg.bgid = group;
+
+    if (io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(data, (size_t)entries * buffer_size);
+        munmap(ring_mem, ring_size);
+        return false;
+    }
+
+    buffers->ring = ring_mem;
+    buffers->data = data;
+    buffers->entries = entries;
+    buffers->buffer_size = buffer_size;
+    buffers->group = group;
+
+    for (unsigned i = 0; i < entries; i++) {
+        uring_buffers_recycle(buffers, i);
+    }
+
+    return true;
+}
+
+void uring_buffers_free(Uring *ring, UringBuffers *buffers) {
+    if (!buffers->ring) return;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = buffers->group;
+
+    if (ring->fd >= 0) {
+        io_uring_register(ring->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+
+    munmap(buffers->data, (size_t)buffers->entries * buffers->buffer_size);
+    munmap(buffers->ring, buffers->entries * sizeof(struct io_uring_buf));
+    memset(buffers, 0, sizeof(UringBuffers));
+}
+
+uint8_t *uring_buffer(const UringBuffers *buffers, uint16_t id) {
+    return buffers->data + (size_t)id * buffers->buffer_size;
+}
+
+void uring_buffers_recycle(UringBuffers *buffers, uint16_t id) {
+    // The tail shares the memory with the first buffer entry, only the kernel moves the head
+    uint16_t tail = buffers->ring->tail;
+    struct io_uring_buf *buf = &buffers->ring->bufs[tail & (buffers->entries - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)uring_buffer(buffers, id);
+    buf->len = buffers->buffer_size;
+    buf->bid = id;
+
+    __atomic_store_n(&buffers->ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
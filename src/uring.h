@@ -0,0 +1,129 @@
+/**
+ * @file uring.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides a minimal io_uring interface using the raw system calls.
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Submission and completion queues shared with the kernel.
+ */
+typedef struct {
+    int fd; /**< File descriptor of the ring, -1 if it is not set up. */
+
+    unsigned *sq_head; /**< Head of the submission queue, moved by the kernel. */
+    unsigned *sq_tail; /**< Tail of the submission queue, moved by us. */
+    unsigned sq_mask; /**< Mask of the submission queue indexes. */
+    unsigned sq_entries; /**< Number of entries of the submission queue. */
+    unsigned *sq_array; /**< Indexes of the submitted entries. */
+    struct io_uring_sqe *sqes; /**< Submission queue entries, the ones between the head and the tail are not submitted yet. */
+
+    unsigned *cq_head; /**< Head of the completion queue, moved by us. */
+    unsigned *cq_tail; /**< Tail of the completion queue, moved by the kernel. */
+    unsigned cq_mask; /**< Mask of the completion queue indexes. */
+    struct io_uring_cqe *cqes; /**< Completion queue entries. */
+
+    void *rings; /**< Mapped submission and completion queue rings. */
+    size_t rings_size; /**< Size of the mapped rings. */
+    size_t sqes_size; /**< Size of the mapped submission queue entries. */
+} Uring;
+
+/**
+ * @brief Ring of buffers provided to the kernel, the kernel picks one for each received data.
+ */
+typedef struct {
+    struct io_uring_buf_ring *ring; /**< The ring shared with the kernel. */
+    uint8_t *data; /**< Memory of all buffers. */
+    unsigned entries; /**< Number of buffers, a power of 2. */
+    unsigned buffer_size; /**< Size of a buffer. */
+    uint16_t group; /**< ID of the buffer group. */
+} UringBuffers;
+
+/**
+ * @brief Set up a ring.
+ * @param ring Pointer to the ring.
+ * @param entries Number of entries of the submission queue.
+ * @return false if the kernel does not support io_uring, or it is not allowed.
+ */
+bool uring_init(Uring *ring, unsigned entries);
+
+/**
+ * @brief Destroy the ring, the kernel cancels the requests in flight.
+ * @param ring Pointer to the ring.
+ */
+void uring_free(Uring *ring);
+
+/**
+ * @brief Get a zeroed submission queue entry, submitting the queue first if it is full.
+ *
+ * An entry is reused only after the kernel has consumed it, the kernel may refuse to consume any entry
+ * while its completion queue overflows, until the completions are reaped.
+ *
+ * @param ring Pointer to the ring.
+ * @return Pointer to the entry, it is submitted with the next uring_submit, NULL if the queue stays full.
+ */
+struct io_uring_sqe *uring_sqe(Uring *ring);
+
+/**
+ * @brief Submit the prepared entries and wait for a completion.
+ * @param ring Pointer to the ring.
+ * @param timeout Time to wait in milliseconds, -1 to wait indefinitely, 0 to not wait at all.
+ * @return 0 on success or timeout, negative errno otherwise.
+ */
+int uring_submit(Uring *ring, int timeout);
+
+/**
+ * @brief Get the next completion queue entry.
+ * @param ring Pointer to the ring.
+ * @return Pointer to the entry, NULL if there is not any, see uring_cqe_seen.
+ */
+struct io_uring_cqe *uring_cqe(Uring *ring);
+
+/**
+ * @brief Give the completion queue entry back to the kernel.
+ * @param ring Pointer to the ring.
+ */
+void uring_cqe_seen(Uring *ring);
+
+/**
+ * @brief Allocate buffers and register them as a ring of provided buffers.
+ * @param ring Pointer to the ring.
+ * @param buffers Pointer to the buffers.
+ * @param group ID of the buffer group, used as buf_group of the requests.
+ * @param entries Number of buffers, a power of 2.
+ * @param buffer_size Size of a buffer.
+ * @return false if the kernel does not support rings of provided buffers, or on failure.
+ */
+bool uring_buffers_init(Uring *ring, UringBuffers *buffers, uint16_t group, unsigned entries, unsigned buffer_size);
+
+/**
+ * @brief Unregister and free the buffers.
+ * @param ring Pointer to the ring.
+ * @param buffers Pointer to the buffers.
+ */
+void uring_buffers_free(Uring *ring, UringBuffers *buffers);
+
+/**
+ * @brief Get a buffer picked by the kernel.
+ * @param buffers Pointer to the buffers.
+ * @param id ID of the buffer, from the flags of the completion queue entry.
+ * @return Pointer to the buffer.
+ */
+uint8_t *uring_buffer(const UringBuffers *buffers, uint16_t id);
+
+/**
+ * @brief Give a buffer back to the kernel once its data have been consumed.
+ * @param buffers Pointer to the buffers.
+ * @param id ID of the buffer.
+ */
+void uring_buffers_recycle(UringBuffers *buffers, uint16_t id);
+
+#endif
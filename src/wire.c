@@ -0,0 +1,81 @@
+/**
+ * @file wire.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Implementation of wire.h
+ */
+
+#include "wire.h"
+#include "error.h"
+#include "tcp.h"
+#include "udp.h"
+#include <stdlib.h>
+#include <string.h>
+
+/// Wire with uninitialized data of the given length
+static Wire *wire_alloc(size_t len, Mode mode) {
+    Wire *wire = malloc(sizeof(Wire) + len);
+
+    if (!wire) {
+        set_error(Error_OutOfMemory);
+        return NULL;
+    }
+
+    atomic_init(&wire->refcount, 1);
+    wire->mode = mode;
+    wire->len = len;
+
+    return wire;
+}
+
+Wire *wire_new(const Payload *payload, Mode mode) {
+    PayloadView view = payload_view(payload);
+    return wire_new_view(&view, mode);
+}
+
+Wire *wire_new_view(const PayloadView *view, Mode mode) {
+    uint8_t header[UDP_HEADER_MAX];
+    struct iovec iov[PAYLOAD_IOV_MAX];
+    size_t count = mode == Mode_TCP ? tcp_serialize_view_iov(view, iov) : udp_serialize_view_iov(view, header, iov);
+    if (get_error()) return NULL;
+
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) len += iov[i].iov_len;
+
+    // The pieces are gathered right into the shared buffer
+    Wire *wire = wire_alloc(len, mode);
+    if (!wire) return NULL;
+
+    uint8_t *data = wire->data;
+
+    for (size_t i = 0; i < count; i++) {
+        memcpy(data, iov[i].iov_base, iov[i].iov_len);
+        data += iov[i].iov_len;
+    }
+
+    return wire;
+}
+
+Wire *wire_copy(const uint8_t *data, size_t len, Mode mode) {
+    Wire *wire = wire_alloc(len, mode);
+    if (wire) memcpy(wire->data, data, len);
+
+    return wire;
+}
+
+Wire *wire_ref(Wire *wire) {
+    atomic_fetch_add_explicit(&wire->refcount, 1, memory_order_relaxed);
+    return wire;
+}
+
+void wire_unref(Wire *wire) {
+    if (wire && atomic_fetch_sub_explicit(&wire->refcount, 1, memory_order_acq_rel) == 1) {
+        free(wire);
+    }
+}
+
+void wire_udp_header(const Wire *wire, MessageID id, uint8_t header[WIRE_UDP_HEADER_LEN]) {
+    header[0] = wire->data[0];
+    header[1] = id >> 8;
+    header[2] = id & 0xFF;
+}
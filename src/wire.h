@@ -0,0 +1,83 @@
+/**
+ * @file wire.h
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief This module provides immutable, reference counted serialized payloads shared by many recipients.
+ */
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include "args.h"
+#include "payload.h"
+#include <stdatomic.h>
+
+/// Size of the UDP header (type and MessageID)
+#define WIRE_UDP_HEADER_LEN 3
+
+/**
+ * @brief Payload serialized for a transport, built once and sent to every recipient.
+ *
+ * The buffer is never modified after it has been built. In UDP, the MessageID in the header
+ * differs for each recipient, so it has to be replaced while sending, see wire_udp_header.
+ */
+typedef struct {
+    atomic_int refcount; /**< Number of owners of the buffer. */
+    Mode mode; /**< Transport the payload is serialized for. */
+    size_t len; /**< Length of the serialized payload. */
+    uint8_t data[]; /**< Serialized payload. */
+} Wire;
+
+/**
+ * @brief Serialize a payload into a new wire buffer, the caller owns the only reference.
+ * @param payload The payload to serialize.
+ * @param mode Transport to serialize the payload for.
+ * @return Pointer to the wire buffer, NULL on failure.
+ * @note This may set Error_OutOfMemory or the errors of the serializer.
+ */
+Wire *wire_new(const Payload *payload, Mode mode);
+
+/**
+ * @brief Serialize the fields referenced by a view into a new wire buffer, the caller owns the only reference.
+ *
+ * A received payload is relayed this way without being copied into a Payload first.
+ *
+ * @param view The payload to serialize.
+ * @param mode Transport to serialize the payload for.
+ * @return Pointer to the wire buffer, NULL on failure.
+ * @note This may set Error_OutOfMemory or the errors of the serializer.
+ */
+Wire *wire_new_view(const PayloadView *view, Mode mode);
+
+/**
+ * @brief Create a new wire buffer from an already serialized payload, the caller owns the only reference.
+ * @param data The serialized payload.
+ * @param len Length of the serialized payload.
+ * @param mode Transport the payload is serialized for.
+ * @return Pointer to the wire buffer, NULL on failure.
+ * @note This may set Error_OutOfMemory.
+ */
+Wire *wire_copy(const uint8_t *data, size_t len, Mode mode);
+
+/**
+ * @brief Take another reference to the wire buffer.
+ * @param wire Pointer to the wire buffer.
+ * @return The same wire buffer.
+ */
+Wire *wire_ref(Wire *wire);
+
+/**
+ * @brief Drop a reference to the wire buffer, the buffer is freed with its last reference.
+ * @param wire Pointer to the wire buffer, may be NULL.
+ */
+void wire_unref(Wire *wire);
+
+/**
+ * @brief Build the UDP header of the wire buffer with the MessageID of a recipient.
+ * @param wire Pointer to the UDP wire buffer.
+ * @param id MessageID for the recipient.
+ * @param header Output, the header to be sent instead of the first WIRE_UDP_HEADER_LEN bytes of the buffer.
+ */
+void wire_udp_header(const Wire *wire, MessageID id, uint8_t header[WIRE_UDP_HEADER_LEN]);
+
+#endif
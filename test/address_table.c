@@ -0,0 +1,111 @@
+#include "greatest.h"
+#include "../src/address_table.h"
+#include "../src/error.h"
+#include <arpa/inet.h>
+#include <string.h>
+
+AddressTable ADDRESSES;
+
+static void address_table_setup(void *arg) {
+    ADDRESSES = address_table_new();
+    set_error(Error_None);
+    (void)arg;
+}
+
+static void address_table_tear_down(void *arg) {
+    address_table_free(&ADDRESSES);
+    (void)arg;
+}
+
+static struct sockaddr_in address_of(const char *ip, uint16_t port) {
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, ip, &address.sin_addr);
+    return address;
+}
+
+SUITE(address_table);
+
+TEST address_table_insert_get(void) {
+    int first = 0, second = 0;
+    struct sockaddr_in a = address_of("127.0.0.1", 4567);
+    struct sockaddr_in b = address_of("127.0.0.1", 4568);
+    struct sockaddr_in c = address_of("127.0.0.2", 4567);
+
+    ASSERT_EQ(address_table_get(&ADDRESSES, &a), NULL);
+
+    address_table_insert(&ADDRESSES, &a, &first);
+    address_table_insert(&ADDRESSES, &b, &second);
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(ADDRESSES.len, 2);
+    ASSERT_EQ(address_table_get(&ADDRESSES, &a), &first);
+    ASSERT_EQ(address_table_get(&ADDRESSES, &b), &second);
+    ASSERT_EQ(address_table_get(&ADDRESSES, &c), NULL);
+
+    // Replacing does not add another entry
+    address_table_insert(&ADDRESSES, &a, &second);
+    ASSERT_EQ(ADDRESSES.len, 2);
+    ASSERT_EQ(address_table_get(&ADDRESSES, &a), &second);
+
+    PASS();
+}
+
+TEST address_table_remove_missing(void) {
+    int value = 0;
+    struct sockaddr_in a = address_of("10.0.0.1", 1);
+    struct sockaddr_in b = address_of("10.0.0.1", 2);
+
+    address_table_remove(&ADDRESSES, &a);
+    address_table_insert(&ADDRESSES, &a, &value);
+    address_table_remove(&ADDRESSES, &b);
+
+    ASSERT_EQ(ADDRESSES.len, 1);
+    ASSERT_EQ(address_table_get(&ADDRESSES, &a), &value);
+
+    address_table_remove(&ADDRESSES, &a);
+    ASSERT_EQ(ADDRESSES.len, 0);
+    ASSERT_EQ(address_table_get(&ADDRESSES, &a), NULL);
+
+    PASS();
+}
+
+TEST address_table_many(void) {
+    // Same address with many ports, as with clients behind a NAT
+    static int values[5000];
+    const size_t count = sizeof(values) / sizeof(values[0]);
+
+    for (size_t i = 0; i < count; i++) {
+        struct sockaddr_in address = address_of("192.168.1.1", 1024 + i);
+        address_table_insert(&ADDRESSES, &address, &values[i]);
+        ASSERT_FALSE(get_error());
+    }
+
+    ASSERT_EQ(ADDRESSES.len, count);
+
+    // Remove every other one so the probing sequences have to be shifted back
+    for (size_t i = 0; i < count; i += 2) {
+        struct sockaddr_in address = address_of("192.168.1.1", 1024 + i);
+        address_table_remove(&ADDRESSES, &address);
+    }
+
+    ASSERT_EQ(ADDRESSES.len, count / 2);
+
+    for (size_t i = 0; i < count; i++) {
+        struct sockaddr_in address = address_of("192.168.1.1", 1024 + i);
+        void *expect = i % 2 ? &values[i] : NULL;
+        ASSERT_EQ(address_table_get(&ADDRESSES, &address), expect);
+    }
+
+    PASS();
+}
+
+GREATEST_SUITE(address_table) {
+    GREATEST_SET_SETUP_CB(address_table_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(address_table_tear_down, NULL);
+
+    RUN_TEST(address_table_insert_get);
+    RUN_TEST(address_table_remove_missing);
+    RUN_TEST(address_table_many);
+}
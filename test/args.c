@@ -31,6 +31,11 @@ TEST parse_default(void) {
     ASSERT_EQ(args.port, 4567);
     ASSERT_EQ(args.udp_timeout, 250);
     ASSERT_EQ(args.udp_retransmissions, 3);
+    ASSERT_EQ(args.udp_window, 1);
+    ASSERT_FALSE(args.udp_adaptive_timeout);
+    ASSERT_EQ(args.format, Format_Text);
+    ASSERT_EQ(args.sessions, 1);
+    ASSERT_FALSE(args.mode_mixed);
 
     argv[1] = "-s";
     argv[2] = "test.com";
@@ -104,6 +109,73 @@ TEST parse_complete(void) {
     PASS();
 }
 
+TEST parse_window(void) {
+    int argc = 7;
+    char *argv[7] = { "test", "-t", "udp", "-s", "test.com", "-w", "16" };
+
+    Args args = parse_args(argc, argv);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(args.udp_window, 16);
+
+    argv[6] = "0";
+    parse_args(argc, argv);
+    ASSERT_EQ(get_error(), Error_InvalidArgument);
+
+    PASS();
+}
+
+TEST parse_adaptive_timeout(void) {
+    int argc = 7;
+    char *argv[7] = { "test", "-t", "udp", "-s", "test.com", "-a", "adaptive" };
+
+    Args args = parse_args(argc, argv);
+    ASSERT_FALSE(get_error());
+    ASSERT(args.udp_adaptive_timeout);
+
+    argv[6] = "sometimes";
+    parse_args(argc, argv);
+    ASSERT_EQ(get_error(), Error_InvalidArgument);
+
+    PASS();
+}
+
+TEST parse_format(void) {
+    int argc = 7;
+    char *argv[7] = { "test", "-t", "tcp", "-s", "test.com", "-f", "ndjson" };
+
+    Args args = parse_args(argc, argv);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(args.format, Format_Ndjson);
+
+    argv[6] = "binary";
+    args = parse_args(argc, argv);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(args.format, Format_Binary);
+
+    argv[6] = "json";
+    parse_args(argc, argv);
+    ASSERT_EQ(get_error(), Error_InvalidArgument);
+
+    PASS();
+}
+
+TEST parse_sessions(void) {
+    int argc = 7;
+    char *argv[7] = { "test", "-t", "mixed", "-s", "test.com", "-n", "500" };
+
+    Args args = parse_args(argc, argv);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(args.sessions, 500);
+    ASSERT_EQ(args.mode, Mode_TCP);
+    ASSERT(args.mode_mixed);
+
+    argv[6] = "0";
+    parse_args(argc, argv);
+    ASSERT_EQ(get_error(), Error_InvalidArgument);
+
+    PASS();
+}
+
 TEST parse_repeat_argument(void) {
     int argc = 7;
     char *argv[7] = { "test", "-t", "udp", "-s", "test.com", "-t", "udp" };
@@ -131,6 +203,10 @@ GREATEST_SUITE(args) {
     RUN_TEST(parse_help);
     RUN_TEST(parse_help_with_additional_args);
     RUN_TEST(parse_complete);
+    RUN_TEST(parse_window);
+    RUN_TEST(parse_adaptive_timeout);
+    RUN_TEST(parse_format);
+    RUN_TEST(parse_sessions);
     RUN_TEST(parse_repeat_argument);
     RUN_TEST(parse_incorrect_order);
 }
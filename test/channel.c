@@ -0,0 +1,123 @@
+#include "greatest.h"
+#include "../src/channel.h"
+#include "../src/error.h"
+#include <stdio.h>
+#include <string.h>
+
+ChannelRegistry CHANNELS;
+
+static void channel_setup(void *arg) {
+    CHANNELS = channel_registry_new();
+    set_error(Error_None);
+    (void)arg;
+}
+
+static void channel_tear_down(void *arg) {
+    channel_registry_free(&CHANNELS);
+    (void)arg;
+}
+
+SUITE(channel);
+
+TEST channel_join_creates_channel(void) {
+    int member = 0;
+    size_t index = 42;
+
+    ASSERT_EQ(channel_registry_get(&CHANNELS, (uint8_t *)"general"), NULL);
+
+    Channel *channel = channel_join(&CHANNELS, (uint8_t *)"general", &member, &index);
+
+    ASSERT_FALSE(get_error());
+    ASSERT(channel);
+    ASSERT_EQ(index, 0);
+    ASSERT_EQ(channel->len, 1);
+    ASSERT_EQ(channel->members[0], &member);
+    ASSERT_STR_EQ(channel->name, "general");
+    ASSERT_EQ(channel_registry_get(&CHANNELS, (uint8_t *)"general"), channel);
+    ASSERT_EQ(channel_registry_get(&CHANNELS, (uint8_t *)"General"), NULL);
+
+    PASS();
+}
+
+TEST channel_leave_swaps_last_member(void) {
+    int members[4];
+    size_t index[4];
+    Channel *channel = NULL;
+
+    for (int i = 0; i < 4; i++) {
+        channel = channel_join(&CHANNELS, (uint8_t *)"general", &members[i], &index[i]);
+        ASSERT_EQ(index[i], (size_t)i);
+    }
+
+    // The last member takes the place of the leaving one
+    ASSERT_EQ(channel_leave(&CHANNELS, channel, index[1]), &members[3]);
+    ASSERT_EQ(channel->len, 3);
+    ASSERT_EQ(channel->members[1], &members[3]);
+
+    // Nothing has to be moved when the last member leaves
+    ASSERT_EQ(channel_leave(&CHANNELS, channel, 2), NULL);
+    ASSERT_EQ(channel->len, 2);
+    ASSERT_EQ(channel->members[0], &members[0]);
+    ASSERT_EQ(channel->members[1], &members[3]);
+
+    PASS();
+}
+
+TEST channel_freed_when_empty(void) {
+    int member;
+    size_t index;
+
+    Channel *channel = channel_join(&CHANNELS, (uint8_t *)"general", &member, &index);
+    ASSERT_EQ(CHANNELS.len, 1);
+
+    ASSERT_EQ(channel_leave(&CHANNELS, channel, index), NULL);
+    ASSERT_EQ(CHANNELS.len, 0);
+    ASSERT_EQ(channel_registry_get(&CHANNELS, (uint8_t *)"general"), NULL);
+
+    PASS();
+}
+
+TEST channel_many(void) {
+    int member;
+    size_t index;
+    char name[CHANNEL_ID_LEN + 1];
+
+    for (int i = 0; i < 1000; i++) {
+        sprintf(name, "channel-%d", i);
+        ASSERT(channel_join(&CHANNELS, (uint8_t *)name, &member, &index));
+    }
+
+    ASSERT_EQ(CHANNELS.len, 1000);
+
+    // Remove every other channel, the rest has to stay reachable
+    for (int i = 0; i < 1000; i += 2) {
+        sprintf(name, "channel-%d", i);
+        Channel *channel = channel_registry_get(&CHANNELS, (uint8_t *)name);
+        ASSERT(channel);
+        channel_leave(&CHANNELS, channel, 0);
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        sprintf(name, "channel-%d", i);
+        Channel *channel = channel_registry_get(&CHANNELS, (uint8_t *)name);
+
+        if (i % 2) {
+            ASSERT(channel);
+            ASSERT_STR_EQ(channel->name, name);
+        } else {
+            ASSERT_EQ(channel, NULL);
+        }
+    }
+
+    PASS();
+}
+
+GREATEST_SUITE(channel) {
+    GREATEST_SET_SETUP_CB(channel_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(channel_tear_down, NULL);
+
+    RUN_TEST(channel_join_creates_channel);
+    RUN_TEST(channel_leave_swaps_last_member);
+    RUN_TEST(channel_freed_when_empty);
+    RUN_TEST(channel_many);
+}
@@ -23,6 +23,16 @@ SUITE(commands);
     ASSERT_STR_EQ(cmd.data.output_buf, output); \
 } while (0)
 
+/// The message references the input instead of being copied
+#define MESSAGE_TEST(input, output) do { \
+    const char *str = input; \
+    Command cmd = command_parse((void *)str); \
+    ASSERT_FALSE(get_error()); \
+    ASSERT_EQ(cmd.type, CommandType_None); \
+    ASSERT_EQ(cmd.data.message.data, (const uint8_t *)strstr(str, output)); \
+    ASSERT_EQ(cmd.data.message.len, strlen(output)); \
+} while (0)
+
 static enum greatest_test_res auth_cmd_test(
         const void *input, 
         const void *username, 
@@ -49,12 +59,15 @@ static enum greatest_test_res invalid_command(const void *input) {
 }
 
 TEST no_command() {
-    COMMAND_TEST("Hello", CommandType_None, message, "Hello");
-    COMMAND_TEST("    Hi there", CommandType_None, message, "Hi there");
-    COMMAND_TEST("Hmmmm", CommandType_None, message, "Hmmmm");
-    COMMAND_TEST("   both side   ", CommandType_None, message, "both side");
-    COMMAND_TEST("/authh is not commands", CommandType_None, message, "/authh is not commands");
-    COMMAND_TEST("//join notcommands", CommandType_None, message, "//join notcommands");
+    MESSAGE_TEST("Hello", "Hello");
+    MESSAGE_TEST("    Hi there", "Hi there");
+    MESSAGE_TEST("Hmmmm", "Hmmmm");
+    MESSAGE_TEST("   both side   ", "both side");
+    MESSAGE_TEST("/authh is not commands", "/authh is not commands");
+    MESSAGE_TEST("//join notcommands", "//join notcommands");
+
+    CHECK_CALL(invalid_command("   "));
+    CHECK_CALL(invalid_command("not\ttab"));
 
     PASS();
 }
@@ -0,0 +1,144 @@
+#include "greatest.h"
+#include "../src/credentials.h"
+#include "../src/error.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+char CREDENTIALS_PATH[] = "/tmp/ipk24chat-credentials-XXXXXX";
+Credentials CREDENTIALS_INDEX;
+
+static void credentials_setup(void *arg) {
+    strcpy(CREDENTIALS_PATH, "/tmp/ipk24chat-credentials-XXXXXX");
+    close(mkstemp(CREDENTIALS_PATH));
+    memset(&CREDENTIALS_INDEX, 0, sizeof(Credentials));
+    set_error(Error_None);
+    (void)arg;
+}
+
+static void credentials_tear_down(void *arg) {
+    credentials_close(&CREDENTIALS_INDEX);
+    unlink(CREDENTIALS_PATH);
+    (void)arg;
+}
+
+static size_t credentials_build_str(const char *list) {
+    FILE *input = fmemopen((void *)list, strlen(list), "r");
+    FILE *output = fopen(CREDENTIALS_PATH, "wb");
+    size_t count = credentials_build(input, output);
+
+    fclose(input);
+    fclose(output);
+    return count;
+}
+
+SUITE(credentials);
+
+TEST credentials_build_and_verify(void) {
+    size_t count = credentials_build_str(
+        "# comment\n"
+        "xnguye27:secret-1\n"
+        "\n"
+        "alice:a1b2c3\r\n"
+        "bob:x\n"
+        "alice:replaced\n"
+    );
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(count, 3);
+
+    CREDENTIALS_INDEX = credentials_open(CREDENTIALS_PATH);
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(CREDENTIALS_INDEX.header->record_count, 3);
+    ASSERT(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"xnguye27", (uint8_t *)"secret-1"));
+    ASSERT(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"bob", (uint8_t *)"x"));
+    ASSERT(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"alice", (uint8_t *)"replaced"));
+    ASSERT_FALSE(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"alice", (uint8_t *)"a1b2c3"));
+    ASSERT_FALSE(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"xnguye27", (uint8_t *)"secret-"));
+    ASSERT_FALSE(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"xnguye27", (uint8_t *)"secret-12"));
+    ASSERT_FALSE(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"xnguye27", (uint8_t *)"secret-2"));
+    ASSERT_FALSE(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"bob", (uint8_t *)""));
+    ASSERT_FALSE(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"carol", (uint8_t *)"x"));
+    ASSERT_FALSE(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"Bob", (uint8_t *)"x"));
+
+    PASS();
+}
+
+TEST credentials_malformed(void) {
+    credentials_build_str("alice:ok\nbob has no secret\n");
+    ASSERT_EQ(get_error(), Error_InvalidInput);
+
+    set_error(Error_None);
+    credentials_build_str("alice:\n");
+    ASSERT_EQ(get_error(), Error_InvalidInput);
+
+    set_error(Error_None);
+    credentials_build_str("al ice:secret\n");
+    ASSERT_EQ(get_error(), Error_InvalidInput);
+
+    set_error(Error_None);
+    credentials_build_str("abcdefghijklmnopqrstu:too-long-username\n");
+    ASSERT_EQ(get_error(), Error_InvalidInput);
+
+    PASS();
+}
+
+TEST credentials_open_invalid(void) {
+    FILE *file = fopen(CREDENTIALS_PATH, "wb");
+    fputs("alice:secret\n", file);
+    fclose(file);
+
+    CREDENTIALS_INDEX = credentials_open(CREDENTIALS_PATH);
+    ASSERT_EQ(get_error(), Error_InvalidArgument);
+    ASSERT_EQ(CREDENTIALS_INDEX.map, NULL);
+    ASSERT_FALSE(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)"alice", (uint8_t *)"secret"));
+
+    set_error(Error_None);
+    CREDENTIALS_INDEX = credentials_open("/nonexistent/ipk24chat-credentials");
+    ASSERT_EQ(get_error(), Error_InvalidArgument);
+
+    PASS();
+}
+
+TEST credentials_many(void) {
+    FILE *input = tmpfile();
+
+    for (int i = 0; i < 10000; i++) {
+        fprintf(input, "user-%d:secret-%d\n", i, i * 7);
+    }
+
+    rewind(input);
+    FILE *output = fopen(CREDENTIALS_PATH, "wb");
+    size_t count = credentials_build(input, output);
+    fclose(input);
+    fclose(output);
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(count, 10000);
+
+    CREDENTIALS_INDEX = credentials_open(CREDENTIALS_PATH);
+    ASSERT_FALSE(get_error());
+
+    for (int i = 0; i < 10000; i++) {
+        char username[32], secret[32], wrong[32];
+        sprintf(username, "user-%d", i);
+        sprintf(secret, "secret-%d", i * 7);
+        sprintf(wrong, "secret-%d", i * 7 + 1);
+
+        ASSERT(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)username, (uint8_t *)secret));
+        ASSERT_FALSE(credentials_verify(&CREDENTIALS_INDEX, (uint8_t *)username, (uint8_t *)wrong));
+    }
+
+    PASS();
+}
+
+GREATEST_SUITE(credentials) {
+    GREATEST_SET_SETUP_CB(credentials_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(credentials_tear_down, NULL);
+
+    RUN_TEST(credentials_build_and_verify);
+    RUN_TEST(credentials_malformed);
+    RUN_TEST(credentials_open_invalid);
+    RUN_TEST(credentials_many);
+}
@@ -0,0 +1,221 @@
+#include "greatest.h"
+#include "../src/error.h"
+#include "../src/framer.h"
+#include "../src/tcp.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+Framer FRAMER;
+int FRAMER_FDS[2];
+
+static void framer_setup(void *arg) {
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, FRAMER_FDS);
+    framer_init(&FRAMER);
+    set_error(Error_None);
+    (void)arg;
+}
+
+static void framer_tear_down(void *arg) {
+    close(FRAMER_FDS[0]);
+    close(FRAMER_FDS[1]);
+    (void)arg;
+}
+
+static void framer_write(const char *data) {
+    ssize_t len = write(FRAMER_FDS[1], data, strlen(data));
+    (void)len;
+}
+
+SUITE(framer);
+
+TEST framer_several_messages_per_read(void) {
+    framer_write("MSG FROM a IS 1\r\nMSG FROM b IS 2\r\nBYE\r\n");
+
+    ASSERT_EQ(framer_read(&FRAMER, FRAMER_FDS[0]), 39);
+
+    Bytes message;
+    ASSERT(framer_next(&FRAMER, &message));
+    ASSERT_EQ(message.len, 17);
+    ASSERT_MEM_EQ(bytes_get(&message), "MSG FROM a IS 1\r\n", 17);
+
+    ASSERT(framer_pending(&FRAMER));
+    ASSERT(framer_next(&FRAMER, &message));
+    ASSERT_MEM_EQ(bytes_get(&message), "MSG FROM b IS 2\r\n", 17);
+
+    ASSERT(framer_next(&FRAMER, &message));
+    ASSERT_MEM_EQ(bytes_get(&message), "BYE\r\n", 5);
+
+    ASSERT_FALSE(framer_pending(&FRAMER));
+    ASSERT_FALSE(framer_next(&FRAMER, &message));
+    ASSERT_FALSE(get_error());
+
+    // Nothing more to read
+    ASSERT_EQ(framer_read(&FRAMER, FRAMER_FDS[0]), -1);
+    PASS();
+}
+
+TEST framer_split_message(void) {
+    Bytes message;
+
+    // Split between the \r and \n of the terminator
+    framer_write("REPLY OK IS hi\r");
+    framer_read(&FRAMER, FRAMER_FDS[0]);
+    ASSERT_FALSE(framer_next(&FRAMER, &message));
+
+    framer_write("\nBY");
+    framer_read(&FRAMER, FRAMER_FDS[0]);
+    ASSERT(framer_next(&FRAMER, &message));
+    ASSERT_EQ(message.len, 16);
+    ASSERT_MEM_EQ(bytes_get(&message), "REPLY OK IS hi\r\n", 16);
+    ASSERT_FALSE(framer_next(&FRAMER, &message));
+
+    framer_write("E\r\n");
+    framer_read(&FRAMER, FRAMER_FDS[0]);
+    ASSERT(framer_next(&FRAMER, &message));
+    ASSERT_MEM_EQ(bytes_get(&message), "BYE\r\n", 5);
+
+    ASSERT_FALSE(get_error());
+    PASS();
+}
+
+TEST framer_wraps_around(void) {
+    char content[1200];
+    memset(content, 'x', sizeof(content) - 3);
+    strcpy(content + sizeof(content) - 3, "\r\n");
+
+    Bytes message;
+
+    // Enough messages for the ring to wrap around several times
+    for (int i = 0; i < 40; i++) {
+        framer_write(content);
+        framer_write("BY");
+        ASSERT(framer_read(&FRAMER, FRAMER_FDS[0]) > 0);
+
+        ASSERT(framer_next(&FRAMER, &message));
+        ASSERT_EQ(message.len, sizeof(content) - 1);
+        ASSERT_MEM_EQ(bytes_get(&message), content, sizeof(content) - 1);
+
+        framer_write("E\r\n");
+        ASSERT(framer_read(&FRAMER, FRAMER_FDS[0]) > 0);
+        ASSERT(framer_next(&FRAMER, &message));
+        ASSERT_MEM_EQ(bytes_get(&message), "BYE\r\n", 5);
+    }
+
+    ASSERT_EQ(FRAMER.len, 0);
+    ASSERT_FALSE(get_error());
+    PASS();
+}
+
+TEST framer_terminator_across_the_end(void) {
+    // The \r is the last byte of the ring and the \n the first one
+    FRAMER.head = FRAMER_SIZE - 4;
+    framer_write("BYE\r\nBYE\r\n");
+    ASSERT_EQ(framer_read(&FRAMER, FRAMER_FDS[0]), 10);
+
+    Bytes message;
+    ASSERT(framer_next(&FRAMER, &message));
+    ASSERT_EQ(message.len, 5);
+    ASSERT_MEM_EQ(bytes_get(&message), "BYE\r\n", 5);
+
+    ASSERT(framer_next(&FRAMER, &message));
+    ASSERT_MEM_EQ(bytes_get(&message), "BYE\r\n", 5);
+    ASSERT_FALSE(framer_next(&FRAMER, &message));
+
+    PASS();
+}
+
+TEST framer_too_long_message(void) {
+    char content[BYTES_SIZE + 10];
+    memset(content, 'x', sizeof(content) - 1);
+    content[sizeof(content) - 1] = '\0';
+
+    framer_write(content);
+    framer_read(&FRAMER, FRAMER_FDS[0]);
+
+    Bytes message;
+    ASSERT_FALSE(framer_next(&FRAMER, &message));
+    ASSERT_EQ(get_error(), Error_InvalidPayload);
+    ASSERT_EQ(FRAMER.len, 0);
+
+    PASS();
+}
+
+TEST framer_view_references_ring(void) {
+    framer_write("BYE\r\n");
+    framer_read(&FRAMER, FRAMER_FDS[0]);
+
+    const uint8_t *data;
+    size_t len;
+    ASSERT(framer_next_view(&FRAMER, &data, &len));
+    ASSERT_EQ(data, FRAMER.data);
+    ASSERT_EQ(len, 5);
+
+    // A message crossing the end of the ring is copied to be contiguous
+    FRAMER.head = FRAMER_SIZE - 2;
+    framer_write("BYE\r\n");
+    framer_read(&FRAMER, FRAMER_FDS[0]);
+
+    ASSERT(framer_next_view(&FRAMER, &data, &len));
+    ASSERT_EQ(data, FRAMER.line);
+    ASSERT_EQ(len, 5);
+    ASSERT_MEM_EQ(data, "BYE\r\n", 5);
+
+    ASSERT_FALSE(get_error());
+    PASS();
+}
+
+TEST framer_tcp_receive_coalesced(void) {
+    Connection conn = {0};
+    conn.sockfd = FRAMER_FDS[0];
+    framer_init(&conn.framer);
+    tcp_setup();
+
+    framer_write("MSG FROM Server IS one\r\nMSG FROM Server IS tw");
+
+    PayloadView payload = tcp_receive(&conn);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(payload.type, PayloadType_Message);
+    ASSERT_EQ(payload.message_content.len, 3);
+    ASSERT_MEM_EQ(payload.message_content.data, "one", 3);
+    ASSERT_FALSE(tcp_pending(&conn));
+
+    // The read has not completed the second message
+    payload = tcp_receive(&conn);
+    ASSERT_EQ(get_error(), Error_NoPayload);
+    error_clear();
+
+    framer_write("o\r\nBYE\r\n");
+
+    payload = tcp_receive(&conn);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(payload.message_content.len, 3);
+    ASSERT_MEM_EQ(payload.message_content.data, "two", 3);
+    ASSERT(tcp_pending(&conn));
+
+    payload = tcp_receive(&conn);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(payload.type, PayloadType_Bye);
+
+    // The server closes the connection
+    close(FRAMER_FDS[1]);
+    FRAMER_FDS[1] = socket(AF_UNIX, SOCK_STREAM, 0);
+    payload = tcp_receive(&conn);
+    ASSERT_EQ(get_error(), Error_Connection);
+
+    tcp_destroy();
+    PASS();
+}
+
+GREATEST_SUITE(framer) {
+    GREATEST_SET_SETUP_CB(framer_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(framer_tear_down, NULL);
+
+    RUN_TEST(framer_several_messages_per_read);
+    RUN_TEST(framer_split_message);
+    RUN_TEST(framer_wraps_around);
+    RUN_TEST(framer_terminator_across_the_end);
+    RUN_TEST(framer_too_long_message);
+    RUN_TEST(framer_view_references_ring);
+    RUN_TEST(framer_tcp_receive_coalesced);
+}
@@ -0,0 +1,262 @@
+#include "greatest.h"
+#include "../src/error.h"
+#include "../src/handoff.h"
+#include "../src/tcp.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+int HANDOFF_FDS[2];
+
+static void handoff_setup(void *arg) {
+    socketpair(AF_UNIX, SOCK_STREAM, 0, HANDOFF_FDS);
+    set_error(Error_None);
+    tcp_setup();
+    (void)arg;
+}
+
+static void handoff_tear_down(void *arg) {
+    close(HANDOFF_FDS[0]);
+    close(HANDOFF_FDS[1]);
+    tcp_destroy();
+    (void)arg;
+}
+
+SUITE(handoff);
+
+TEST handoff_record_with_socket(void) {
+    int pipe_fds[2];
+    ASSERT_EQ(pipe(pipe_fds), 0);
+
+    HandoffListener listener = { 3, Mode_UDP };
+    handoff_send(HANDOFF_FDS[0], HandoffRecord_Listener, &listener, sizeof(listener), pipe_fds[1]);
+    handoff_send(HANDOFF_FDS[0], HandoffRecord_End, NULL, 0, -1);
+    ASSERT_FALSE(get_error());
+
+    HandoffRecord record = handoff_recv(HANDOFF_FDS[1]);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(record.type, HandoffRecord_Listener);
+    ASSERT_EQ(record.len, sizeof(listener));
+    ASSERT_MEM_EQ(record.body, &listener, sizeof(listener));
+    ASSERT(record.fd >= 0);
+
+    // The passed descriptor refers to the same pipe
+    ASSERT_EQ(write(record.fd, "x", 1), 1);
+    char c = 0;
+    ASSERT_EQ(read(pipe_fds[0], &c, 1), 1);
+    ASSERT_EQ(c, 'x');
+
+    handoff_record_free(&record);
+    ASSERT_EQ(record.fd, -1);
+
+    record = handoff_recv(HANDOFF_FDS[1]);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(record.type, HandoffRecord_End);
+    ASSERT_EQ(record.len, 0);
+    ASSERT_EQ(record.fd, -1);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    PASS();
+}
+
+TEST handoff_tcp_session(void) {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+
+    struct sockaddr_in address = {0};
+    address.sin_port = htons(1234);
+
+    Session *session = session_new(Mode_TCP, fds[0], &address);
+    session->state = SessionState_Open;
+    strcpy((void *)session->display_name, "Alice");
+    memcpy(session->input.data, "MSG FROM", 8);
+    session->input.len = 8;
+
+    Channel channel = {0};
+    strcpy((void *)channel.name, "room");
+    session->channel = &channel;
+
+    Payload payload = {0};
+    payload.type = PayloadType_Bye;
+    Wire *wire = wire_new(&payload, Mode_TCP);
+    session_queue_wire(session, wire);
+    session_queue_wire(session, wire);
+    session_output_sent(session, 2);
+    wire_unref(wire);
+
+    handoff_send_session(HANDOFF_FDS[0], 2, session);
+    ASSERT_FALSE(get_error());
+
+    HandoffRecord record = handoff_recv(HANDOFF_FDS[1]);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(record.type, HandoffRecord_Session);
+
+    uint16_t loop = 0;
+    ChannelID channel_id;
+    Session *restored = handoff_session(&record, &loop, channel_id);
+    handoff_record_free(&record);
+
+    ASSERT(restored);
+    ASSERT_EQ(loop, 2);
+    ASSERT_STR_EQ((char *)channel_id, "room");
+    ASSERT_EQ(restored->mode, Mode_TCP);
+    ASSERT_EQ(restored->state, SessionState_Open);
+    ASSERT_EQ(restored->address.sin_port, htons(1234));
+    ASSERT_STR_EQ((char *)restored->display_name, "Alice");
+    ASSERT_EQ(restored->input.len, 8);
+    ASSERT_MEM_EQ(restored->input.data, "MSG FROM", 8);
+
+    // The rest of the partially sent output is a single payload now
+    ASSERT_EQ(restored->output.len, 1);
+    ASSERT_EQ(restored->output.items[0]->len, 8);
+    ASSERT_MEM_EQ(restored->output.items[0]->data, "E\r\nBYE\r\n", 8);
+
+    // The socket is passed along
+    ASSERT(restored->source.fd >= 0);
+    ASSERT(restored->source.fd != fds[0]);
+    ASSERT_EQ(write(restored->source.fd, "y", 1), 1);
+    char c = 0;
+    ASSERT_EQ(read(fds[1], &c, 1), 1);
+
+    session->channel = NULL;
+    session_free(session);
+    session_free(restored);
+    close(fds[1]);
+    PASS();
+}
+
+TEST handoff_closed_session(void) {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+
+    struct sockaddr_in address = {0};
+    Session *session = session_new(Mode_TCP, fds[0], &address);
+    session->state = SessionState_End;
+    session->closed = true;
+
+    Payload payload = {0};
+    payload.type = PayloadType_Bye;
+    Wire *wire = wire_new(&payload, Mode_TCP);
+    session_queue_wire(session, wire);
+    wire_unref(wire);
+
+    handoff_send_session(HANDOFF_FDS[0], 0, session);
+    ASSERT_FALSE(get_error());
+
+    HandoffRecord record = handoff_recv(HANDOFF_FDS[1]);
+    uint16_t loop = 0;
+    ChannelID channel_id;
+    Session *restored = handoff_session(&record, &loop, channel_id);
+    handoff_record_free(&record);
+
+    // Only its output is left to be written by the new server
+    ASSERT(restored);
+    ASSERT(restored->closed);
+    ASSERT_EQ(restored->state, SessionState_End);
+    ASSERT_EQ(restored->output.len, 1);
+    ASSERT_MEM_EQ(restored->output.items[0]->data, "BYE\r\n", 5);
+
+    session_free(session);
+    session_free(restored);
+    close(fds[1]);
+    PASS();
+}
+
+TEST handoff_udp_session(void) {
+    TimerWheel timers;
+    timer_wheel_init(&timers, 0);
+
+    struct sockaddr_in address = {0};
+    Session *session = session_new(Mode_UDP, -1, &address);
+    session->shared_socket = true;
+    session->timers = &timers;
+    session->next_message_id = 42;
+    replay_window_insert(&session->received_ids, 7);
+    replay_window_insert(&session->received_ids, 65535);
+
+    Payload payload = {0};
+    payload.type = PayloadType_Bye;
+    Wire *wire = wire_new(&payload, Mode_UDP);
+
+    SessionPending *pending = calloc(1, sizeof(SessionPending));
+    pending->session = session;
+    pending->id = 41;
+    pending->retry_count = 2;
+    pending->wire = wire;
+    session->pending = session->pending_tail = pending;
+
+    handoff_send_session(HANDOFF_FDS[0], 0, session);
+    ASSERT_FALSE(get_error());
+
+    HandoffRecord record = handoff_recv(HANDOFF_FDS[1]);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(record.fd, -1);
+
+    uint16_t loop = 1;
+    ChannelID channel_id;
+    Session *restored = handoff_session(&record, &loop, channel_id);
+    handoff_record_free(&record);
+
+    ASSERT(restored);
+    ASSERT_EQ(loop, 0);
+    ASSERT_EQ(channel_id[0], '\0');
+    ASSERT(restored->shared_socket);
+    ASSERT_EQ(restored->source.fd, -1);
+    ASSERT_EQ(restored->next_message_id, 42);
+    ASSERT(replay_window_contains(&restored->received_ids, 7));
+    ASSERT(replay_window_contains(&restored->received_ids, 65535));
+    ASSERT_FALSE(replay_window_contains(&restored->received_ids, 8));
+
+    ASSERT(restored->pending);
+    ASSERT_EQ(restored->pending, restored->pending_tail);
+    ASSERT_EQ(restored->pending->session, restored);
+    ASSERT_EQ(restored->pending->id, 41);
+    ASSERT_EQ(restored->pending->retry_count, 2);
+    ASSERT_EQ(restored->pending->wire->len, wire->len);
+    ASSERT_MEM_EQ(restored->pending->wire->data, wire->data, wire->len);
+    ASSERT_FALSE(restored->pending->timer.armed);
+
+    session_free(session);
+    session_free(restored);
+    PASS();
+}
+
+TEST handoff_truncated_session(void) {
+    uint8_t body[16] = {0};
+    handoff_send(HANDOFF_FDS[0], HandoffRecord_Session, body, sizeof(body), -1);
+
+    HandoffRecord record = handoff_recv(HANDOFF_FDS[1]);
+    ASSERT_FALSE(get_error());
+
+    uint16_t loop;
+    ChannelID channel_id;
+    ASSERT_EQ(handoff_session(&record, &loop, channel_id), NULL);
+    ASSERT_EQ(get_error(), Error_InvalidPayload);
+
+    handoff_record_free(&record);
+    PASS();
+}
+
+TEST handoff_closed_connection(void) {
+    close(HANDOFF_FDS[0]);
+    HANDOFF_FDS[0] = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    HandoffRecord record = handoff_recv(HANDOFF_FDS[1]);
+    ASSERT_EQ(get_error(), Error_Connection);
+    handoff_record_free(&record);
+
+    PASS();
+}
+
+GREATEST_SUITE(handoff) {
+    GREATEST_SET_SETUP_CB(handoff_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(handoff_tear_down, NULL);
+
+    RUN_TEST(handoff_record_with_socket);
+    RUN_TEST(handoff_tcp_session);
+    RUN_TEST(handoff_closed_session);
+    RUN_TEST(handoff_udp_session);
+    RUN_TEST(handoff_truncated_session);
+    RUN_TEST(handoff_closed_connection);
+}
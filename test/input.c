@@ -0,0 +1,117 @@
+#include "greatest.h"
+#include "../src/error.h"
+#include "../src/input.h"
+#include <string.h>
+#include <unistd.h>
+
+Input INPUT_RING;
+int INPUT_FDS[2];
+
+static void input_setup(void *arg) {
+    ssize_t result = pipe(INPUT_FDS);
+    (void)result;
+    input_init(&INPUT_RING);
+    set_error(Error_None);
+    (void)arg;
+}
+
+static void input_tear_down(void *arg) {
+    close(INPUT_FDS[0]);
+    if (INPUT_FDS[1] >= 0) close(INPUT_FDS[1]);
+    (void)arg;
+}
+
+static void input_write(const char *data) {
+    ssize_t len = write(INPUT_FDS[1], data, strlen(data));
+    (void)len;
+}
+
+SUITE(input);
+
+TEST input_several_lines_per_read(void) {
+    input_write("/auth a b c\nhello\n\nbye");
+    ASSERT_EQ(input_read(&INPUT_RING, INPUT_FDS[0]), 22);
+
+    const uint8_t *line;
+    size_t len;
+    ASSERT(input_next_line(&INPUT_RING, &line, &len));
+    ASSERT_EQ(len, 11);
+    ASSERT_STR_EQ((char *)line, "/auth a b c");
+
+    // The line is parsed where it has been read
+    ASSERT(input_next_line(&INPUT_RING, &line, &len));
+    ASSERT_EQ(line, INPUT_RING.data + 12);
+    ASSERT_STR_EQ((char *)line, "hello");
+
+    ASSERT(input_next_line(&INPUT_RING, &line, &len));
+    ASSERT_EQ(len, 0);
+
+    // The last line is not complete yet
+    ASSERT_FALSE(input_next_line(&INPUT_RING, &line, &len));
+    ASSERT_FALSE(INPUT_RING.eof);
+
+    close(INPUT_FDS[1]);
+    INPUT_FDS[1] = -1;
+    ASSERT_EQ(input_read(&INPUT_RING, INPUT_FDS[0]), 0);
+    ASSERT(INPUT_RING.eof);
+    ASSERT_FALSE(input_next_line(&INPUT_RING, &line, &len));
+
+    ASSERT_FALSE(get_error());
+    PASS();
+}
+
+TEST input_line_across_the_end(void) {
+    INPUT_RING.head = INPUT_SIZE - 3;
+    input_write("hello\nhi\n");
+    ASSERT_EQ(input_read(&INPUT_RING, INPUT_FDS[0]), 9);
+
+    const uint8_t *line;
+    size_t len;
+    ASSERT(input_next_line(&INPUT_RING, &line, &len));
+    ASSERT_EQ(line, INPUT_RING.line);
+    ASSERT_STR_EQ((char *)line, "hello");
+
+    ASSERT(input_next_line(&INPUT_RING, &line, &len));
+    ASSERT_EQ(line, INPUT_RING.data + 3);
+    ASSERT_STR_EQ((char *)line, "hi");
+
+    ASSERT_EQ(INPUT_RING.len, 0);
+    PASS();
+}
+
+TEST input_too_long_line(void) {
+    char content[BYTES_SIZE + 10];
+    memset(content, 'x', sizeof(content) - 1);
+    content[sizeof(content) - 1] = '\0';
+
+    input_write(content);
+    input_read(&INPUT_RING, INPUT_FDS[0]);
+
+    const uint8_t *line;
+    size_t len;
+    ASSERT_FALSE(input_next_line(&INPUT_RING, &line, &len));
+    ASSERT_EQ(INPUT_RING.len, 0);
+
+    // The rest of the line is dropped too, the next line is kept
+    input_write("xxx\nhello\n");
+    input_read(&INPUT_RING, INPUT_FDS[0]);
+
+    ASSERT(input_next_line(&INPUT_RING, &line, &len));
+    ASSERT_EQ(get_error(), Error_InvalidInput);
+    ASSERT_EQ(len, 0);
+    error_clear();
+
+    ASSERT(input_next_line(&INPUT_RING, &line, &len));
+    ASSERT_STR_EQ((char *)line, "hello");
+    ASSERT_FALSE(get_error());
+    PASS();
+}
+
+GREATEST_SUITE(input) {
+    GREATEST_SET_SETUP_CB(input_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(input_tear_down, NULL);
+
+    RUN_TEST(input_several_lines_per_read);
+    RUN_TEST(input_line_across_the_end);
+    RUN_TEST(input_too_long_line);
+}
@@ -8,6 +8,20 @@
 #include "udp.c"
 #include "trie.c"
 #include "commands.c"
+#include "channel.c"
+#include "wire.c"
+#include "address_table.c"
+#include "timer_wheel.c"
+#include "credentials.c"
+#include "session.c"
+#include "server.c"
+#include "handoff.c"
+#include "framer.c"
+#include "scan.c"
+#include "rto.c"
+#include "replay_window.c"
+#include "input.c"
+#include "output.c"
 
 GREATEST_MAIN_DEFS();
 
@@ -25,6 +39,20 @@ int main(int argc, char **argv) {
     RUN_SUITE(udp);
     RUN_SUITE(trie);
     RUN_SUITE(commands);
+    RUN_SUITE(channel);
+    RUN_SUITE(wire);
+    RUN_SUITE(address_table);
+    RUN_SUITE(timer_wheel);
+    RUN_SUITE(credentials);
+    RUN_SUITE(session);
+    RUN_SUITE(server);
+    RUN_SUITE(handoff);
+    RUN_SUITE(framer);
+    RUN_SUITE(scan);
+    RUN_SUITE(rto);
+    RUN_SUITE(replay_window);
+    RUN_SUITE(input);
+    RUN_SUITE(output);
 
     GREATEST_MAIN_END();
 }
@@ -0,0 +1,157 @@
+#include "greatest.h"
+#include "../src/error.h"
+#include "../src/output.h"
+#include <string.h>
+#include <unistd.h>
+
+int OUTPUT_FDS[2];
+
+static void output_setup(void *arg) {
+    ssize_t result = pipe(OUTPUT_FDS);
+    (void)result;
+    set_error(Error_None);
+    (void)arg;
+}
+
+static void output_tear_down(void *arg) {
+    close(OUTPUT_FDS[0]);
+    close(OUTPUT_FDS[1]);
+    (void)arg;
+}
+
+static PayloadSlice output_slice(const char *str) {
+    PayloadSlice slice = { (const uint8_t *)str, strlen(str) };
+    return slice;
+}
+
+/// Output a REPLY, a MSG and a BYE, then read what has been written
+static size_t output_records(Format format, bool tagged, uint8_t *buffer, size_t len) {
+    output_init(format, OUTPUT_FDS[1], OUTPUT_FDS[1], tagged);
+
+    PayloadView reply = {0};
+    reply.type = PayloadType_Reply;
+    reply.result = true;
+    reply.ref_message_id = 258;
+    reply.message_content = output_slice("Hi");
+
+    PayloadView msg = {0};
+    msg.type = PayloadType_Message;
+    msg.display_name = output_slice("Bot");
+    msg.message_content = output_slice("say \"a\\b\"");
+
+    PayloadView bye = {0};
+    bye.type = PayloadType_Bye;
+
+    output_payload(0, &reply);
+    output_payload(1, &msg);
+    output_payload(258, &bye);
+    output_sent(0, (const uint8_t *)"Me", output_slice("not echoed"));
+    output_flush();
+
+    ssize_t result = read(OUTPUT_FDS[0], buffer, len);
+    return result < 0 ? 0 : result;
+}
+
+SUITE(output);
+
+TEST output_ndjson(void) {
+    char buffer[512] = {0};
+    output_records(Format_Ndjson, false, (uint8_t *)buffer, sizeof(buffer) - 1);
+
+    ASSERT_STR_EQ(buffer,
+        "{\"type\":\"reply\",\"ok\":true,\"ref\":258,\"content\":\"Hi\"}\n"
+        "{\"type\":\"msg\",\"from\":\"Bot\",\"content\":\"say \\\"a\\\\b\\\"\"}\n"
+        "{\"type\":\"bye\"}\n");
+    PASS();
+}
+
+TEST output_binary(void) {
+    uint8_t buffer[512];
+    size_t len = output_records(Format_Binary, false, buffer, sizeof(buffer));
+
+    uint8_t expected[] = {
+        PayloadType_Reply, 0, 5, 1, 1, 2, 'H', 'i',
+        PayloadType_Message, 0, 13, 3, 'B', 'o', 't', 's', 'a', 'y', ' ', '"', 'a', '\\', 'b', '"',
+        PayloadType_Bye, 0, 0,
+    };
+
+    ASSERT_EQ(len, sizeof(expected));
+    ASSERT_MEM_EQ(buffer, expected, len);
+    PASS();
+}
+
+TEST output_text_order(void) {
+    char buffer[512] = {0};
+    output_records(Format_Text, false, (uint8_t *)buffer, sizeof(buffer) - 1);
+
+    // Both streams share the descriptor, the lines come in the order they have been output
+    ASSERT_STR_EQ(buffer,
+        "Success: Hi\n"
+        "Bot: say \"a\\b\"\n"
+        "Me: not echoed\n");
+    PASS();
+}
+
+TEST output_runs(void) {
+    int error_fds[2];
+    ASSERT_EQ(pipe(error_fds), 0);
+    output_init(Format_Text, OUTPUT_FDS[1], error_fds[1], true);
+
+    PayloadView msg = {0};
+    msg.type = PayloadType_Message;
+    msg.display_name = output_slice("Bot");
+    msg.message_content = output_slice("hi");
+
+    output_payload(1, &msg);
+    output_error(-1, "first");
+    output_payload(2, &msg);
+    output_error(2, "second");
+
+    char buffer[128] = {0};
+    output_flush();
+
+    ASSERT(read(OUTPUT_FDS[0], buffer, sizeof(buffer) - 1) > 0);
+    ASSERT_STR_EQ(buffer, "[1] Bot: hi\n[2] Bot: hi\n");
+
+    memset(buffer, 0, sizeof(buffer));
+    ASSERT(read(error_fds[0], buffer, sizeof(buffer) - 1) > 0);
+    ASSERT_STR_EQ(buffer, "ERR: first\n[2] ERR: second\n");
+
+    close(error_fds[0]);
+    close(error_fds[1]);
+    PASS();
+}
+
+TEST output_tagged(void) {
+    char buffer[512] = {0};
+    output_records(Format_Ndjson, true, (uint8_t *)buffer, sizeof(buffer) - 1);
+
+    ASSERT_STR_EQ(buffer,
+        "{\"session\":0,\"type\":\"reply\",\"ok\":true,\"ref\":258,\"content\":\"Hi\"}\n"
+        "{\"session\":1,\"type\":\"msg\",\"from\":\"Bot\",\"content\":\"say \\\"a\\\\b\\\"\"}\n"
+        "{\"session\":258,\"type\":\"bye\"}\n");
+
+    uint8_t binary[512];
+    size_t len = output_records(Format_Binary, true, binary, sizeof(binary));
+
+    // Every record is preceded by the number of its session
+    ASSERT_EQ(len, 27 + 3 * 2);
+    ASSERT_EQ(binary[0], 0);
+    ASSERT_EQ(binary[1], 0);
+    ASSERT_EQ(binary[2], PayloadType_Reply);
+    ASSERT_EQ(binary[len - 5], 1);
+    ASSERT_EQ(binary[len - 4], 2);
+    ASSERT_EQ(binary[len - 3], PayloadType_Bye);
+    PASS();
+}
+
+GREATEST_SUITE(output) {
+    GREATEST_SET_SETUP_CB(output_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(output_tear_down, NULL);
+
+    RUN_TEST(output_ndjson);
+    RUN_TEST(output_binary);
+    RUN_TEST(output_text_order);
+    RUN_TEST(output_runs);
+    RUN_TEST(output_tagged);
+}
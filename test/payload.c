@@ -9,15 +9,15 @@ Bytes BUFFER;
 SUITE(payload);
 
 TEST new(void) {
-    PAYLOAD = payload_new(PayloadType_Bye, NULL);
+    PAYLOAD = payload_new(PayloadType_Bye, 0, NULL);
     ASSERT_EQ(PAYLOAD.type, PayloadType_Bye);
     ASSERT_EQ(PAYLOAD.id, 0);
 
-    PAYLOAD = payload_new(PayloadType_Auth, NULL);
+    PAYLOAD = payload_new(PayloadType_Auth, 1, NULL);
     ASSERT_EQ(PAYLOAD.type, PayloadType_Auth);
     ASSERT_EQ(PAYLOAD.id, 1);
 
-    PAYLOAD = payload_new(PayloadType_Confirm, NULL);
+    PAYLOAD = payload_new(PayloadType_Confirm, 2, NULL);
     ASSERT_EQ(PAYLOAD.type, PayloadType_Confirm);
     ASSERT_EQ(PAYLOAD.id, 2);
 
@@ -0,0 +1,83 @@
+#include "greatest.h"
+#include "../src/replay_window.h"
+
+ReplayWindow REPLAY_WINDOW;
+
+static void replay_window_setup(void *arg) {
+    replay_window_init(&REPLAY_WINDOW);
+    (void)arg;
+}
+
+SUITE(replay_window);
+
+TEST replay_window_duplicates(void) {
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 0));
+
+    replay_window_insert(&REPLAY_WINDOW, 0);
+    replay_window_insert(&REPLAY_WINDOW, 2);
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 0));
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 2));
+
+    // Arrived out of order
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 1));
+    replay_window_insert(&REPLAY_WINDOW, 1);
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 1));
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 3));
+
+    PASS();
+}
+
+TEST replay_window_slides(void) {
+    replay_window_insert(&REPLAY_WINDOW, 10);
+    replay_window_insert(&REPLAY_WINDOW, 100);
+    replay_window_insert(&REPLAY_WINDOW, 10 + REPLAY_WINDOW_BITS - 1);
+
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 10));
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 100));
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 11));
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 99));
+
+    // 10 falls out of the window, anything that old counts as received
+    replay_window_insert(&REPLAY_WINDOW, 10 + REPLAY_WINDOW_BITS);
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 10));
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 9));
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 11));
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 100));
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 101));
+
+    // Jumping further than the window forgets everything in it
+    replay_window_insert(&REPLAY_WINDOW, 5000);
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 4999));
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 5000));
+
+    PASS();
+}
+
+TEST replay_window_wraps_around(void) {
+    // Every ID is seen once by a long conversation
+    for (uint32_t i = 0; i < 3 * 65536; i++) {
+        MessageID id = i;
+        ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, id));
+        replay_window_insert(&REPLAY_WINDOW, id);
+        ASSERT(replay_window_contains(&REPLAY_WINDOW, id));
+    }
+
+    replay_window_init(&REPLAY_WINDOW);
+    replay_window_insert(&REPLAY_WINDOW, 65534);
+    replay_window_insert(&REPLAY_WINDOW, 1);
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 65534));
+    ASSERT(replay_window_contains(&REPLAY_WINDOW, 1));
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 65535));
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 0));
+    ASSERT_FALSE(replay_window_contains(&REPLAY_WINDOW, 2));
+
+    PASS();
+}
+
+GREATEST_SUITE(replay_window) {
+    GREATEST_SET_SETUP_CB(replay_window_setup, NULL);
+
+    RUN_TEST(replay_window_duplicates);
+    RUN_TEST(replay_window_slides);
+    RUN_TEST(replay_window_wraps_around);
+}
@@ -0,0 +1,81 @@
+#include "greatest.h"
+#include "../src/rto.h"
+
+SUITE(rto);
+
+TEST rto_fixed_ignores_samples(void) {
+    Rto rto = rto_new(250, false);
+    ASSERT_EQ(rto.rto, 250);
+
+    rto_sample(&rto, 3);
+    ASSERT_EQ(rto.rto, 250);
+    ASSERT_EQ(rto_backoff(&rto), 250);
+    ASSERT_EQ(rto.rto, 250);
+
+    PASS();
+}
+
+TEST rto_adaptive_estimate(void) {
+    Rto rto = rto_new(1000, true);
+    ASSERT_EQ(rto.rto, 1000);
+
+    // SRTT = 100, RTTVAR = 50, RTO = 100 + 4 * 50
+    rto_sample(&rto, 100);
+    ASSERT_EQ(rto.rto, 300);
+
+    // SRTT = 100, RTTVAR = 37.5, RTO = 100 + 4 * 37.5
+    rto_sample(&rto, 100);
+    ASSERT_EQ(rto.rto, 250);
+
+    // A long stable round-trip time converges to it
+    for (int i = 0; i < 100; i++) rto_sample(&rto, 20);
+    ASSERT(rto.rto >= 20 && rto.rto <= 25);
+
+    PASS();
+}
+
+TEST rto_adaptive_clamps(void) {
+    Rto rto = rto_new(500, true);
+
+    rto_sample(&rto, 0);
+    ASSERT_EQ(rto.rto, RTO_MIN);
+
+    rto_sample(&rto, 10000);
+    ASSERT_EQ(rto.rto, 500);
+
+    // The maximum below the minimum wins
+    rto = rto_new(5, true);
+    rto_sample(&rto, 0);
+    ASSERT_EQ(rto.rto, 5);
+
+    PASS();
+}
+
+TEST rto_adaptive_backoff(void) {
+    Rto rto = rto_new(400, true);
+    rto_sample(&rto, 20);
+    ASSERT_EQ(rto.rto, 60);
+
+    int timeout = rto_backoff(&rto);
+    ASSERT_EQ(rto.rto, 120);
+    ASSERT(timeout >= 90 && timeout <= 120);
+
+    rto_backoff(&rto);
+    rto_backoff(&rto);
+    timeout = rto_backoff(&rto);
+    ASSERT_EQ(rto.rto, 400);
+    ASSERT(timeout >= 300 && timeout <= 400);
+
+    // A new sample replaces the backed off timeout
+    rto_sample(&rto, 20);
+    ASSERT(rto.rto < 100);
+
+    PASS();
+}
+
+GREATEST_SUITE(rto) {
+    RUN_TEST(rto_fixed_ignores_samples);
+    RUN_TEST(rto_adaptive_estimate);
+    RUN_TEST(rto_adaptive_clamps);
+    RUN_TEST(rto_adaptive_backoff);
+}
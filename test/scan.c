@@ -0,0 +1,111 @@
+#include "greatest.h"
+#include "../src/scan.h"
+#include <stdlib.h>
+#include <string.h>
+
+ScanLevel SCAN_DEFAULT_LEVEL;
+
+static void scan_setup(void *arg) {
+    SCAN_DEFAULT_LEVEL = scan_level();
+    srand(42);
+    (void)arg;
+}
+
+static void scan_tear_down(void *arg) {
+    scan_set_level(SCAN_DEFAULT_LEVEL);
+    (void)arg;
+}
+
+/// Results of all the scans of the bytes, using the current level
+static void scan_all(const uint8_t *data, size_t len, size_t result[4]) {
+    result[0] = scan_crlf(data, len);
+    result[1] = scan_id(data, len);
+    result[2] = scan_display_name(data, len);
+    result[3] = scan_message_content(data, len);
+}
+
+SUITE(scan);
+
+TEST scan_scalar(void) {
+    ASSERT(scan_set_level(ScanLevel_Scalar));
+
+    const uint8_t *data = (const uint8_t *)"MSG FROM Alice-1 IS hi there\r\n";
+    size_t len = strlen((const char *)data);
+
+    ASSERT_EQ(scan_crlf(data, len), len - 2);
+    ASSERT_EQ(scan_crlf(data, len - 1), len - 1);
+    ASSERT_EQ(scan_id(data + 9, len - 9), 7);
+    ASSERT_EQ(scan_display_name(data, len), 3);
+    ASSERT_EQ(scan_message_content(data, len), len - 2);
+    ASSERT_EQ(scan_id((const uint8_t *)"a[b", 3), 1);
+    ASSERT_EQ(scan_id((const uint8_t *)"Zz@", 3), 2);
+    ASSERT_EQ(scan_message_content((const uint8_t *)"ab\x7f", 3), 2);
+    ASSERT_EQ(scan_display_name((const uint8_t *)"ab\x80", 3), 2);
+
+    PASS();
+}
+
+TEST scan_levels_match_scalar(void) {
+    static const uint8_t alphabet[] = "aZ09-_ @[`{~\x7f\x80\xff\r\n\t";
+    uint8_t data[200];
+
+    for (ScanLevel level = ScanLevel_SSE2; level <= ScanLevel_AVX2; level++) {
+        if (!scan_set_level(level)) continue;
+
+        for (int round = 0; round < 2000; round++) {
+            // Long valid runs with an occasional different byte, so every position of a vector gets hit
+            uint8_t common = alphabet[rand() % (sizeof(alphabet) - 1)];
+            size_t len = rand() % sizeof(data);
+
+            for (size_t i = 0; i < len; i++) {
+                data[i] = rand() % 40 ? common : alphabet[rand() % (sizeof(alphabet) - 1)];
+            }
+
+            size_t expect[4], result[4];
+
+            scan_set_level(ScanLevel_Scalar);
+            scan_all(data, len, expect);
+            scan_set_level(level);
+            scan_all(data, len, result);
+
+            ASSERT_MEM_EQ(expect, result, sizeof(expect));
+        }
+    }
+
+    PASS();
+}
+
+TEST scan_crlf_at_vector_boundaries(void) {
+    uint8_t data[100];
+
+    for (ScanLevel level = ScanLevel_Scalar; level <= ScanLevel_AVX2; level++) {
+        if (!scan_set_level(level)) continue;
+
+        for (size_t at = 0; at + 1 < sizeof(data); at++) {
+            memset(data, 'x', sizeof(data));
+
+            // A lone \r and a lone \n before the terminator are not one
+            if (at >= 2) {
+                data[at - 2] = '\n';
+                data[at - 1] = '\r';
+            }
+
+            data[at] = '\r';
+            data[at + 1] = '\n';
+
+            ASSERT_EQ(scan_crlf(data, sizeof(data)), at);
+            ASSERT_EQ(scan_crlf(data, at + 1), at + 1);
+        }
+    }
+
+    PASS();
+}
+
+GREATEST_SUITE(scan) {
+    GREATEST_SET_SETUP_CB(scan_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(scan_tear_down, NULL);
+
+    RUN_TEST(scan_scalar);
+    RUN_TEST(scan_levels_match_scalar);
+    RUN_TEST(scan_crlf_at_vector_boundaries);
+}
@@ -0,0 +1,153 @@
+#include "greatest.h"
+#include "../src/error.h"
+#include "../src/server.h"
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/// The server stops for good once it is set, it is cleared for each test
+extern atomic_bool SERVER_SHOULD_STOP;
+
+pthread_t SERVER_THREAD;
+Args SERVER_ARGS;
+
+static void *server_test_thread(void *arg) {
+    server_run(*(Args *)arg);
+    return NULL;
+}
+
+/// Port of the loopback that is not used by anything at the moment
+static uint16_t server_free_port(void) {
+    struct sockaddr_in address = {0};
+    socklen_t address_len = sizeof(address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    bind(fd, (struct sockaddr *)&address, sizeof(address));
+    getsockname(fd, (struct sockaddr *)&address, &address_len);
+    close(fd);
+
+    return ntohs(address.sin_port);
+}
+
+/// Connect a client and authenticate it, the server may not be listening yet
+static int server_connect(const char *name, int receive_buffer) {
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(SERVER_ARGS.port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    for (int attempt = 0; attempt < 100; attempt++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (receive_buffer) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0) {
+            char auth[64];
+            int len = snprintf(auth, sizeof(auth), "AUTH %s AS %s USING secret\r\n", name, name);
+            send(fd, auth, len, MSG_NOSIGNAL);
+            return fd;
+        }
+
+        close(fd);
+        usleep(10000);
+    }
+
+    return -1;
+}
+
+/// Number of file descriptors open by the process, the server shares it with the test
+static size_t server_open_fds(void) {
+    DIR *dir = opendir("/proc/self/fd");
+    size_t count = 0;
+
+    for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') count += 1;
+    }
+
+    closedir(dir);
+    return count;
+}
+
+static void server_setup(void *arg) {
+    memset(&SERVER_ARGS, 0, sizeof(SERVER_ARGS));
+    SERVER_ARGS.host = "127.0.0.1";
+    SERVER_ARGS.port = server_free_port();
+    SERVER_ARGS.udp_timeout = 250;
+    SERVER_ARGS.udp_retransmissions = 3;
+    SERVER_ARGS.threads = 1;
+    SERVER_ARGS.output_limit = 16;
+    atomic_store(&SERVER_SHOULD_STOP, false);
+    set_error(Error_None);
+    (void)arg;
+}
+
+static void server_tear_down(void *arg) {
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    set_error(Error_None);
+    (void)arg;
+}
+
+SUITE(server);
+
+/// The reader is disconnected for being slow, or it leaves by itself with its output queue full
+TEST server_frees_closed_session_not_read(bool io_uring, bool leave) {
+    SERVER_ARGS.io_uring = io_uring;
+    if (leave) SERVER_ARGS.output_limit = 60000;
+
+    ASSERT_EQ(pthread_create(&SERVER_THREAD, NULL, server_test_thread, &SERVER_ARGS), 0);
+
+    // The reader never reads, its ERR and BYE stay queued once it is disconnected for being slow
+    int reader = server_connect("reader", 1);
+    int writer = server_connect("writer", 0);
+    ASSERT(reader >= 0 && writer >= 0);
+    usleep(100000);
+
+    size_t fds = server_open_fds();
+    char message[1024];
+    memset(message, 'x', sizeof(message));
+    memcpy(message, "MSG FROM writer IS ", 19);
+    memcpy(message + sizeof(message) - 2, "\r\n", 2);
+
+    // More than the socket buffers of the loopback hold, the rest is queued by the server
+    for (int i = 0; i < 6000; i++) {
+        send(writer, message, sizeof(message), MSG_NOSIGNAL);
+    }
+
+    if (leave) {
+        usleep(100000);
+        send(reader, "BYE FROM reader\r\n", 17, MSG_NOSIGNAL);
+    }
+
+    // The session of the reader is freed after its deadline even though its output queue has not been written
+    for (int i = 0; i < 50 && server_open_fds() >= fds; i++) {
+        usleep(100000);
+    }
+
+    size_t open = server_open_fds();
+
+    pthread_kill(SERVER_THREAD, SIGINT);
+    pthread_join(SERVER_THREAD, NULL);
+    close(reader);
+    close(writer);
+
+    ASSERT_EQ(open, fds - 1);
+    PASS();
+}
+
+GREATEST_SUITE(server) {
+    GREATEST_SET_SETUP_CB(server_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(server_tear_down, NULL);
+
+    RUN_TESTp(server_frees_closed_session_not_read, false, false);
+    RUN_TESTp(server_frees_closed_session_not_read, true, false);
+    RUN_TESTp(server_frees_closed_session_not_read, false, true);
+    RUN_TESTp(server_frees_closed_session_not_read, true, true);
+}
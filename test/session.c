@@ -0,0 +1,169 @@
+#include "greatest.h"
+#include "../src/error.h"
+#include "../src/session.h"
+#include "../src/tcp.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+Session *SESSION;
+int SESSION_PEER;
+
+static void session_setup(void *arg) {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+
+    struct sockaddr_in address = {0};
+    SESSION = session_new(Mode_TCP, fds[0], &address);
+    SESSION_PEER = fds[1];
+
+    set_error(Error_None);
+    tcp_setup();
+    (void)arg;
+}
+
+static void session_tear_down(void *arg) {
+    session_free(SESSION);
+    close(SESSION_PEER);
+    tcp_destroy();
+    (void)arg;
+}
+
+/// Wire of a MSG with the given content
+static Wire *session_message(const char *content) {
+    Payload payload = {0};
+    payload.type = PayloadType_Message;
+    strcpy((void *)payload.data.message.display_name, "Server");
+    strcpy((void *)payload.data.message.message_content, content);
+
+    return wire_new(&payload, Mode_TCP);
+}
+
+static void session_queue_message(const char *content) {
+    Wire *wire = session_message(content);
+    session_queue_wire(SESSION, wire);
+    wire_unref(wire);
+}
+
+SUITE(session);
+
+TEST session_output_flush_in_order(void) {
+    for (int i = 0; i < 20; i++) {
+        char content[8];
+        snprintf(content, sizeof(content), "m%d", i);
+        session_queue_message(content);
+    }
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(SESSION->output.len, 20);
+
+    session_flush(SESSION);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(SESSION->output.len, 0);
+
+    char expect[1024] = {0};
+    char received[1024] = {0};
+
+    for (int i = 0; i < 20; i++) {
+        snprintf(expect + strlen(expect), sizeof(expect) - strlen(expect), "MSG FROM Server IS m%d\r\n", i);
+    }
+
+    ASSERT_EQ(recv(SESSION_PEER, received, sizeof(received), 0), (ssize_t)strlen(expect));
+    ASSERT_STR_EQ(received, expect);
+
+    PASS();
+}
+
+TEST session_output_iov_partial(void) {
+    session_queue_message("first");
+    session_queue_message("second");
+
+    // "MSG FROM Server IS first\r\n" is 26 bytes long
+    session_output_sent(SESSION, 19);
+    ASSERT_EQ(SESSION->output.len, 2);
+
+    struct iovec iov[SESSION_IOV_MAX];
+    ASSERT_EQ(session_output_iov(SESSION, iov, SESSION_IOV_MAX), 2);
+    ASSERT_EQ(iov[0].iov_len, 7);
+    ASSERT_MEM_EQ(iov[0].iov_base, "first\r\n", 7);
+    ASSERT_EQ(session_output_iov(SESSION, iov, 1), 1);
+
+    // Crossing the boundary of the payloads
+    session_output_sent(SESSION, 10);
+    ASSERT_EQ(SESSION->output.len, 1);
+    ASSERT_EQ(SESSION->output.offset, 3);
+
+    session_output_sent(SESSION, 24);
+    ASSERT_EQ(SESSION->output.len, 0);
+    ASSERT_EQ(SESSION->output.offset, 0);
+
+    PASS();
+}
+
+TEST session_output_drop_oldest_keeps_started(void) {
+    session_queue_message("a");
+    session_queue_message("b");
+    session_queue_message("c");
+
+    // The first payload has been partially sent, it has to be finished
+    session_output_sent(SESSION, 1);
+    ASSERT(session_output_drop_oldest(SESSION));
+    ASSERT_EQ(SESSION->output.len, 2);
+
+    struct iovec iov[2];
+    ASSERT_EQ(session_output_iov(SESSION, iov, 2), 2);
+    ASSERT_MEM_EQ(iov[0].iov_base, "SG FROM Server IS a\r\n", iov[0].iov_len);
+    ASSERT_MEM_EQ(iov[1].iov_base, "MSG FROM Server IS c\r\n", iov[1].iov_len);
+
+    ASSERT(session_output_drop_oldest(SESSION));
+    ASSERT_FALSE(session_output_drop_oldest(SESSION));
+    ASSERT_EQ(SESSION->output.len, 1);
+
+    PASS();
+}
+
+TEST session_output_clear_keeps_busy(void) {
+    for (int i = 0; i < 10; i++) session_queue_message("x");
+
+    SESSION->output.busy = 3;
+    session_output_clear(SESSION);
+    ASSERT_EQ(SESSION->output.len, 3);
+
+    SESSION->output.busy = 0;
+    session_output_clear(SESSION);
+    ASSERT_EQ(SESSION->output.len, 0);
+
+    PASS();
+}
+
+TEST session_output_wraps_around(void) {
+    // Keep the head moving so the ring wraps around while it grows
+    for (int i = 0; i < 100; i++) {
+        session_queue_message("y");
+        session_queue_message("z");
+        session_output_sent(SESSION, SESSION->output.items[SESSION->output.head]->len);
+    }
+
+    ASSERT_EQ(SESSION->output.len, 100);
+
+    struct iovec iov[SESSION_IOV_MAX];
+    ASSERT_EQ(session_output_iov(SESSION, iov, SESSION_IOV_MAX), SESSION_IOV_MAX);
+
+    for (size_t i = 0; i < SESSION_IOV_MAX; i++) {
+        const char *expect = i % 2 ? "MSG FROM Server IS z\r\n" : "MSG FROM Server IS y\r\n";
+        ASSERT_MEM_EQ(iov[i].iov_base, expect, iov[i].iov_len);
+    }
+
+    PASS();
+}
+
+GREATEST_SUITE(session) {
+    GREATEST_SET_SETUP_CB(session_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(session_tear_down, NULL);
+
+    RUN_TEST(session_output_flush_in_order);
+    RUN_TEST(session_output_iov_partial);
+    RUN_TEST(session_output_drop_oldest_keeps_started);
+    RUN_TEST(session_output_clear_keeps_busy);
+    RUN_TEST(session_output_wraps_around);
+}
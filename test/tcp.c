@@ -127,6 +127,36 @@ TEST tcp_serialize_bye(void) {
     PASS();
 }
 
+TEST tcp_serialize_iov_references_fields(void) {
+    TCP_PAYLOAD.type = PayloadType_Message;
+    strcpy((void *)TCP_PAYLOAD.data.message.display_name, "tmokenc");
+    strcpy((void *)TCP_PAYLOAD.data.message.message_content, "Nijigasaki Liella");
+
+    struct iovec iov[PAYLOAD_IOV_MAX];
+    ASSERT_EQ(tcp_serialize_iov(&TCP_PAYLOAD, iov), 5);
+    ASSERT_FALSE(get_error());
+
+    // The fields are not copied
+    ASSERT_EQ(iov[1].iov_base, TCP_PAYLOAD.data.message.display_name);
+    ASSERT_EQ(iov[1].iov_len, 7);
+    ASSERT_EQ(iov[3].iov_base, TCP_PAYLOAD.data.message.message_content);
+    ASSERT_EQ(iov[3].iov_len, 17);
+
+    char message[64] = {0};
+    for (size_t i = 0, len = 0; i < 5; len += iov[i].iov_len, i++) {
+        memcpy(message + len, iov[i].iov_base, iov[i].iov_len);
+    }
+
+    ASSERT_STR_EQ(message, "MSG FROM tmokenc IS Nijigasaki Liella\r\n");
+
+    // An empty field cannot be sent
+    TCP_PAYLOAD.data.message.display_name[0] = '\0';
+    tcp_serialize_iov(&TCP_PAYLOAD, iov);
+    ASSERT_EQ(get_error(), Error_InvalidPayload);
+
+    PASS();
+}
+
 TEST tcp_deserialize_reply_ok(void) {
     bytes_push_c_str(&TCP_BUFFER, "REPLY OK IS Nijigasaki Liella\r\n");
 
@@ -216,6 +246,68 @@ TEST tcp_deserialize_bye(void) {
     PASS();
 }
 
+TEST tcp_deserialize_case_insensitive(void) {
+    bytes_push_c_str(&TCP_BUFFER, "auth tomoka as tmokenc Using MyUltimateSecret\r\n");
+
+    TCP_PAYLOAD = tcp_deserialize(TCP_BUFFER);
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(TCP_PAYLOAD.type, PayloadType_Auth);
+    ASSERT_STR_EQ(TCP_PAYLOAD.data.auth.username, "tomoka");
+    ASSERT_STR_EQ(TCP_PAYLOAD.data.auth.secret, "MyUltimateSecret");
+
+    TCP_BUFFER = bytes_new();
+    bytes_push_c_str(&TCP_BUFFER, "Reply nOk iS Nijigasaki IS Liella\r\n");
+
+    TCP_PAYLOAD = tcp_deserialize(TCP_BUFFER);
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(TCP_PAYLOAD.type, PayloadType_Reply);
+    ASSERT_FALSE(TCP_PAYLOAD.data.reply.result);
+    ASSERT_STR_EQ(TCP_PAYLOAD.data.reply.message_content, "Nijigasaki IS Liella");
+
+    // The fields are not case-insensitive, they are copied as they are
+    TCP_BUFFER = bytes_new();
+    bytes_push_c_str(&TCP_BUFFER, "msg from Tmokenc is Hi\r\n");
+
+    TCP_PAYLOAD = tcp_deserialize(TCP_BUFFER);
+
+    ASSERT_FALSE(get_error());
+    ASSERT_STR_EQ(TCP_PAYLOAD.data.message.display_name, "Tmokenc");
+    ASSERT_STR_EQ(TCP_PAYLOAD.data.message.message_content, "Hi");
+
+    PASS();
+}
+
+TEST tcp_deserialize_view_references_buffer(void) {
+    const char *message = "MSG FROM tmokenc IS Nijigasaki Liella\r\n";
+    PayloadView view;
+    tcp_deserialize_view((const uint8_t *)message, strlen(message), &view);
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(view.type, PayloadType_Message);
+    ASSERT_EQ(view.display_name.data, (const uint8_t *)message + 9);
+    ASSERT_EQ(view.display_name.len, 7);
+    ASSERT_EQ(view.message_content.data, (const uint8_t *)message + 20);
+    ASSERT_EQ(view.message_content.len, 17);
+
+    // The view is serialized back without terminating its fields
+    struct iovec iov[PAYLOAD_IOV_MAX];
+    size_t count = tcp_serialize_view_iov(&view, iov);
+    ASSERT_FALSE(get_error());
+
+    char serialized[64] = {0};
+    size_t len = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        memcpy(serialized + len, iov[i].iov_base, iov[i].iov_len);
+        len += iov[i].iov_len;
+    }
+
+    ASSERT_STR_EQ(serialized, message);
+    PASS();
+}
+
 static enum greatest_test_res tcp_deserialize_invalid_payload(char *msg, void *data) {
     Bytes tmp = bytes_new();
     bytes_push_c_str(&tmp, data);
@@ -296,6 +388,20 @@ TEST tcp_deserialize_invalid_message_content(void) {
     PASS();
 }
 
+TEST tcp_deserialize_invalid_structure(void) {
+    CHECK_CALL(tcp_deserialize_invalid_payload("empty", ""));
+    CHECK_CALL(tcp_deserialize_invalid_payload("unknown keyword", "HELLO\r\n"));
+    CHECK_CALL(tcp_deserialize_invalid_payload("missing terminator", "BYE"));
+    CHECK_CALL(tcp_deserialize_invalid_payload("half terminator", "BYE\r"));
+    CHECK_CALL(tcp_deserialize_invalid_payload("trailing data", "BYE\r\nBYE\r\n"));
+    CHECK_CALL(tcp_deserialize_invalid_payload("unknown result", "REPLY MAYBE IS x\r\n"));
+    CHECK_CALL(tcp_deserialize_invalid_payload("missing separator", "JOIN general tmokenc\r\n"));
+    CHECK_CALL(tcp_deserialize_invalid_payload("double space", "MSG FROM  tmokenc IS hi\r\n"));
+    CHECK_CALL(tcp_deserialize_invalid_payload("truncated", "AUTH tomoka AS tmokenc USING\r\n"));
+
+    PASS();
+}
+
 GREATEST_SUITE(tcp) {
     GREATEST_SET_SETUP_CB(_tcp_setup, NULL);
     GREATEST_SET_TEARDOWN_CB(tcp_tear_down, NULL);
@@ -307,6 +413,7 @@ GREATEST_SUITE(tcp) {
     RUN_TEST(tcp_serialize_msg);
     RUN_TEST(tcp_serialize_err);
     RUN_TEST(tcp_serialize_bye);
+    RUN_TEST(tcp_serialize_iov_references_fields);
 
     RUN_TEST(tcp_deserialize_reply_ok);
     RUN_TEST(tcp_deserialize_reply_nok);
@@ -315,10 +422,13 @@ GREATEST_SUITE(tcp) {
     RUN_TEST(tcp_deserialize_msg);
     RUN_TEST(tcp_deserialize_err);
     RUN_TEST(tcp_deserialize_bye);
+    RUN_TEST(tcp_deserialize_case_insensitive);
+    RUN_TEST(tcp_deserialize_view_references_buffer);
 
     RUN_TEST(tcp_deserialize_invalid_secret);
     RUN_TEST(tcp_deserialize_invalid_username);
     RUN_TEST(tcp_deserialize_invalid_channel_id);
     RUN_TEST(tcp_deserialize_invalid_display_name);
     RUN_TEST(tcp_deserialize_invalid_message_content);
+    RUN_TEST(tcp_deserialize_invalid_structure);
 }
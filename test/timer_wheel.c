@@ -0,0 +1,143 @@
+#include "greatest.h"
+#include "../src/timer_wheel.h"
+#include <string.h>
+
+TimerWheel WHEEL;
+
+static void timer_wheel_setup(void *arg) {
+    timer_wheel_init(&WHEEL, 1000);
+    (void)arg;
+}
+
+SUITE(timer_wheel);
+
+TEST timer_wheel_expire_in_order(void) {
+    TimerNode a = {0}, b = {0}, c = {0};
+
+    ASSERT_EQ(timer_wheel_next_timeout(&WHEEL, 1000), -1);
+
+    timer_wheel_arm(&WHEEL, &a, 1250);
+    timer_wheel_arm(&WHEEL, &b, 1100);
+    timer_wheel_arm(&WHEEL, &c, 1250);
+
+    ASSERT_EQ(WHEEL.len, 3);
+    ASSERT_EQ(timer_wheel_next_timeout(&WHEEL, 1000), 100);
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1099), NULL);
+
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1100), &b);
+    ASSERT_FALSE(b.armed);
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1100), NULL);
+    ASSERT_EQ(timer_wheel_next_timeout(&WHEEL, 1100), 150);
+
+    TimerNode *first = timer_wheel_expire(&WHEEL, 1300);
+    TimerNode *second = timer_wheel_expire(&WHEEL, 1300);
+
+    ASSERT(first == &a || first == &c);
+    ASSERT(second == &a || second == &c);
+    ASSERT(first != second);
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1300), NULL);
+    ASSERT_EQ(WHEEL.len, 0);
+    ASSERT_EQ(timer_wheel_next_timeout(&WHEEL, 1300), -1);
+
+    PASS();
+}
+
+TEST timer_wheel_cancel_and_rearm(void) {
+    TimerNode a = {0}, b = {0};
+
+    timer_wheel_arm(&WHEEL, &a, 1010);
+    timer_wheel_arm(&WHEEL, &b, 1010);
+    timer_wheel_cancel(&WHEEL, &a);
+    timer_wheel_cancel(&WHEEL, &a);
+
+    ASSERT_EQ(WHEEL.len, 1);
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1010), &b);
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1010), NULL);
+
+    // Rearming moves the timer to its new slot
+    timer_wheel_arm(&WHEEL, &a, 1020);
+    timer_wheel_arm(&WHEEL, &a, 1500);
+
+    ASSERT_EQ(WHEEL.len, 1);
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1020), NULL);
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1500), &a);
+
+    PASS();
+}
+
+TEST timer_wheel_beyond_one_turn(void) {
+    TimerNode near = {0}, far = {0};
+
+    // Both timers are in the same slot
+    timer_wheel_arm(&WHEEL, &far, 1005 + TIMER_WHEEL_SLOTS * 3);
+    timer_wheel_arm(&WHEEL, &near, 1005);
+
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1005), &near);
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1005 + TIMER_WHEEL_SLOTS), NULL);
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1005 + TIMER_WHEEL_SLOTS * 3 - 1), NULL);
+
+    // The wheel may wake up early, but never late
+    int timeout = timer_wheel_next_timeout(&WHEEL, 1005 + TIMER_WHEEL_SLOTS * 3 - 1);
+    ASSERT(timeout >= 0 && timeout <= 1);
+
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 1005 + TIMER_WHEEL_SLOTS * 3), &far);
+
+    PASS();
+}
+
+TEST timer_wheel_deadline_in_past(void) {
+    TimerNode a = {0};
+
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 5000), NULL);
+
+    timer_wheel_arm(&WHEEL, &a, 10);
+
+    ASSERT_EQ(timer_wheel_next_timeout(&WHEEL, 5000), 0);
+    ASSERT_EQ(timer_wheel_expire(&WHEEL, 5000), &a);
+
+    PASS();
+}
+
+TEST timer_wheel_many(void) {
+    static TimerNode nodes[10000];
+    const size_t count = sizeof(nodes) / sizeof(nodes[0]);
+
+    memset(nodes, 0, sizeof(nodes));
+
+    for (size_t i = 0; i < count; i++) {
+        timer_wheel_arm(&WHEEL, &nodes[i], 1000 + i % 3000);
+    }
+
+    // Cancel every third one
+    for (size_t i = 0; i < count; i += 3) {
+        timer_wheel_cancel(&WHEEL, &nodes[i]);
+    }
+
+    size_t expired = 0;
+
+    for (Timestamp now = 1000; now < 4007; now += 7) {
+        TimerNode *it;
+
+        while ((it = timer_wheel_expire(&WHEEL, now))) {
+            ASSERT(it->deadline <= now);
+            ASSERT(it->deadline + 7 > now);
+            ASSERT((it - nodes) % 3 != 0);
+            expired += 1;
+        }
+    }
+
+    ASSERT_EQ(expired, count - (count + 2) / 3);
+    ASSERT_EQ(WHEEL.len, 0);
+
+    PASS();
+}
+
+GREATEST_SUITE(timer_wheel) {
+    GREATEST_SET_SETUP_CB(timer_wheel_setup, NULL);
+
+    RUN_TEST(timer_wheel_expire_in_order);
+    RUN_TEST(timer_wheel_cancel_and_rearm);
+    RUN_TEST(timer_wheel_beyond_one_turn);
+    RUN_TEST(timer_wheel_deadline_in_past);
+    RUN_TEST(timer_wheel_many);
+}
@@ -5,6 +5,10 @@
 #include "../src/bytes.h"
 #include <ctype.h>
 #include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
 
 Payload UDP_PAYLOAD;
 Bytes UDP_BUFFER;
@@ -159,6 +163,30 @@ TEST udp_serialize_bye(void) {
     PASS();
 }
  
+TEST udp_serialize_iov_references_fields(void) {
+    UDP_PAYLOAD.type = PayloadType_Reply;
+    UDP_PAYLOAD.id = 0x0102;
+    UDP_PAYLOAD.data.reply.result = true;
+    UDP_PAYLOAD.data.reply.ref_message_id = 0x0304;
+    strcpy((void *)UDP_PAYLOAD.data.reply.message_content, "Nijigasaki");
+
+    uint8_t header[UDP_HEADER_MAX];
+    struct iovec iov[PAYLOAD_IOV_MAX];
+
+    ASSERT_EQ(udp_serialize_iov(&UDP_PAYLOAD, header, iov), 2);
+
+    uint8_t expect_header[] = {PayloadType_Reply, 0x01, 0x02, 0x01, 0x03, 0x04};
+    ASSERT_EQ(iov[0].iov_base, header);
+    ASSERT_EQ(iov[0].iov_len, sizeof(expect_header));
+    ASSERT_MEM_EQ(header, expect_header, sizeof(expect_header));
+
+    // The content is not copied, its null terminator is a part of the datagram
+    ASSERT_EQ(iov[1].iov_base, UDP_PAYLOAD.data.reply.message_content);
+    ASSERT_EQ(iov[1].iov_len, strlen("Nijigasaki") + 1);
+
+    PASS();
+}
+
 TEST udp_deserialize_confirm(void) {
     uint8_t data[3] = {0x00, 0xFA, 0xAF};
     bytes_push_arr(&UDP_BUFFER, data, sizeof(data));
@@ -418,6 +446,116 @@ TEST udp_deserialize_invalid_message_content(void) {
     PASS();
 }
 
+TEST udp_deserialize_view_references_datagram(void) {
+    uint8_t datagram[] = {
+        0x04,
+        0x00, 0x07,
+        't', 'm', 'o', 'k', 'e', 'n', 'c', 0,
+        'h', 'i', 0,
+    };
+
+    PayloadView view;
+    udp_deserialize_view(datagram, sizeof(datagram), &view);
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(view.type, PayloadType_Message);
+    ASSERT_EQ(view.id, 7);
+    ASSERT_EQ(view.display_name.data, datagram + 3);
+    ASSERT_EQ(view.display_name.len, 7);
+    ASSERT_EQ(view.message_content.data, datagram + 11);
+    ASSERT_EQ(view.message_content.len, 2);
+
+    // The null terminators are separate pieces
+    uint8_t header[UDP_HEADER_MAX];
+    struct iovec iov[PAYLOAD_IOV_MAX];
+    ASSERT_EQ(udp_serialize_view_iov(&view, header, iov), 5);
+    ASSERT_EQ(iov[1].iov_base, datagram + 3);
+    ASSERT_EQ(iov[1].iov_len, 7);
+    ASSERT_EQ(iov[2].iov_len, 1);
+    ASSERT_EQ(((uint8_t *)iov[2].iov_base)[0], 0);
+
+    uint8_t serialized[sizeof(datagram)];
+    size_t len = 0;
+
+    for (size_t i = 0; i < 5; i++) {
+        memcpy(serialized + len, iov[i].iov_base, iov[i].iov_len);
+        len += iov[i].iov_len;
+    }
+
+    ASSERT_EQ(len, sizeof(datagram));
+    ASSERT_MEM_EQ(serialized, datagram, len);
+    PASS();
+}
+
+TEST udp_batch_receive_and_confirm(void) {
+    struct sockaddr_in server_address = {0};
+    server_address.sin_family = AF_INET;
+    server_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(server_address);
+
+    int server = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_EQ(bind(server, (struct sockaddr *)&server_address, address_len), 0);
+    getsockname(server, (struct sockaddr *)&server_address, &address_len);
+
+    // The client knows only the welcome port, the datagrams come from the dynamic one
+    struct sockaddr_in welcome_address = server_address;
+    welcome_address.sin_port = htons(1);
+    struct addrinfo info = {0};
+    info.ai_addr = (struct sockaddr *)&welcome_address;
+    info.ai_addrlen = sizeof(welcome_address);
+
+    Connection conn = {0};
+    conn.address_info = &info;
+    conn.sockfd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    struct sockaddr_in client_address = server_address;
+    client_address.sin_port = 0;
+    bind(conn.sockfd, (struct sockaddr *)&client_address, sizeof(client_address));
+    address_len = sizeof(client_address);
+    getsockname(conn.sockfd, (struct sockaddr *)&client_address, &address_len);
+
+    PayloadView payloads[UDP_BATCH_MAX];
+    Error errors[UDP_BATCH_MAX];
+    ASSERT_EQ(udp_receive_batch(&conn, payloads, errors, UDP_BATCH_MAX), 0);
+    ASSERT_FALSE(get_error());
+
+    uint8_t msg[] = { 0x04, 0x00, 0x01, 'S', 0, 'h', 'i', 0 };
+    uint8_t malformed[] = { 0x04, 0x00, 0x02, 'S', 0 };
+    uint8_t bye[] = { 0xFF, 0x00, 0x03 };
+    sendto(server, msg, sizeof(msg), 0, (struct sockaddr *)&client_address, sizeof(client_address));
+    sendto(server, malformed, sizeof(malformed), 0, (struct sockaddr *)&client_address, sizeof(client_address));
+    sendto(server, bye, sizeof(bye), 0, (struct sockaddr *)&client_address, sizeof(client_address));
+
+    ASSERT_EQ(udp_receive_batch(&conn, payloads, errors, UDP_BATCH_MAX), 3);
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(errors[0], Error_None);
+    ASSERT_EQ(payloads[0].type, PayloadType_Message);
+    ASSERT_EQ(payloads[0].message_content.len, 2);
+    ASSERT_MEM_EQ(payloads[0].message_content.data, "hi", 2);
+
+    // The payloads reference the datagrams received into the connection
+    ASSERT_EQ(payloads[0].message_content.data, conn.datagrams[0] + 5);
+    ASSERT_EQ(errors[1], Error_InvalidPayload);
+    ASSERT_EQ(payloads[1].id, 2);
+    ASSERT_EQ(errors[2], Error_None);
+    ASSERT_EQ(payloads[2].type, PayloadType_Bye);
+    ASSERT_EQ(welcome_address.sin_port, server_address.sin_port);
+
+    MessageID ids[] = { 1, 2, 3 };
+    udp_confirm_batch(&conn, ids, 3);
+    ASSERT_FALSE(get_error());
+
+    for (int i = 0; i < 3; i++) {
+        uint8_t confirm[8];
+        ASSERT_EQ(recv(server, confirm, sizeof(confirm), 0), 3);
+        ASSERT_EQ(confirm[0], PayloadType_Confirm);
+        ASSERT_EQ((confirm[1] << 8) | confirm[2], ids[i]);
+    }
+
+    close(conn.sockfd);
+    close(server);
+    PASS();
+}
+
 GREATEST_SUITE(udp) {
     GREATEST_SET_SETUP_CB(udp_setup, NULL);
     GREATEST_SET_TEARDOWN_CB(udp_tear_down, NULL);
@@ -428,6 +566,7 @@ GREATEST_SUITE(udp) {
     RUN_TEST(udp_serialize_join);
     RUN_TEST(udp_serialize_msg);
     RUN_TEST(udp_serialize_err);
+    RUN_TEST(udp_serialize_iov_references_fields);
     RUN_TEST(udp_serialize_bye);
 
     RUN_TEST(udp_deserialize_confirm);
@@ -443,4 +582,7 @@ GREATEST_SUITE(udp) {
     RUN_TEST(udp_deserialize_invalid_channel_id);
     RUN_TEST(udp_deserialize_invalid_display_name);
     RUN_TEST(udp_deserialize_invalid_message_content);
+
+    RUN_TEST(udp_deserialize_view_references_datagram);
+    RUN_TEST(udp_batch_receive_and_confirm);
 }
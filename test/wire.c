@@ -0,0 +1,88 @@
+#include "greatest.h"
+#include "../src/error.h"
+#include "../src/wire.h"
+#include "../src/tcp.h"
+#include "../src/udp.h"
+#include <string.h>
+
+Payload WIRE_PAYLOAD;
+
+static void wire_setup(void *arg) {
+    memset(&WIRE_PAYLOAD, 0, sizeof(Payload));
+    WIRE_PAYLOAD.type = PayloadType_Message;
+    WIRE_PAYLOAD.id = 0x1234;
+    strcpy((void *)WIRE_PAYLOAD.data.message.display_name, "Server");
+    strcpy((void *)WIRE_PAYLOAD.data.message.message_content, "Hello there");
+
+    set_error(Error_None);
+    tcp_setup();
+    (void)arg;
+}
+
+static void wire_tear_down(void *arg) {
+    tcp_destroy();
+    (void)arg;
+}
+
+SUITE(wire);
+
+TEST wire_same_as_serialized(void) {
+    Bytes tcp = tcp_serialize(&WIRE_PAYLOAD);
+    Bytes udp = udp_serialize(&WIRE_PAYLOAD);
+
+    Wire *tcp_wire = wire_new(&WIRE_PAYLOAD, Mode_TCP);
+    Wire *udp_wire = wire_new(&WIRE_PAYLOAD, Mode_UDP);
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(tcp_wire->mode, Mode_TCP);
+    ASSERT_EQ(tcp_wire->len, tcp.len);
+    ASSERT_MEM_EQ(tcp_wire->data, tcp.data, tcp.len);
+    ASSERT_EQ(udp_wire->mode, Mode_UDP);
+    ASSERT_EQ(udp_wire->len, udp.len);
+    ASSERT_MEM_EQ(udp_wire->data, udp.data, udp.len);
+
+    wire_unref(tcp_wire);
+    wire_unref(udp_wire);
+    PASS();
+}
+
+TEST wire_udp_header_patch(void) {
+    Wire *wire = wire_new(&WIRE_PAYLOAD, Mode_UDP);
+    uint8_t header[WIRE_UDP_HEADER_LEN];
+    uint8_t expect[WIRE_UDP_HEADER_LEN] = { PayloadType_Message, 0xBE, 0xEF };
+
+    ASSERT_FALSE(get_error());
+    wire_udp_header(wire, 0xBEEF, header);
+    ASSERT_MEM_EQ(header, expect, WIRE_UDP_HEADER_LEN);
+
+    // The shared buffer stays untouched
+    ASSERT_EQ(wire->data[1], 0x12);
+    ASSERT_EQ(wire->data[2], 0x34);
+
+    wire_unref(wire);
+    PASS();
+}
+
+TEST wire_refcount(void) {
+    Wire *wire = wire_new(&WIRE_PAYLOAD, Mode_TCP);
+
+    ASSERT_FALSE(get_error());
+    ASSERT_EQ(wire_ref(wire), wire);
+    ASSERT_EQ(atomic_load(&wire->refcount), 2);
+
+    wire_unref(wire);
+    ASSERT_EQ(atomic_load(&wire->refcount), 1);
+
+    wire_unref(wire);
+    wire_unref(NULL);
+    PASS();
+}
+
+GREATEST_SUITE(wire) {
+    GREATEST_SET_SETUP_CB(wire_setup, NULL);
+    GREATEST_SET_TEARDOWN_CB(wire_tear_down, NULL);
+
+    RUN_TEST(wire_same_as_serialized);
+    RUN_TEST(wire_udp_header_patch);
+    RUN_TEST(wire_refcount);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file credentials.c
+ * @author Le Duy Nguyen, xnguye27, VUT FIT
+ * @date 16/10/2026
+ * @brief Offline tool building the credential index of the server from a list of `username:secret` lines.
+ */
+
+#include "../src/credentials.h"
+#include "../src/error.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+char *HELP = "Builds the credential index used by ipk24chat-server -c.\n"
+"\n"
+"Usage: ./ipk24chat-credentials <INPUT> <OUTPUT>\n"
+"\n"
+"  <INPUT>                  List of username:secret lines, - for the standard input.\n"
+"  <OUTPUT>                 Path of the index to be created, an existing one is replaced atomically.\n";
+
+int main(int argc, char **argv) {
+    if (argc != 3 || strcmp(argv[1], "-h") == 0) {
+        fprintf(stderr, "%s", HELP);
+        return argc >= 2 && strcmp(argv[1], "-h") == 0 ? 0 : 1;
+    }
+
+    FILE *input = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+
+    if (!input) {
+        perror("ERR: Cannot open the input");
+        return 1;
+    }
+
+    // A running server maps the index, it must never see the file truncated or half written,
+    // so the index is written aside and renamed over the old one
+    size_t path_len = strlen(argv[2]);
+    char *temp_path = malloc(path_len + sizeof(".tmp"));
+
+    if (!temp_path) {
+        eprint("Out of memory");
+        if (input != stdin) fclose(input);
+        return Error_OutOfMemory;
+    }
+
+    memcpy(temp_path, argv[2], path_len);
+    memcpy(temp_path + path_len, ".tmp", sizeof(".tmp"));
+
+    FILE *output = fopen(temp_path, "wb");
+
+    if (!output) {
+        perror("ERR: Cannot create the output");
+        if (input != stdin) fclose(input);
+        free(temp_path);
+        return 1;
+    }
+
+    size_t count = credentials_build(input, output);
+
+    if (input != stdin) fclose(input);
+
+    if (fflush(output) != 0 || fsync(fileno(output)) != 0) {
+        perror("ERR: Cannot write the output");
+        set_error(Error_Internal);
+    }
+
+    if (fclose(output) != 0) set_error(Error_Internal);
+
+    if (!get_error() && rename(temp_path, argv[2]) != 0) {
+        perror("ERR: Cannot replace the output");
+        set_error(Error_Internal);
+    }
+
+    if (get_error()) {
+        remove(temp_path);
+        free(temp_path);
+        return get_error();
+    }
+
+    free(temp_path);
+
+    printf("%lu credentials written into %s\n", count, argv[2]);
+    return 0;
+}